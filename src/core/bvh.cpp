@@ -0,0 +1,1427 @@
+#include <core/bvh.hpp>
+#include <utils/parallel.hpp>
+#include <algorithm>
+#include <array>
+#include <chrono>
+#include <cmath>
+#include <limits>
+#include <sstream>
+#include <stdexcept>
+namespace reina
+{
+    // BVHAccel Local Declarations
+    struct BVHPrimitiveInfo
+    {
+        BVHPrimitiveInfo() = default;
+        BVHPrimitiveInfo(size_t primitiveNumber, const Bounds3f &bounds)
+            : primitiveNumber(primitiveNumber), bounds(bounds),
+              centroid(bounds.pMin * .5f + bounds.pMax * .5f) {}
+        size_t primitiveNumber = 0;
+        Bounds3f bounds;
+        Point3f centroid;
+    };
+
+    struct BVHBuildNode
+    {
+        void InitLeaf(int first, int n, const Bounds3f &b)
+        {
+            firstPrimOffset = first;
+            nPrimitives = n;
+            bounds = b;
+        }
+        void InitInterior(int axis, std::unique_ptr<BVHBuildNode> c0, std::unique_ptr<BVHBuildNode> c1)
+        {
+            bounds = Union(c0->bounds, c1->bounds);
+            children[0] = std::move(c0);
+            children[1] = std::move(c1);
+            splitAxis = axis;
+            nPrimitives = 0;
+        }
+        Bounds3f bounds;
+        std::unique_ptr<BVHBuildNode> children[2];
+        int splitAxis = 0, firstPrimOffset = 0, nPrimitives = 0;
+    };
+
+    namespace
+    {
+        constexpr int nBuckets = 12;
+        constexpr Float TraversalCost = 1;
+        constexpr Float IntersectCost = 1;
+        // ranges above these sizes are processed with several threads
+        constexpr int ParallelBinThreshold = 256 * 1024;
+        constexpr int ParallelSplitThreshold = 64 * 1024;
+        // deepest leaf the traversal stacks can reach
+        constexpr int MaxBuildDepth = BVHStackSize - 1;
+
+        // true once a range of n primitives at depth has to be split by count, with ceil(log2 n)
+        // levels to go, to keep its leaves within maxDepth
+        bool MustSplitByCount(int depth, int n, int maxDepth)
+        {
+            return n > 1 && depth + Log2Int((uint32_t)(n - 1)) + 1 >= maxDepth;
+        }
+
+        struct BucketInfo
+        {
+            int count = 0;
+            Bounds3f bounds;
+        };
+
+        struct RangeBounds
+        {
+            Bounds3f bounds, centroidBounds;
+        };
+
+        RangeBounds ComputeRangeBounds(const std::vector<BVHPrimitiveInfo> &primitiveInfo, int start, int end)
+        {
+            auto accumulate = [&](int64_t begin, int64_t stop)
+            {
+                RangeBounds r;
+                for (int64_t i = begin; i < stop; ++i)
+                {
+                    r.bounds = Union(r.bounds, primitiveInfo[i].bounds);
+                    r.centroidBounds = Union(r.centroidBounds, primitiveInfo[i].centroid);
+                }
+                return r;
+            };
+            int n = end - start;
+            if (n < ParallelBinThreshold)
+                return accumulate(start, end);
+            int64_t chunkSize = 16 * 1024;
+            std::vector<RangeBounds> partial((n + chunkSize - 1) / chunkSize);
+            ParallelFor(n, chunkSize, [&](int64_t begin, int64_t stop)
+                        { partial[begin / chunkSize] = accumulate(start + begin, start + stop); });
+            RangeBounds r;
+            for (const RangeBounds &p : partial)
+            {
+                r.bounds = Union(r.bounds, p.bounds);
+                r.centroidBounds = Union(r.centroidBounds, p.centroidBounds);
+            }
+            return r;
+        }
+
+        int BucketIndex(const BVHPrimitiveInfo &info, const Bounds3f &centroidBounds, int dim)
+        {
+            int b = (int)(nBuckets * centroidBounds.Offset(info.centroid)[dim]);
+            return std::min(b, nBuckets - 1);
+        }
+
+        void FillBuckets(const std::vector<BVHPrimitiveInfo> &primitiveInfo, int start, int end,
+                         const Bounds3f &centroidBounds, int dim, BucketInfo buckets[nBuckets])
+        {
+            int n = end - start;
+            if (n < ParallelBinThreshold)
+            {
+                for (int i = start; i < end; ++i)
+                {
+                    BucketInfo &bucket = buckets[BucketIndex(primitiveInfo[i], centroidBounds, dim)];
+                    bucket.count++;
+                    bucket.bounds = Union(bucket.bounds, primitiveInfo[i].bounds);
+                }
+                return;
+            }
+            int64_t chunkSize = 16 * 1024;
+            std::vector<std::array<BucketInfo, nBuckets>> partial((n + chunkSize - 1) / chunkSize);
+            ParallelFor(n, chunkSize, [&](int64_t begin, int64_t stop)
+                        {
+                std::array<BucketInfo, nBuckets> &local = partial[begin / chunkSize];
+                for (int64_t i = start + begin; i < start + stop; ++i)
+                {
+                    BucketInfo &bucket = local[BucketIndex(primitiveInfo[i], centroidBounds, dim)];
+                    bucket.count++;
+                    bucket.bounds = Union(bucket.bounds, primitiveInfo[i].bounds);
+                } });
+            for (const auto &local : partial)
+                for (int b = 0; b < nBuckets; ++b)
+                {
+                    buckets[b].count += local[b].count;
+                    buckets[b].bounds = Union(buckets[b].bounds, local[b].bounds);
+                }
+        }
+
+        void CollectStats(const BVHBuildNode *node, Float rootArea, int depth, BVHAccel::BuildStats *stats)
+        {
+            stats->totalNodes++;
+            stats->maxDepth = std::max(stats->maxDepth, depth);
+            Float area = node->bounds.SurfaceArea() / rootArea;
+            if (node->nPrimitives > 0)
+            {
+                stats->leafNodes++;
+                stats->sahCost += area * node->nPrimitives * IntersectCost;
+                return;
+            }
+            stats->sahCost += area * TraversalCost;
+            CollectStats(node->children[0].get(), rootArea, depth + 1, stats);
+            CollectStats(node->children[1].get(), rootArea, depth + 1, stats);
+        }
+
+        // the same for a collapsed tree: every child lane with primitives counts as a leaf node
+        template <int Width>
+        void CollectWideStats(const std::vector<WideBVHNode<Width>> &nodes, int nodeIndex, Float area,
+                              Float rootArea, int depth, BVHAccel::BuildStats *stats)
+        {
+            stats->totalNodes++;
+            stats->maxDepth = std::max(stats->maxDepth, depth);
+            stats->sahCost += area / rootArea * TraversalCost;
+            const WideBVHNode<Width> &node = nodes[nodeIndex];
+            for (int i = 0; i < Width; ++i)
+            {
+                if (node.child[i] < 0)
+                    continue;
+                Float childArea = node.bounds.Get(i).SurfaceArea();
+                if (node.nPrimitives[i] == 0)
+                {
+                    CollectWideStats(nodes, node.child[i], childArea, rootArea, depth + 1, stats);
+                    continue;
+                }
+                stats->totalNodes++;
+                stats->leafNodes++;
+                stats->maxDepth = std::max(stats->maxDepth, depth + 1);
+                stats->sahCost += childArea / rootArea * node.nPrimitives[i] * IntersectCost;
+            }
+        }
+    }
+
+    // BVHAccel Method Definitions
+    SplitMethod ParseSplitMethod(const std::string &name)
+    {
+        if (name == "sah")
+            return SplitMethod::SAH;
+        if (name == "lbvh")
+            return SplitMethod::LBVH;
+        if (name == "hlbvh")
+            return SplitMethod::HLBVH;
+        throw std::invalid_argument("unknown BVH split method \"" + name + "\"");
+    }
+
+    BVHAccel::BVHAccel(std::vector<std::shared_ptr<Primitive>> p, int maxPrimsInNode, SplitMethod splitMethod)
+        : maxPrimsInNode(std::min(255, maxPrimsInNode)), splitMethod(splitMethod), primitives(std::move(p))
+    {
+        if (primitives.empty())
+            return;
+        auto startTime = std::chrono::steady_clock::now();
+
+        // the build sorts parts, so that a mesh's triangles land in separate leaves
+        int64_t nRefs = 0;
+        for (const auto &prim : primitives)
+            nRefs += prim->NumParts();
+        if (nRefs > std::numeric_limits<int>::max())
+            throw std::length_error("BVHAccel: more than 2^31 primitive parts");
+        if (nRefs == 0)
+            return;
+        Buffer<PrimitiveRef> unordered(nRefs);
+        for (int32_t p = 0, r = 0; p < (int32_t)primitives.size(); ++p)
+            for (int32_t part = 0, nParts = primitives[p]->NumParts(); part < nParts; ++part)
+                unordered[r++] = PrimitiveRef{p, part};
+        std::vector<BVHPrimitiveInfo> primitiveInfo(nRefs);
+        ParallelFor(nRefs, 4096, [&](int64_t begin, int64_t end)
+                    {
+            for (int64_t i = begin; i < end; ++i)
+                primitiveInfo[i] = BVHPrimitiveInfo(
+                    i, primitives[unordered[i].primitive]->PartBound(unordered[i].part)); });
+
+        std::unique_ptr<BVHBuildNode> root = splitMethod == SplitMethod::SAH
+                                                 ? recursiveBuild(primitiveInfo, 0, (int)nRefs, 0)
+                                                 : lbvhBuild(primitiveInfo);
+
+        // leaves index straight into the partitioned order
+        refs.resize(nRefs);
+        for (size_t i = 0; i < primitiveInfo.size(); ++i)
+            refs[i] = unordered[primitiveInfo[i].primitiveNumber];
+
+        Float rootArea = root->bounds.SurfaceArea();
+        CollectStats(root.get(), rootArea > 0 ? rootArea : 1, 0, &stats);
+
+        nodes.resize(stats.totalNodes);
+        int offset = 0;
+        flattenBVHTree(root.get(), &offset);
+        assert(offset == stats.totalNodes);
+        stats.buildTimeMs = std::chrono::duration<double, std::milli>(
+                                std::chrono::steady_clock::now() - startTime)
+                                .count();
+    }
+
+    BVHAccel::BVHAccel(std::vector<std::shared_ptr<Primitive>> p, Buffer<PrimitiveRef> refs,
+                       Buffer<LinearBVHNode> nodes, const BuildStats &stats, int maxPrimsInNode,
+                       SplitMethod splitMethod)
+        : maxPrimsInNode(std::min(255, maxPrimsInNode)), splitMethod(splitMethod), primitives(std::move(p)),
+          refs(std::move(refs)), nodes(std::move(nodes)), stats(stats)
+    {
+    }
+
+    BVHAccel::~BVHAccel() = default;
+
+    std::unique_ptr<BVHBuildNode> BVHAccel::recursiveBuild(std::vector<BVHPrimitiveInfo> &primitiveInfo,
+                                                           int start, int end, int depth)
+    {
+        auto node = std::make_unique<BVHBuildNode>();
+        int nPrimitives = end - start;
+        RangeBounds range = ComputeRangeBounds(primitiveInfo, start, end);
+        const Bounds3f &centroidBounds = range.centroidBounds;
+        if (nPrimitives == 1)
+        {
+            node->InitLeaf(start, nPrimitives, range.bounds);
+            return node;
+        }
+
+        int dim = centroidBounds.MaximumExtent();
+        int mid = (start + end) / 2;
+        if (centroidBounds.pMax[dim] == centroidBounds.pMin[dim])
+        {
+            // coincident centroids: nothing to split on, so stop or cut by count
+            if (nPrimitives <= maxPrimsInNode)
+            {
+                node->InitLeaf(start, nPrimitives, range.bounds);
+                return node;
+            }
+        }
+        else if (nPrimitives <= 2 || MustSplitByCount(depth, nPrimitives, MaxBuildDepth))
+        {
+            // a median split, also taken near the depth limit that skewed inputs would pass
+            std::nth_element(&primitiveInfo[start], &primitiveInfo[mid], &primitiveInfo[end - 1] + 1,
+                             [dim](const BVHPrimitiveInfo &a, const BVHPrimitiveInfo &b)
+                             { return a.centroid[dim] < b.centroid[dim]; });
+        }
+        else
+        {
+            BucketInfo buckets[nBuckets];
+            FillBuckets(primitiveInfo, start, end, centroidBounds, dim, buckets);
+
+            // sweep the bucket boundaries and keep the cheapest split
+            Float cost[nBuckets - 1];
+            for (int i = 0; i < nBuckets - 1; ++i)
+            {
+                Bounds3f b0, b1;
+                int count0 = 0, count1 = 0;
+                for (int j = 0; j <= i; ++j)
+                {
+                    b0 = Union(b0, buckets[j].bounds);
+                    count0 += buckets[j].count;
+                }
+                for (int j = i + 1; j < nBuckets; ++j)
+                {
+                    b1 = Union(b1, buckets[j].bounds);
+                    count1 += buckets[j].count;
+                }
+                Float area0 = count0 ? b0.SurfaceArea() : 0;
+                Float area1 = count1 ? b1.SurfaceArea() : 0;
+                cost[i] = TraversalCost +
+                          IntersectCost * (count0 * area0 + count1 * area1) / range.bounds.SurfaceArea();
+            }
+            Float minCost = cost[0];
+            int minCostSplitBucket = 0;
+            for (int i = 1; i < nBuckets - 1; ++i)
+            {
+                if (cost[i] < minCost)
+                {
+                    minCost = cost[i];
+                    minCostSplitBucket = i;
+                }
+            }
+
+            Float leafCost = IntersectCost * nPrimitives;
+            if (nPrimitives <= maxPrimsInNode && minCost >= leafCost)
+            {
+                node->InitLeaf(start, nPrimitives, range.bounds);
+                return node;
+            }
+            BVHPrimitiveInfo *pmid = std::partition(
+                &primitiveInfo[start], &primitiveInfo[end - 1] + 1,
+                [=](const BVHPrimitiveInfo &pi)
+                { return BucketIndex(pi, centroidBounds, dim) <= minCostSplitBucket; });
+            mid = pmid - &primitiveInfo[0];
+            if (mid == start || mid == end)
+                mid = (start + end) / 2;
+        }
+
+        // the top of the tree is split across threads
+        std::unique_ptr<BVHBuildNode> c0, c1;
+        auto buildLeft = [&]()
+        { c0 = recursiveBuild(primitiveInfo, start, mid, depth + 1); };
+        auto buildRight = [&]()
+        { c1 = recursiveBuild(primitiveInfo, mid, end, depth + 1); };
+        int parallelDepth = (int)std::ceil(std::log2(NumSystemCores())) + 1;
+        if (depth < parallelDepth && nPrimitives > ParallelSplitThreshold)
+            ParallelInvoke(buildLeft, buildRight);
+        else
+        {
+            buildLeft();
+            buildRight();
+        }
+        node->InitInterior(dim, std::move(c0), std::move(c1));
+        return node;
+    }
+
+    namespace
+    {
+        struct MortonPrimitive
+        {
+            uint64_t mortonCode;
+            uint32_t primitiveIndex;
+        };
+
+        // LSD radix sort, 8 bits a pass; chunks histogram and scatter in parallel
+        void RadixSort(std::vector<MortonPrimitive> *v, int nBits)
+        {
+            constexpr int bitsPerPass = 8;
+            constexpr int nRadixBuckets = 1 << bitsPerPass;
+            constexpr uint64_t bitMask = nRadixBuckets - 1;
+            const int nPasses = (nBits + bitsPerPass - 1) / bitsPerPass;
+            const int64_t n = (int64_t)v->size();
+            std::vector<MortonPrimitive> temp(n);
+            int64_t chunkSize = std::max<int64_t>(16 * 1024, n / (4 * NumSystemCores()) + 1);
+            int64_t nChunks = (n + chunkSize - 1) / chunkSize;
+            std::vector<std::array<int64_t, nRadixBuckets>> offsets(nChunks);
+            for (int pass = 0; pass < nPasses; ++pass)
+            {
+                const int lowBit = pass * bitsPerPass;
+                const std::vector<MortonPrimitive> &in = (pass & 1) ? temp : *v;
+                std::vector<MortonPrimitive> &out = (pass & 1) ? *v : temp;
+                ParallelFor(n, chunkSize, [&](int64_t begin, int64_t end)
+                            {
+                    std::array<int64_t, nRadixBuckets> &count = offsets[begin / chunkSize];
+                    count.fill(0);
+                    for (int64_t i = begin; i < end; ++i)
+                        count[(in[i].mortonCode >> lowBit) & bitMask]++; });
+                // turn the counts into each chunk's first slot per bucket
+                int64_t sum = 0;
+                for (int b = 0; b < nRadixBuckets; ++b)
+                    for (int64_t c = 0; c < nChunks; ++c)
+                    {
+                        int64_t count = offsets[c][b];
+                        offsets[c][b] = sum;
+                        sum += count;
+                    }
+                ParallelFor(n, chunkSize, [&](int64_t begin, int64_t end)
+                            {
+                    std::array<int64_t, nRadixBuckets> &slot = offsets[begin / chunkSize];
+                    for (int64_t i = begin; i < end; ++i)
+                        out[slot[(in[i].mortonCode >> lowBit) & bitMask]++] = in[i]; });
+            }
+            if (nPasses & 1)
+                v->swap(temp);
+        }
+
+        std::unique_ptr<BVHBuildNode> EmitLBVH(const std::vector<BVHPrimitiveInfo> &primitiveInfo,
+                                               const std::vector<MortonPrimitive> &mortonPrims,
+                                               int start, int end, int bitIndex, int maxPrimsInNode, int depth)
+        {
+            int nPrimitives = end - start;
+            if (nPrimitives <= maxPrimsInNode)
+            {
+                auto node = std::make_unique<BVHBuildNode>();
+                Bounds3f bounds;
+                for (int i = start; i < end; ++i)
+                    bounds = Union(bounds, primitiveInfo[i].bounds);
+                node->InitLeaf(start, nPrimitives, bounds);
+                return node;
+            }
+            if (bitIndex < 0 || MustSplitByCount(depth, nPrimitives, MaxBuildDepth))
+            {
+                // identical codes, or clustered ones about to overflow the stacks: split by count
+                int mid = (start + end) / 2;
+                auto node = std::make_unique<BVHBuildNode>();
+                node->InitInterior(0, EmitLBVH(primitiveInfo, mortonPrims, start, mid, -1, maxPrimsInNode,
+                                               depth + 1),
+                                   EmitLBVH(primitiveInfo, mortonPrims, mid, end, -1, maxPrimsInNode, depth + 1));
+                return node;
+            }
+            uint64_t mask = 1ull << bitIndex;
+            if ((mortonPrims[start].mortonCode & mask) == (mortonPrims[end - 1].mortonCode & mask))
+                return EmitLBVH(primitiveInfo, mortonPrims, start, end, bitIndex - 1, maxPrimsInNode, depth);
+
+            // first primitive with the bit set
+            int searchStart = start, searchEnd = end - 1;
+            while (searchStart + 1 != searchEnd)
+            {
+                int mid = (searchStart + searchEnd) / 2;
+                if ((mortonPrims[searchStart].mortonCode & mask) == (mortonPrims[mid].mortonCode & mask))
+                    searchStart = mid;
+                else
+                    searchEnd = mid;
+            }
+            int splitOffset = searchEnd;
+            auto node = std::make_unique<BVHBuildNode>();
+            node->InitInterior(
+                bitIndex % 3,
+                EmitLBVH(primitiveInfo, mortonPrims, start, splitOffset, bitIndex - 1, maxPrimsInNode, depth + 1),
+                EmitLBVH(primitiveInfo, mortonPrims, splitOffset, end, bitIndex - 1, maxPrimsInNode, depth + 1));
+            return node;
+        }
+
+        // joins treelets by the remaining high Morton bits, one level per bit
+        std::unique_ptr<BVHBuildNode> BuildUpperLBVH(std::vector<std::unique_ptr<BVHBuildNode>> &roots,
+                                                     const std::vector<uint64_t> &keys, int start, int end,
+                                                     int bitIndex)
+        {
+            if (end - start == 1)
+                return std::move(roots[start]);
+            uint64_t mask = 1ull << bitIndex;
+            if ((keys[start] & mask) == (keys[end - 1] & mask))
+                return BuildUpperLBVH(roots, keys, start, end, bitIndex - 1);
+            int split = start + 1;
+            while ((keys[split] & mask) == (keys[start] & mask))
+                ++split;
+            auto node = std::make_unique<BVHBuildNode>();
+            node->InitInterior(bitIndex % 3, BuildUpperLBVH(roots, keys, start, split, bitIndex - 1),
+                               BuildUpperLBVH(roots, keys, split, end, bitIndex - 1));
+            return node;
+        }
+
+        // joins treelets with binned SAH over their bounds, no deeper than maxDepth
+        std::unique_ptr<BVHBuildNode> BuildUpperSAH(std::vector<std::unique_ptr<BVHBuildNode>> &roots,
+                                                    int start, int end, int depth, int maxDepth)
+        {
+            int nNodes = end - start;
+            if (nNodes == 1)
+                return std::move(roots[start]);
+            Bounds3f bounds, centroidBounds;
+            for (int i = start; i < end; ++i)
+            {
+                bounds = Union(bounds, roots[i]->bounds);
+                centroidBounds = Union(centroidBounds, (roots[i]->bounds.pMin + roots[i]->bounds.pMax) * .5f);
+            }
+            int dim = centroidBounds.MaximumExtent();
+            auto bucketOf = [&](const BVHBuildNode *node)
+            {
+                Float centroid = (node->bounds.pMin[dim] + node->bounds.pMax[dim]) * .5f;
+                int b = (int)(nBuckets * ((centroid - centroidBounds.pMin[dim]) /
+                                          (centroidBounds.pMax[dim] - centroidBounds.pMin[dim])));
+                return std::min(b, nBuckets - 1);
+            };
+            int mid = (start + end) / 2;
+            if (MustSplitByCount(depth, nNodes, maxDepth))
+                std::nth_element(roots.begin() + start, roots.begin() + mid, roots.begin() + end,
+                                 [dim](const std::unique_ptr<BVHBuildNode> &a, const std::unique_ptr<BVHBuildNode> &b)
+                                 { return a->bounds.pMin[dim] + a->bounds.pMax[dim] <
+                                          b->bounds.pMin[dim] + b->bounds.pMax[dim]; });
+            else if (centroidBounds.pMax[dim] != centroidBounds.pMin[dim])
+            {
+                BucketInfo buckets[nBuckets];
+                for (int i = start; i < end; ++i)
+                {
+                    BucketInfo &bucket = buckets[bucketOf(roots[i].get())];
+                    bucket.count++;
+                    bucket.bounds = Union(bucket.bounds, roots[i]->bounds);
+                }
+                Float minCost = Infinity;
+                int minCostSplitBucket = 0;
+                for (int i = 0; i < nBuckets - 1; ++i)
+                {
+                    Bounds3f b0, b1;
+                    int count0 = 0, count1 = 0;
+                    for (int j = 0; j <= i; ++j)
+                    {
+                        b0 = Union(b0, buckets[j].bounds);
+                        count0 += buckets[j].count;
+                    }
+                    for (int j = i + 1; j < nBuckets; ++j)
+                    {
+                        b1 = Union(b1, buckets[j].bounds);
+                        count1 += buckets[j].count;
+                    }
+                    Float cost = TraversalCost + IntersectCost *
+                                                     ((count0 ? count0 * b0.SurfaceArea() : 0) +
+                                                      (count1 ? count1 * b1.SurfaceArea() : 0)) /
+                                                     bounds.SurfaceArea();
+                    if (cost < minCost)
+                    {
+                        minCost = cost;
+                        minCostSplitBucket = i;
+                    }
+                }
+                auto pmid = std::partition(roots.begin() + start, roots.begin() + end,
+                                           [&](const std::unique_ptr<BVHBuildNode> &node)
+                                           { return bucketOf(node.get()) <= minCostSplitBucket; });
+                mid = (int)(pmid - roots.begin());
+                if (mid == start || mid == end)
+                    mid = (start + end) / 2;
+            }
+            auto node = std::make_unique<BVHBuildNode>();
+            node->InitInterior(dim, BuildUpperSAH(roots, start, mid, depth + 1, maxDepth),
+                               BuildUpperSAH(roots, mid, end, depth + 1, maxDepth));
+            return node;
+        }
+    }
+
+    std::unique_ptr<BVHBuildNode> BVHAccel::lbvhBuild(std::vector<BVHPrimitiveInfo> &primitiveInfo)
+    {
+        int nPrimitives = (int)primitiveInfo.size();
+        RangeBounds range = ComputeRangeBounds(primitiveInfo, 0, nPrimitives);
+        const Bounds3f &centroidBounds = range.centroidBounds;
+
+        // 10 bits per axis for moderate scenes, 21 when the extra sort passes pay off
+        const bool wideCodes = nPrimitives > (1 << 20);
+        const int mortonBits = wideCodes ? 63 : 30;
+        const Float mortonScale = wideCodes ? (1 << 21) - 1 : 1 << 10;
+        std::vector<MortonPrimitive> mortonPrims(nPrimitives);
+        ParallelFor(nPrimitives, 4096, [&](int64_t begin, int64_t end)
+                    {
+            for (int64_t i = begin; i < end; ++i)
+            {
+                Vector3f o = centroidBounds.Offset(primitiveInfo[i].centroid) * mortonScale;
+                mortonPrims[i].primitiveIndex = (uint32_t)i;
+                mortonPrims[i].mortonCode = wideCodes ? EncodeMorton3x21((uint32_t)o.x, (uint32_t)o.y, (uint32_t)o.z)
+                                                      : EncodeMorton3((uint32_t)o.x, (uint32_t)o.y, (uint32_t)o.z);
+            } });
+        RadixSort(&mortonPrims, mortonBits);
+
+        // leaves index the Morton order, so primitiveInfo follows it
+        std::vector<BVHPrimitiveInfo> sortedInfo(nPrimitives);
+        ParallelFor(nPrimitives, 4096, [&](int64_t begin, int64_t end)
+                    {
+            for (int64_t i = begin; i < end; ++i)
+                sortedInfo[i] = primitiveInfo[mortonPrims[i].primitiveIndex]; });
+        primitiveInfo.swap(sortedInfo);
+
+        // treelets share their top 12 bits and are emitted independently, below an upper tree of at
+        // most upperDepth levels: one per key bit for LBVH, and twice that for the SAH top
+        constexpr int treeletBits = 12;
+        const int upperDepth = splitMethod == SplitMethod::HLBVH ? 2 * treeletBits : treeletBits;
+        const int treeletShift = mortonBits - treeletBits;
+        std::vector<std::pair<int, int>> treelets;
+        for (int start = 0, end = 1; end <= nPrimitives; ++end)
+        {
+            if (end == nPrimitives ||
+                (mortonPrims[start].mortonCode >> treeletShift) != (mortonPrims[end].mortonCode >> treeletShift))
+            {
+                treelets.push_back({start, end});
+                start = end;
+            }
+        }
+        std::vector<std::unique_ptr<BVHBuildNode>> roots(treelets.size());
+        std::vector<uint64_t> keys(treelets.size());
+        ParallelFor(treelets.size(), 1, [&](int64_t begin, int64_t end)
+                    {
+            for (int64_t i = begin; i < end; ++i)
+            {
+                roots[i] = EmitLBVH(primitiveInfo, mortonPrims, treelets[i].first, treelets[i].second,
+                                    treeletShift - 1, maxPrimsInNode, upperDepth);
+                keys[i] = mortonPrims[treelets[i].first].mortonCode >> treeletShift;
+            } });
+
+        if (splitMethod == SplitMethod::HLBVH)
+            return BuildUpperSAH(roots, 0, (int)roots.size(), 0, upperDepth);
+        return BuildUpperLBVH(roots, keys, 0, (int)roots.size(), treeletBits - 1);
+    }
+
+    int BVHAccel::flattenBVHTree(const BVHBuildNode *node, int *offset)
+    {
+        LinearBVHNode *linearNode = &nodes[*offset];
+        linearNode->bounds = node->bounds;
+        int myOffset = (*offset)++;
+        if (node->nPrimitives > 0)
+        {
+            assert(node->nPrimitives <= UINT16_MAX);
+            linearNode->primitivesOffset = node->firstPrimOffset;
+            linearNode->nPrimitives = node->nPrimitives;
+        }
+        else
+        {
+            linearNode->axis = node->splitAxis;
+            linearNode->nPrimitives = 0;
+            flattenBVHTree(node->children[0].get(), offset);
+            linearNode->secondChildOffset = flattenBVHTree(node->children[1].get(), offset);
+        }
+        return myOffset;
+    }
+
+    Bounds3f BVHAccel::WorldBound() const
+    {
+        return nodes.empty() ? Bounds3f() : nodes[0].bounds;
+    }
+
+    bool BVHAccel::Intersect(const Ray &ray, SurfaceInteraction *isect) const
+    {
+        if (nodes.empty())
+            return false;
+        bool hit = false;
+        Vector3f invDir(1 / ray.d.x, 1 / ray.d.y, 1 / ray.d.z);
+        int dirIsNeg[3] = {invDir.x < 0, invDir.y < 0, invDir.z < 0};
+        int toVisitOffset = 0, currentNodeIndex = 0;
+        int nodesToVisit[BVHStackSize];
+        while (true)
+        {
+            const LinearBVHNode *node = &nodes[currentNodeIndex];
+            if (node->bounds.IntersectP(ray, invDir, dirIsNeg))
+            {
+                if (node->nPrimitives > 0)
+                {
+                    for (int i = 0; i < node->nPrimitives; ++i)
+                    {
+                        const PrimitiveRef &ref = refs[node->primitivesOffset + i];
+                        if (primitives[ref.primitive]->IntersectPart(ref.part, ray, isect))
+                            hit = true;
+                    }
+                    if (toVisitOffset == 0)
+                        break;
+                    currentNodeIndex = nodesToVisit[--toVisitOffset];
+                }
+                else
+                {
+                    // visit the near child first, only the far one is pushed
+                    if (dirIsNeg[node->axis])
+                    {
+                        nodesToVisit[toVisitOffset++] = currentNodeIndex + 1;
+                        currentNodeIndex = node->secondChildOffset;
+                    }
+                    else
+                    {
+                        nodesToVisit[toVisitOffset++] = node->secondChildOffset;
+                        currentNodeIndex = currentNodeIndex + 1;
+                    }
+                }
+            }
+            else
+            {
+                if (toVisitOffset == 0)
+                    break;
+                currentNodeIndex = nodesToVisit[--toVisitOffset];
+            }
+        }
+        return hit;
+    }
+
+    bool BVHAccel::IntersectP(const Ray &ray) const
+    {
+        if (nodes.empty())
+            return false;
+        Vector3f invDir(1 / ray.d.x, 1 / ray.d.y, 1 / ray.d.z);
+        int dirIsNeg[3] = {invDir.x < 0, invDir.y < 0, invDir.z < 0};
+        int toVisitOffset = 0, currentNodeIndex = 0;
+        int nodesToVisit[BVHStackSize];
+        while (true)
+        {
+            const LinearBVHNode *node = &nodes[currentNodeIndex];
+            if (node->bounds.IntersectP(ray, invDir, dirIsNeg))
+            {
+                if (node->nPrimitives > 0)
+                {
+                    for (int i = 0; i < node->nPrimitives; ++i)
+                    {
+                        const PrimitiveRef &ref = refs[node->primitivesOffset + i];
+                        if (primitives[ref.primitive]->IntersectPPart(ref.part, ray))
+                            return true;
+                    }
+                    if (toVisitOffset == 0)
+                        break;
+                    currentNodeIndex = nodesToVisit[--toVisitOffset];
+                }
+                else
+                {
+                    if (dirIsNeg[node->axis])
+                    {
+                        nodesToVisit[toVisitOffset++] = currentNodeIndex + 1;
+                        currentNodeIndex = node->secondChildOffset;
+                    }
+                    else
+                    {
+                        nodesToVisit[toVisitOffset++] = node->secondChildOffset;
+                        currentNodeIndex = currentNodeIndex + 1;
+                    }
+                }
+            }
+            else
+            {
+                if (toVisitOffset == 0)
+                    break;
+                currentNodeIndex = nodesToVisit[--toVisitOffset];
+            }
+        }
+        return false;
+    }
+
+    namespace
+    {
+        // lanes of mask whose ray overlaps the box; written as plain lane loops for the vectorizer
+        template <int N>
+        uint32_t PacketBoundsMask(const Bounds3f &b, const RayPacket<N> &packet,
+                                  const Float invDx[N], const Float invDy[N], const Float invDz[N],
+                                  uint32_t mask)
+        {
+            const Float scale = 1 + 2 * gamma(3);
+            uint32_t hits = 0;
+            for (int i = 0; i < N; ++i)
+            {
+                // per-lane near/far planes; NaN slabs are dropped by the argument order
+                Float tNear = std::max((Float)0, ((invDx[i] < 0 ? b.pMax.x : b.pMin.x) - packet.ox[i]) * invDx[i]);
+                tNear = std::max(tNear, ((invDy[i] < 0 ? b.pMax.y : b.pMin.y) - packet.oy[i]) * invDy[i]);
+                tNear = std::max(tNear, ((invDz[i] < 0 ? b.pMax.z : b.pMin.z) - packet.oz[i]) * invDz[i]);
+                Float tFar = std::min(packet.tMax[i], ((invDx[i] < 0 ? b.pMin.x : b.pMax.x) - packet.ox[i]) * invDx[i]);
+                tFar = std::min(tFar, ((invDy[i] < 0 ? b.pMin.y : b.pMax.y) - packet.oy[i]) * invDy[i]);
+                tFar = std::min(tFar, ((invDz[i] < 0 ? b.pMin.z : b.pMax.z) - packet.oz[i]) * invDz[i]);
+                hits |= (uint32_t)(tNear <= tFar * scale) << i;
+            }
+            return hits & mask;
+        }
+
+        struct PacketStackEntry
+        {
+            int node;
+            uint32_t mask;
+        };
+    }
+
+    template <int N>
+    uint32_t BVHAccel::IntersectPacket(const RayPacket<N> &packet, HitPacket<N> *hits) const
+    {
+        if (nodes.empty() || !packet.activeMask)
+            return 0;
+        alignas(64) Float invDx[N], invDy[N], invDz[N];
+        for (int i = 0; i < N; ++i)
+        {
+            invDx[i] = 1 / packet.dx[i];
+            invDy[i] = 1 / packet.dy[i];
+            invDz[i] = 1 / packet.dz[i];
+        }
+        // a coherent packet shares one traversal order, taken from its first ray
+        int first = CountTrailingZeros(packet.activeMask);
+        int dirIsNeg[3] = {invDx[first] < 0, invDy[first] < 0, invDz[first] < 0};
+        PacketStackEntry stack[BVHStackSize];
+        int stackSize = 0;
+        stack[stackSize++] = {0, packet.activeMask};
+        while (stackSize > 0)
+        {
+            PacketStackEntry entry = stack[--stackSize];
+            const LinearBVHNode *node = &nodes[entry.node];
+            uint32_t mask = PacketBoundsMask<N>(node->bounds, packet, invDx, invDy, invDz, entry.mask);
+            if (!mask)
+                continue;
+            if (node->nPrimitives > 0)
+            {
+                for (int i = 0; i < node->nPrimitives; ++i)
+                {
+                    const PrimitiveRef &ref = refs[node->primitivesOffset + i];
+                    const Primitive *prim = primitives[ref.primitive].get();
+                    for (uint32_t m = mask; m; m &= m - 1)
+                    {
+                        int lane = CountTrailingZeros(m);
+                        Ray ray = packet.Get(lane);
+                        SurfaceInteraction si;
+                        if (prim->IntersectPart(ref.part, ray, &si))
+                        {
+                            packet.tMax[lane] = ray.tMax;
+                            if (!si.primitive)
+                                si.primitive = prim;
+                            hits->Set(lane, ray.tMax, si);
+                        }
+                    }
+                }
+            }
+            else if (dirIsNeg[node->axis])
+            {
+                stack[stackSize++] = {entry.node + 1, mask};
+                stack[stackSize++] = {node->secondChildOffset, mask};
+            }
+            else
+            {
+                stack[stackSize++] = {node->secondChildOffset, mask};
+                stack[stackSize++] = {entry.node + 1, mask};
+            }
+        }
+        return hits->hitMask & packet.activeMask;
+    }
+
+    template <int N>
+    uint32_t BVHAccel::IntersectPacketP(const RayPacket<N> &packet) const
+    {
+        if (nodes.empty() || !packet.activeMask)
+            return 0;
+        alignas(64) Float invDx[N], invDy[N], invDz[N];
+        for (int i = 0; i < N; ++i)
+        {
+            invDx[i] = 1 / packet.dx[i];
+            invDy[i] = 1 / packet.dy[i];
+            invDz[i] = 1 / packet.dz[i];
+        }
+        int first = CountTrailingZeros(packet.activeMask);
+        int dirIsNeg[3] = {invDx[first] < 0, invDy[first] < 0, invDz[first] < 0};
+        uint32_t occluded = 0;
+        PacketStackEntry stack[BVHStackSize];
+        int stackSize = 0;
+        stack[stackSize++] = {0, packet.activeMask};
+        while (stackSize > 0)
+        {
+            PacketStackEntry entry = stack[--stackSize];
+            const LinearBVHNode *node = &nodes[entry.node];
+            // rays already known to be occluded drop out of the packet
+            uint32_t mask = PacketBoundsMask<N>(node->bounds, packet, invDx, invDy, invDz,
+                                                entry.mask & ~occluded);
+            if (!mask)
+                continue;
+            if (node->nPrimitives > 0)
+            {
+                for (int i = 0; i < node->nPrimitives && mask; ++i)
+                {
+                    const PrimitiveRef &ref = refs[node->primitivesOffset + i];
+                    const Primitive *prim = primitives[ref.primitive].get();
+                    for (uint32_t m = mask; m; m &= m - 1)
+                    {
+                        int lane = CountTrailingZeros(m);
+                        if (prim->IntersectPPart(ref.part, packet.Get(lane)))
+                            occluded |= 1u << lane;
+                    }
+                    mask &= ~occluded;
+                }
+                if (occluded == packet.activeMask)
+                    break;
+            }
+            else if (dirIsNeg[node->axis])
+            {
+                stack[stackSize++] = {entry.node + 1, mask};
+                stack[stackSize++] = {node->secondChildOffset, mask};
+            }
+            else
+            {
+                stack[stackSize++] = {node->secondChildOffset, mask};
+                stack[stackSize++] = {entry.node + 1, mask};
+            }
+        }
+        return occluded;
+    }
+
+    void BVHAccel::IntersectStream(const RayStream &rays, HitStream *hits) const
+    {
+        constexpr int PacketSize = 16;
+        size_t nRays = rays.Size();
+        hits->Resize(nRays);
+        if (nRays == 0 || nodes.empty())
+            return;
+
+        // key = direction octant, then Morton order of the origin inside the scene bounds
+        const Bounds3f &sceneBounds = nodes[0].bounds;
+        std::vector<std::pair<uint64_t, uint32_t>> order(nRays);
+        ParallelFor(nRays, 4096, [&](int64_t begin, int64_t end)
+                    {
+            for (int64_t i = begin; i < end; ++i)
+            {
+                uint64_t octant = (rays.dx[i] < 0) | ((rays.dy[i] < 0) << 1) | ((rays.dz[i] < 0) << 2);
+                Vector3f o = sceneBounds.Offset(Point3f(rays.ox[i], rays.oy[i], rays.oz[i]));
+                auto quantize = [](Float v)
+                { return (uint32_t)(std::min(std::max(v, (Float)0), (Float)1) * 1023); };
+                uint32_t morton = EncodeMorton3(quantize(o.x), quantize(o.y), quantize(o.z));
+                order[i] = {(octant << 30) | morton, (uint32_t)i};
+            } });
+        std::sort(order.begin(), order.end());
+
+        int64_t nPackets = (nRays + PacketSize - 1) / PacketSize;
+        ParallelFor(nPackets, 64, [&](int64_t begin, int64_t end)
+                    {
+            for (int64_t p = begin; p < end; ++p)
+            {
+                RayPacket<PacketSize> packet;
+                HitPacket<PacketSize> packetHits;
+                size_t first = p * PacketSize;
+                int count = (int)std::min<size_t>(PacketSize, nRays - first);
+                for (int lane = 0; lane < count; ++lane)
+                    packet.Set(lane, rays.Get(order[first + lane].second));
+                IntersectPacket(packet, &packetHits);
+                for (uint32_t m = packetHits.hitMask; m; m &= m - 1)
+                {
+                    int lane = CountTrailingZeros(m);
+                    size_t i = order[first + lane].second;
+                    hits->t[i] = packetHits.t[lane];
+                    hits->px[i] = packetHits.px[lane];
+                    hits->py[i] = packetHits.py[lane];
+                    hits->pz[i] = packetHits.pz[lane];
+                    hits->nx[i] = packetHits.nx[lane];
+                    hits->ny[i] = packetHits.ny[lane];
+                    hits->nz[i] = packetHits.nz[lane];
+                    hits->snx[i] = packetHits.snx[lane];
+                    hits->sny[i] = packetHits.sny[lane];
+                    hits->snz[i] = packetHits.snz[lane];
+                    hits->u[i] = packetHits.u[lane];
+                    hits->v[i] = packetHits.v[lane];
+                    hits->dpdux[i] = packetHits.dpdux[lane];
+                    hits->dpduy[i] = packetHits.dpduy[lane];
+                    hits->dpduz[i] = packetHits.dpduz[lane];
+                    hits->dpdvx[i] = packetHits.dpdvx[lane];
+                    hits->dpdvy[i] = packetHits.dpdvy[lane];
+                    hits->dpdvz[i] = packetHits.dpdvz[lane];
+                    hits->primitive[i] = packetHits.primitive[lane];
+                }
+            } });
+    }
+
+    template uint32_t BVHAccel::IntersectPacket(const RayPacket<8> &, HitPacket<8> *) const;
+    template uint32_t BVHAccel::IntersectPacket(const RayPacket<16> &, HitPacket<16> *) const;
+    template uint32_t BVHAccel::IntersectPacketP(const RayPacket<8> &) const;
+    template uint32_t BVHAccel::IntersectPacketP(const RayPacket<16> &) const;
+
+    void BVHAccel::Refit()
+    {
+        if (nodes.empty())
+            return;
+        auto startTime = std::chrono::steady_clock::now();
+        // leaves first, in parallel: they are the bulk of the work
+        ParallelFor(nodes.size(), 4096, [&](int64_t begin, int64_t end)
+                    {
+            for (int64_t i = begin; i < end; ++i)
+            {
+                LinearBVHNode &node = nodes[i];
+                if (node.nPrimitives == 0)
+                    continue;
+                Bounds3f b;
+                for (int j = 0; j < node.nPrimitives; ++j)
+                {
+                    const PrimitiveRef &ref = refs[node.primitivesOffset + j];
+                    b = Union(b, primitives[ref.primitive]->PartBound(ref.part));
+                }
+                node.bounds = b;
+            } });
+        // children always follow their parent, so a reverse sweep sees them first
+        Float sahCost = 0;
+        for (int i = (int)nodes.size() - 1; i >= 0; --i)
+        {
+            LinearBVHNode &node = nodes[i];
+            if (node.nPrimitives == 0)
+                node.bounds = Union(nodes[i + 1].bounds, nodes[node.secondChildOffset].bounds);
+            sahCost += node.bounds.SurfaceArea() *
+                       (node.nPrimitives > 0 ? node.nPrimitives * IntersectCost : TraversalCost);
+        }
+        // a growing cost tells the caller that a rebuild is due
+        Float rootArea = nodes[0].bounds.SurfaceArea();
+        stats.sahCost = sahCost / (rootArea > 0 ? rootArea : 1);
+        stats.refitTimeMs = std::chrono::duration<double, std::milli>(
+                                std::chrono::steady_clock::now() - startTime)
+                                .count();
+    }
+
+    std::string BVHAccel::BuildStats::ToString() const
+    {
+        std::ostringstream os;
+        os << "[ buildTimeMs=" << buildTimeMs << ", refitTimeMs=" << refitTimeMs << ", sahCost=" << sahCost
+           << ", totalNodes=" << totalNodes << ", leafNodes=" << leafNodes
+           << ", maxDepth=" << maxDepth << " ]";
+        return os.str();
+    }
+
+    // WideBVHAccel Method Definitions
+    template <int Width>
+    WideBVHAccel<Width>::WideBVHAccel(std::vector<std::shared_ptr<Primitive>> p, int maxPrimsInNode,
+                                      SplitMethod splitMethod)
+    {
+        BVHAccel binary(std::move(p), maxPrimsInNode, splitMethod);
+        stats = binary.GetBuildStats();
+        primitives = binary.GetPrimitives();
+        refs = binary.GetPrimitiveRefs();
+        worldBound = binary.WorldBound();
+        const Buffer<LinearBVHNode> &binaryNodes = binary.GetNodes();
+        if (binaryNodes.empty())
+            return;
+
+        auto startTime = std::chrono::steady_clock::now();
+        nodes.reserve(binaryNodes.size() / (Width / 2) + 1);
+        if (binaryNodes[0].nPrimitives > 0)
+        {
+            // a single leaf still needs an inner node above it
+            WideBVHNode<Width> rootNode;
+            for (int i = 0; i < Width; ++i)
+            {
+                rootNode.child[i] = -1;
+                rootNode.nPrimitives[i] = 0;
+            }
+            rootNode.bounds.Set(0, binaryNodes[0].bounds);
+            rootNode.child[0] = binaryNodes[0].primitivesOffset;
+            rootNode.nPrimitives[0] = binaryNodes[0].nPrimitives;
+            nodes.push_back(rootNode);
+        }
+        else
+            collapse(binaryNodes, 0);
+        // the binary tree's numbers only carry over for the build time
+        Float rootArea = worldBound.SurfaceArea();
+        stats.sahCost = 0;
+        stats.totalNodes = stats.leafNodes = stats.maxDepth = 0;
+        CollectWideStats(nodes, 0, rootArea > 0 ? rootArea : 1, rootArea > 0 ? rootArea : 1, 0, &stats);
+        stats.buildTimeMs += std::chrono::duration<double, std::milli>(
+                                 std::chrono::steady_clock::now() - startTime)
+                                 .count();
+    }
+
+    template <int Width>
+    int WideBVHAccel<Width>::collapse(const Buffer<LinearBVHNode> &binaryNodes, int binaryIndex)
+    {
+        // open up the largest inner descendants until Width children are gathered
+        int children[Width];
+        int nChildren = 2;
+        children[0] = binaryIndex + 1;
+        children[1] = binaryNodes[binaryIndex].secondChildOffset;
+        while (nChildren < Width)
+        {
+            int best = -1;
+            Float bestArea = -1;
+            for (int i = 0; i < nChildren; ++i)
+            {
+                const LinearBVHNode &c = binaryNodes[children[i]];
+                if (c.nPrimitives == 0 && c.bounds.SurfaceArea() > bestArea)
+                {
+                    best = i;
+                    bestArea = c.bounds.SurfaceArea();
+                }
+            }
+            if (best < 0)
+                break;
+            int opened = children[best];
+            children[best] = opened + 1;
+            children[nChildren++] = binaryNodes[opened].secondChildOffset;
+        }
+
+        int nodeIndex = (int)nodes.size();
+        nodes.emplace_back();
+        for (int i = 0; i < Width; ++i)
+        {
+            int childIndex = -1;
+            uint16_t nPrimitives = 0;
+            if (i < nChildren)
+            {
+                const LinearBVHNode &c = binaryNodes[children[i]];
+                if (c.nPrimitives > 0)
+                {
+                    childIndex = c.primitivesOffset;
+                    nPrimitives = c.nPrimitives;
+                }
+                else
+                    childIndex = collapse(binaryNodes, children[i]);
+                nodes[nodeIndex].bounds.Set(i, c.bounds);
+            }
+            nodes[nodeIndex].child[i] = childIndex;
+            nodes[nodeIndex].nPrimitives[i] = nPrimitives;
+        }
+        return nodeIndex;
+    }
+
+    namespace
+    {
+        struct WideStackEntry
+        {
+            int32_t child;
+            uint16_t nPrimitives;
+            Float tNear;
+        };
+
+        // pushes the hit lanes far-to-near so that the nearest child is popped first
+        template <int Width>
+        void PushHitChildren(const WideBVHNode<Width> &node, int hitMask, const Float tNear[Width],
+                             WideStackEntry *stack, int *stackSize)
+        {
+            int base = *stackSize;
+            while (hitMask)
+            {
+                int lane = CountTrailingZeros(hitMask);
+                hitMask &= hitMask - 1;
+                WideStackEntry entry{node.child[lane], node.nPrimitives[lane], tNear[lane]};
+                int j = (*stackSize)++;
+                while (j > base && stack[j - 1].tNear < entry.tNear)
+                {
+                    stack[j] = stack[j - 1];
+                    --j;
+                }
+                stack[j] = entry;
+            }
+        }
+    }
+
+    template <int Width>
+    bool WideBVHAccel<Width>::Intersect(const Ray &ray, SurfaceInteraction *isect) const
+    {
+        if (nodes.empty())
+            return false;
+        bool hit = false;
+        Vector3f invDir(1 / ray.d.x, 1 / ray.d.y, 1 / ray.d.z);
+        int dirIsNeg[3] = {invDir.x < 0, invDir.y < 0, invDir.z < 0};
+        WideStackEntry stack[64 * (Width - 1)];
+        int stackSize = 0;
+        alignas(64) Float tNear[Width];
+        stack[stackSize++] = {0, 0, 0};
+        while (stackSize > 0)
+        {
+            const WideStackEntry entry = stack[--stackSize];
+            // entries behind the closest hit so far can be culled
+            if (entry.tNear > ray.tMax)
+                continue;
+            if (entry.nPrimitives > 0)
+            {
+                for (int i = 0; i < entry.nPrimitives; ++i)
+                {
+                    const PrimitiveRef &ref = refs[entry.child + i];
+                    if (primitives[ref.primitive]->IntersectPart(ref.part, ray, isect))
+                        hit = true;
+                }
+                continue;
+            }
+            const WideBVHNode<Width> &node = nodes[entry.child];
+            int hitMask = node.bounds.IntersectP(ray, invDir, dirIsNeg, tNear);
+            PushHitChildren(node, hitMask, tNear, stack, &stackSize);
+        }
+        return hit;
+    }
+
+    template <int Width>
+    bool WideBVHAccel<Width>::IntersectP(const Ray &ray) const
+    {
+        if (nodes.empty())
+            return false;
+        Vector3f invDir(1 / ray.d.x, 1 / ray.d.y, 1 / ray.d.z);
+        int dirIsNeg[3] = {invDir.x < 0, invDir.y < 0, invDir.z < 0};
+        int stack[64 * (Width - 1)];
+        int stackSize = 0;
+        stack[stackSize++] = 0;
+        while (stackSize > 0)
+        {
+            const WideBVHNode<Width> &node = nodes[stack[--stackSize]];
+            int hitMask = node.bounds.IntersectP(ray, invDir, dirIsNeg);
+            while (hitMask)
+            {
+                int lane = CountTrailingZeros(hitMask);
+                hitMask &= hitMask - 1;
+                if (node.nPrimitives[lane] == 0)
+                {
+                    stack[stackSize++] = node.child[lane];
+                    continue;
+                }
+                for (int i = 0; i < node.nPrimitives[lane]; ++i)
+                {
+                    const PrimitiveRef &ref = refs[node.child[lane] + i];
+                    if (primitives[ref.primitive]->IntersectPPart(ref.part, ray))
+                        return true;
+                }
+            }
+        }
+        return false;
+    }
+
+    template <int Width>
+    void WideBVHAccel<Width>::Refit()
+    {
+        if (nodes.empty())
+            return;
+        auto startTime = std::chrono::steady_clock::now();
+        // leaf lanes first, in parallel: they are the bulk of the work
+        ParallelFor(nodes.size(), 1024, [&](int64_t begin, int64_t end)
+                    {
+            for (int64_t i = begin; i < end; ++i)
+            {
+                WideBVHNode<Width> &node = nodes[i];
+                for (int lane = 0; lane < Width; ++lane)
+                {
+                    if (node.nPrimitives[lane] == 0)
+                        continue;
+                    Bounds3f b;
+                    for (int j = 0; j < node.nPrimitives[lane]; ++j)
+                    {
+                        const PrimitiveRef &ref = refs[node.child[lane] + j];
+                        b = Union(b, primitives[ref.primitive]->PartBound(ref.part));
+                    }
+                    node.bounds.Set(lane, b);
+                }
+            } });
+        // child nodes are emitted after their parent, so a reverse sweep sees them first
+        for (int i = (int)nodes.size() - 1; i >= 0; --i)
+        {
+            WideBVHNode<Width> &node = nodes[i];
+            for (int lane = 0; lane < Width; ++lane)
+            {
+                if (node.nPrimitives[lane] > 0 || node.child[lane] < 0)
+                    continue;
+                const WideBVHNode<Width> &child = nodes[node.child[lane]];
+                Bounds3f b;
+                for (int c = 0; c < Width; ++c)
+                    if (child.child[c] >= 0)
+                        b = Union(b, child.bounds.Get(c));
+                node.bounds.Set(lane, b);
+            }
+        }
+        worldBound = Bounds3f();
+        for (int lane = 0; lane < Width; ++lane)
+            if (nodes[0].child[lane] >= 0)
+                worldBound = Union(worldBound, nodes[0].bounds.Get(lane));
+        // a growing cost tells the caller that a rebuild is due
+        Float rootArea = worldBound.SurfaceArea();
+        stats.sahCost = 0;
+        stats.totalNodes = stats.leafNodes = stats.maxDepth = 0;
+        CollectWideStats(nodes, 0, rootArea > 0 ? rootArea : 1, rootArea > 0 ? rootArea : 1, 0, &stats);
+        stats.refitTimeMs = std::chrono::duration<double, std::milli>(
+                                std::chrono::steady_clock::now() - startTime)
+                                .count();
+    }
+
+    template class WideBVHAccel<4>;
+    template class WideBVHAccel<8>;
+    template class WideBVHAccel<16>;
+
+    // MotionBVHAccel Method Definitions
+    namespace
+    {
+        inline Bounds3f LerpBounds(Float t, const Bounds3f &b0, const Bounds3f &b1)
+        {
+            Bounds3f b;
+            b.pMin = Point3f(Lerp(t, b0.pMin.x, b1.pMin.x), Lerp(t, b0.pMin.y, b1.pMin.y),
+                             Lerp(t, b0.pMin.z, b1.pMin.z));
+            b.pMax = Point3f(Lerp(t, b0.pMax.x, b1.pMax.x), Lerp(t, b0.pMax.y, b1.pMax.y),
+                             Lerp(t, b0.pMax.z, b1.pMax.z));
+            return b;
+        }
+    }
+
+    MotionBVHAccel::MotionBVHAccel(std::vector<std::shared_ptr<Primitive>> p, int maxPrimsInNode,
+                                   SplitMethod splitMethod)
+    {
+        // topology from the shutter-wide bounds, keys filled in by the refit
+        BVHAccel binary(std::move(p), maxPrimsInNode, splitMethod);
+        stats = binary.GetBuildStats();
+        primitives = binary.GetPrimitives();
+        refs = binary.GetPrimitiveRefs();
+        auto startTime = std::chrono::steady_clock::now();
+        const Buffer<LinearBVHNode> &binaryNodes = binary.GetNodes();
+        nodes.resize(binaryNodes.size());
+        for (size_t i = 0; i < binaryNodes.size(); ++i)
+        {
+            nodes[i].primitivesOffset = binaryNodes[i].primitivesOffset;
+            nodes[i].nPrimitives = binaryNodes[i].nPrimitives;
+            nodes[i].axis = binaryNodes[i].axis;
+        }
+        Refit();
+        stats.buildTimeMs += std::chrono::duration<double, std::milli>(
+                                 std::chrono::steady_clock::now() - startTime)
+                                 .count();
+    }
+
+    void MotionBVHAccel::Refit()
+    {
+        if (nodes.empty())
+            return;
+        auto startTime = std::chrono::steady_clock::now();
+        ParallelFor(nodes.size(), 4096, [&](int64_t begin, int64_t end)
+                    {
+            for (int64_t i = begin; i < end; ++i)
+            {
+                LinearMotionBVHNode &node = nodes[i];
+                if (node.nPrimitives == 0)
+                    continue;
+                Bounds3f b0, b1;
+                for (int j = 0; j < node.nPrimitives; ++j)
+                {
+                    const PrimitiveRef &ref = refs[node.primitivesOffset + j];
+                    const Primitive *prim = primitives[ref.primitive].get();
+                    b0 = Union(b0, prim->PartBoundAt(ref.part, 0));
+                    b1 = Union(b1, prim->PartBoundAt(ref.part, 1));
+                }
+                node.bounds0 = b0;
+                node.bounds1 = b1;
+            } });
+        for (int i = (int)nodes.size() - 1; i >= 0; --i)
+        {
+            LinearMotionBVHNode &node = nodes[i];
+            if (node.nPrimitives > 0)
+                continue;
+            node.bounds0 = Union(nodes[i + 1].bounds0, nodes[node.secondChildOffset].bounds0);
+            node.bounds1 = Union(nodes[i + 1].bounds1, nodes[node.secondChildOffset].bounds1);
+        }
+        stats.refitTimeMs = std::chrono::duration<double, std::milli>(
+                                std::chrono::steady_clock::now() - startTime)
+                                .count();
+    }
+
+    Bounds3f MotionBVHAccel::WorldBound() const
+    {
+        return nodes.empty() ? Bounds3f() : Union(nodes[0].bounds0, nodes[0].bounds1);
+    }
+
+    Bounds3f MotionBVHAccel::WorldBoundAt(Float time) const
+    {
+        return nodes.empty() ? Bounds3f() : LerpBounds(time, nodes[0].bounds0, nodes[0].bounds1);
+    }
+
+    bool MotionBVHAccel::Intersect(const Ray &ray, SurfaceInteraction *isect) const
+    {
+        if (nodes.empty())
+            return false;
+        bool hit = false;
+        Vector3f invDir(1 / ray.d.x, 1 / ray.d.y, 1 / ray.d.z);
+        int dirIsNeg[3] = {invDir.x < 0, invDir.y < 0, invDir.z < 0};
+        int toVisitOffset = 0, currentNodeIndex = 0;
+        int nodesToVisit[BVHStackSize];
+        while (true)
+        {
+            const LinearMotionBVHNode *node = &nodes[currentNodeIndex];
+            // linear vertex motion stays inside the interpolated boxes
+            if (LerpBounds(ray.time, node->bounds0, node->bounds1).IntersectP(ray, invDir, dirIsNeg))
+            {
+                if (node->nPrimitives > 0)
+                {
+                    for (int i = 0; i < node->nPrimitives; ++i)
+                    {
+                        const PrimitiveRef &ref = refs[node->primitivesOffset + i];
+                        if (primitives[ref.primitive]->IntersectPart(ref.part, ray, isect))
+                            hit = true;
+                    }
+                    if (toVisitOffset == 0)
+                        break;
+                    currentNodeIndex = nodesToVisit[--toVisitOffset];
+                }
+                else if (dirIsNeg[node->axis])
+                {
+                    nodesToVisit[toVisitOffset++] = currentNodeIndex + 1;
+                    currentNodeIndex = node->secondChildOffset;
+                }
+                else
+                {
+                    nodesToVisit[toVisitOffset++] = node->secondChildOffset;
+                    currentNodeIndex = currentNodeIndex + 1;
+                }
+            }
+            else
+            {
+                if (toVisitOffset == 0)
+                    break;
+                currentNodeIndex = nodesToVisit[--toVisitOffset];
+            }
+        }
+        return hit;
+    }
+
+    bool MotionBVHAccel::IntersectP(const Ray &ray) const
+    {
+        if (nodes.empty())
+            return false;
+        Vector3f invDir(1 / ray.d.x, 1 / ray.d.y, 1 / ray.d.z);
+        int dirIsNeg[3] = {invDir.x < 0, invDir.y < 0, invDir.z < 0};
+        int toVisitOffset = 0, currentNodeIndex = 0;
+        int nodesToVisit[BVHStackSize];
+        while (true)
+        {
+            const LinearMotionBVHNode *node = &nodes[currentNodeIndex];
+            if (LerpBounds(ray.time, node->bounds0, node->bounds1).IntersectP(ray, invDir, dirIsNeg))
+            {
+                if (node->nPrimitives > 0)
+                {
+                    for (int i = 0; i < node->nPrimitives; ++i)
+                    {
+                        const PrimitiveRef &ref = refs[node->primitivesOffset + i];
+                        if (primitives[ref.primitive]->IntersectPPart(ref.part, ray))
+                            return true;
+                    }
+                    if (toVisitOffset == 0)
+                        break;
+                    currentNodeIndex = nodesToVisit[--toVisitOffset];
+                }
+                else if (dirIsNeg[node->axis])
+                {
+                    nodesToVisit[toVisitOffset++] = currentNodeIndex + 1;
+                    currentNodeIndex = node->secondChildOffset;
+                }
+                else
+                {
+                    nodesToVisit[toVisitOffset++] = node->secondChildOffset;
+                    currentNodeIndex = currentNodeIndex + 1;
+                }
+            }
+            else
+            {
+                if (toVisitOffset == 0)
+                    break;
+                currentNodeIndex = nodesToVisit[--toVisitOffset];
+            }
+        }
+        return false;
+    }
+}
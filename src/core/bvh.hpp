@@ -0,0 +1,205 @@
+#pragma once
+/***
+ *  BVHAccel
+ *  binned-SAH bounding volume hierarchy over primitives
+ */
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <vector>
+#include <utils/buffer.hpp>
+#include <core/primitive.hpp>
+#include <core/raypacket.hpp>
+namespace reina
+{
+    struct BVHBuildNode;
+    struct BVHPrimitiveInfo;
+
+    // entries of the traversal stacks; a tree deeper than this cannot be traversed
+    constexpr int BVHStackSize = 64;
+
+    // depth-first flattened node: the first child directly follows its parent
+    struct alignas(32) LinearBVHNode
+    {
+        Bounds3f bounds;
+        union
+        {
+            int primitivesOffset;  // leaf
+            int secondChildOffset; // interior
+        };
+        uint16_t nPrimitives; // 0 -> interior node
+        uint8_t axis;         // interior node: split axis
+        uint8_t pad[1];
+    };
+#ifndef REINA_FLOAT_AS_DOUBLE
+    static_assert(sizeof(LinearBVHNode) == 32, "LinearBVHNode should fill half a cache line");
+#endif
+
+    // what a leaf slot holds: one part of a primitive, see Primitive::NumParts()
+    struct PrimitiveRef
+    {
+        int32_t primitive, part;
+    };
+
+    enum class SplitMethod
+    {
+        SAH,   // binned SAH, best traversal speed
+        LBVH,  // Morton-ordered linear build, fastest build
+        HLBVH, // Morton treelets joined by SAH at the top
+    };
+    // "sah", "lbvh" or "hlbvh"; throws std::invalid_argument otherwise
+    SplitMethod ParseSplitMethod(const std::string &name);
+
+    class BVHAccel : public Aggregate
+    {
+    public:
+        struct BuildStats
+        {
+            double buildTimeMs = 0;
+            // expected cost of a random ray, relative to one primitive test
+            Float sahCost = 0;
+            int totalNodes = 0;
+            int leafNodes = 0;
+            int maxDepth = 0;
+            double refitTimeMs = 0;
+            std::string ToString() const;
+        };
+
+        // BVHAccel Public Methods
+        BVHAccel(std::vector<std::shared_ptr<Primitive>> p, int maxPrimsInNode = 4,
+                 SplitMethod splitMethod = SplitMethod::SAH);
+        // adopts a hierarchy flattened earlier, e.g. mapped from a BVH cache; refs are in leaf order
+        // and index p
+        BVHAccel(std::vector<std::shared_ptr<Primitive>> p, Buffer<PrimitiveRef> refs,
+                 Buffer<LinearBVHNode> nodes, const BuildStats &stats, int maxPrimsInNode,
+                 SplitMethod splitMethod);
+        ~BVHAccel();
+        Bounds3f WorldBound() const override;
+        bool Intersect(const Ray &ray, SurfaceInteraction *isect) const override;
+        bool IntersectP(const Ray &ray) const override;
+        // packet traversal: returns the mask of active lanes that hit (resp. are occluded)
+        template <int N>
+        uint32_t IntersectPacket(const RayPacket<N> &packet, HitPacket<N> *hits) const;
+        template <int N>
+        uint32_t IntersectPacketP(const RayPacket<N> &packet) const;
+        // sorts the rays into coherent packets, traces them and scatters hits back in input order
+        void IntersectStream(const RayStream &rays, HitStream *hits) const;
+        // recomputes node bounds bottom-up after primitives moved; the topology is kept
+        void Refit();
+        const BuildStats &GetBuildStats() const { return stats; }
+        const Buffer<LinearBVHNode> &GetNodes() const { return nodes; }
+        int MaxPrimsInNode() const { return maxPrimsInNode; }
+        SplitMethod GetSplitMethod() const { return splitMethod; }
+        // in the order they were given
+        const std::vector<std::shared_ptr<Primitive>> &GetPrimitives() const { return primitives; }
+        // the leaves' primitive parts, in leaf order
+        const Buffer<PrimitiveRef> &GetPrimitiveRefs() const { return refs; }
+
+    private:
+        // BVHAccel Private Methods
+        std::unique_ptr<BVHBuildNode> recursiveBuild(std::vector<BVHPrimitiveInfo> &primitiveInfo,
+                                                     int start, int end, int depth);
+        std::unique_ptr<BVHBuildNode> lbvhBuild(std::vector<BVHPrimitiveInfo> &primitiveInfo);
+        int flattenBVHTree(const BVHBuildNode *node, int *offset);
+
+        // BVHAccel Private Data
+        const int maxPrimsInNode;
+        const SplitMethod splitMethod;
+        std::vector<std::shared_ptr<Primitive>> primitives;
+        Buffer<PrimitiveRef> refs;
+        Buffer<LinearBVHNode> nodes;
+        BuildStats stats;
+    };
+
+    // wide node: Width children whose bounds are tested with one SIMD slab test
+    template <int Width>
+    struct WideBVHNode
+    {
+        WideBounds3f<Width> bounds;
+        // nPrimitives[i] == 0: child[i] is an inner node index (-1 for an empty lane)
+        // nPrimitives[i] > 0: child[i] is the leaf's first primitive reference
+        int32_t child[Width];
+        uint16_t nPrimitives[Width];
+    };
+
+    /***
+     *  WideBVHAccel
+     *  binary SAH BVH collapsed into Width-ary nodes (BVH4/BVH8/BVH16)
+     */
+    template <int Width>
+    class WideBVHAccel : public Aggregate
+    {
+        static_assert(Width == 4 || Width == 8 || Width == 16, "WideBVHAccel supports 4, 8 or 16 children");
+
+    public:
+        // WideBVHAccel Public Methods
+        WideBVHAccel(std::vector<std::shared_ptr<Primitive>> p, int maxPrimsInNode = 4,
+                     SplitMethod splitMethod = SplitMethod::SAH);
+        Bounds3f WorldBound() const override { return worldBound; }
+        bool Intersect(const Ray &ray, SurfaceInteraction *isect) const override;
+        bool IntersectP(const Ray &ray) const override;
+        void Refit();
+        const BVHAccel::BuildStats &GetBuildStats() const { return stats; }
+
+    private:
+        // WideBVHAccel Private Methods
+        int collapse(const Buffer<LinearBVHNode> &binaryNodes, int binaryIndex);
+
+        // WideBVHAccel Private Data
+        std::vector<std::shared_ptr<Primitive>> primitives;
+        Buffer<PrimitiveRef> refs;
+        std::vector<WideBVHNode<Width>> nodes;
+        Bounds3f worldBound;
+        BVHAccel::BuildStats stats;
+    };
+
+    // flattened node carrying its bounds at shutter open and close
+    struct alignas(64) LinearMotionBVHNode
+    {
+        Bounds3f bounds0, bounds1;
+        union
+        {
+            int primitivesOffset;
+            int secondChildOffset;
+        };
+        uint16_t nPrimitives;
+        uint8_t axis;
+        uint8_t pad[1];
+    };
+
+    /***
+     *  MotionBVHAccel
+     *  BVH whose node bounds are interpolated by ray.time, for moving primitives
+     */
+    class MotionBVHAccel : public Aggregate
+    {
+    public:
+        // MotionBVHAccel Public Methods
+        MotionBVHAccel(std::vector<std::shared_ptr<Primitive>> p, int maxPrimsInNode = 4,
+                       SplitMethod splitMethod = SplitMethod::SAH);
+        Bounds3f WorldBound() const override;
+        Bounds3f WorldBoundAt(Float time) const override;
+        bool Intersect(const Ray &ray, SurfaceInteraction *isect) const override;
+        bool IntersectP(const Ray &ray) const override;
+        // re-evaluates both time keys bottom-up, for the next frame's motion
+        void Refit();
+        const BVHAccel::BuildStats &GetBuildStats() const { return stats; }
+
+    private:
+        // MotionBVHAccel Private Data
+        std::vector<std::shared_ptr<Primitive>> primitives;
+        Buffer<PrimitiveRef> refs;
+        std::vector<LinearMotionBVHNode> nodes;
+        BVHAccel::BuildStats stats;
+    };
+
+    // vector width of the default wide BVH, overridable with -DREINA_BVH_WIDTH=4|8|16
+#ifndef REINA_BVH_WIDTH
+#if defined(__AVX__) && !defined(REINA_FLOAT_AS_DOUBLE)
+#define REINA_BVH_WIDTH 8
+#else
+#define REINA_BVH_WIDTH 4
+#endif
+#endif
+    using WideBVH = WideBVHAccel<REINA_BVH_WIDTH>;
+}
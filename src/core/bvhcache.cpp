@@ -0,0 +1,364 @@
+#include <core/bvhcache.hpp>
+#include <utils/mappedfile.hpp>
+#include <chrono>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <limits>
+namespace reina
+{
+    namespace
+    {
+        // every section starts on a cache line, which also satisfies LinearBVHNode's alignment
+        constexpr uint64_t SectionAlignment = 64;
+        constexpr char Magic[8] = {'R', 'E', 'I', 'N', 'A', 'B', 'V', 'H'};
+        constexpr int nMeshBuffers = 17;
+
+        struct BVHCacheHeader
+        {
+            char magic[8];
+            uint32_t version;
+            uint32_t floatSize;
+            uint32_t nodeSize;
+            int32_t maxPrimsInNode;
+            int32_t splitMethod;
+            uint32_t pad;
+            uint64_t sceneHash;
+            uint64_t fileSize;
+            uint64_t nNodes, nPrimitives, nMeshes;
+            uint64_t nodesOffset, refsOffset, meshesOffset;
+            // BuildStats of the cached build
+            double sahCost;
+            int32_t totalNodes, leafNodes, maxDepth, pad2;
+        };
+
+        struct BVHCacheMesh
+        {
+            int64_t nTriangles, nVertices;
+            // byte offset and element count of each buffer, in ForEachMeshBuffer() order
+            uint64_t offset[nMeshBuffers], count[nMeshBuffers];
+            // grid of the compressed positions
+            Float quantOrigin[3], quantStep[3];
+            // indices into the material and area light tables, -1 for none
+            int32_t materialId, areaLightId;
+        };
+
+        template <typename Mesh, typename F>
+        void ForEachMeshBuffer(Mesh &mesh, F f)
+        {
+            f(mesh.vertexIndices);
+            f(mesh.px);
+            f(mesh.py);
+            f(mesh.pz);
+            f(mesh.px1);
+            f(mesh.py1);
+            f(mesh.pz1);
+            f(mesh.nx);
+            f(mesh.ny);
+            f(mesh.nz);
+            f(mesh.u);
+            f(mesh.v);
+            f(mesh.edges);
+            f(mesh.pq);
+            f(mesh.pq1);
+            f(mesh.nq);
+            f(mesh.uvq);
+        }
+
+        // pads to the next section and writes; returns the section's offset
+        uint64_t WriteSection(std::ofstream &out, const void *data, uint64_t bytes)
+        {
+            static const char zeros[SectionAlignment] = {};
+            uint64_t offset = (uint64_t)out.tellp();
+            uint64_t padding = (SectionAlignment - offset % SectionAlignment) % SectionAlignment;
+            out.write(zeros, padding);
+            out.write((const char *)data, bytes);
+            return offset + padding;
+        }
+
+        template <typename T>
+        bool EmptyOr(const Buffer<T> &buffer, size_t size)
+        {
+            return buffer.empty() || buffer.size() == size;
+        }
+
+        // everything the accessors and intersectors index is in range
+        bool ValidateMesh(const TriangleMesh &mesh)
+        {
+            const size_t nv = mesh.nVertices, nt = mesh.nTriangles;
+            if (mesh.vertexIndices.size() != 3 * nt)
+                return false;
+            for (int index : mesh.vertexIndices)
+                if (index < 0 || index >= mesh.nVertices)
+                    return false;
+            // either Float or compressed positions, the rest optional in the same form
+            bool floatForm = mesh.px.size() == nv && mesh.py.size() == nv && mesh.pz.size() == nv;
+            bool compressedForm = mesh.px.empty() && mesh.py.empty() && mesh.pz.empty() && mesh.pq.size() == nv;
+            if (!floatForm && !compressedForm)
+                return false;
+            if (floatForm && !(mesh.pq.empty() && mesh.pq1.empty() && mesh.nq.empty() && mesh.uvq.empty()))
+                return false;
+            if (compressedForm && !(mesh.px1.empty() && mesh.nx.empty() && mesh.u.empty()))
+                return false;
+            return EmptyOr(mesh.px1, nv) && mesh.py1.size() == mesh.px1.size() &&
+                   mesh.pz1.size() == mesh.px1.size() && EmptyOr(mesh.nx, nv) &&
+                   mesh.ny.size() == mesh.nx.size() && mesh.nz.size() == mesh.nx.size() &&
+                   EmptyOr(mesh.u, nv) && mesh.v.size() == mesh.u.size() && EmptyOr(mesh.edges, nt) &&
+                   EmptyOr(mesh.pq1, nv) && EmptyOr(mesh.nq, nv) && EmptyOr(mesh.uvq, nv);
+        }
+
+        // a tree that traversal cannot leave: leaves in the primitive range, children after their
+        // parent, every node reached exactly once, no deeper than the traversal stacks
+        bool ValidateNodes(const Buffer<LinearBVHNode> &nodes, uint64_t nPrimitives)
+        {
+            if (nodes.empty())
+                return nPrimitives == 0;
+            std::vector<int> depth(nodes.size(), -1);
+            depth[0] = 0;
+            for (size_t i = 0; i < nodes.size(); ++i)
+            {
+                const LinearBVHNode &node = nodes[i];
+                if (depth[i] < 0)
+                    return false;
+                if (node.nPrimitives > 0)
+                {
+                    if (node.primitivesOffset < 0 || (uint64_t)node.primitivesOffset + node.nPrimitives > nPrimitives)
+                        return false;
+                    continue;
+                }
+                if (node.axis > 2 || node.secondChildOffset <= (int64_t)i + 1 ||
+                    (size_t)node.secondChildOffset >= nodes.size() || depth[i] + 1 >= BVHStackSize)
+                    return false;
+                for (size_t child : {i + 1, (size_t)node.secondChildOffset})
+                {
+                    if (depth[child] >= 0)
+                        return false;
+                    depth[child] = depth[i] + 1;
+                }
+            }
+            return true;
+        }
+
+        template <typename T>
+        bool MapSection(const std::shared_ptr<MappedFile> &file, uint64_t offset, uint64_t count, Buffer<T> *buffer)
+        {
+            if (offset % SectionAlignment != 0 || offset > file->Size() ||
+                count > (file->Size() - offset) / sizeof(T))
+                return false;
+            *buffer = count ? Buffer<T>((T *)(file->Data() + offset), count, file) : Buffer<T>();
+            return true;
+        }
+
+        // index of p in table, -1 for null and -2 when it is not listed
+        template <typename T>
+        int32_t TableIndex(const std::vector<std::shared_ptr<const T>> &table, const T *p)
+        {
+            if (!p)
+                return -1;
+            for (size_t i = 0; i < table.size(); ++i)
+                if (table[i].get() == p)
+                    return (int32_t)i;
+            return -2;
+        }
+    }
+
+    uint64_t HashBytes(const void *data, size_t size, uint64_t seed)
+    {
+        const uint8_t *bytes = (const uint8_t *)data;
+        uint64_t hash = seed;
+        for (size_t i = 0; i < size; ++i)
+        {
+            hash ^= bytes[i];
+            hash *= 1099511628211ull;
+        }
+        return hash;
+    }
+
+    uint64_t HashFile(const std::string &filename, uint64_t seed)
+    {
+        std::shared_ptr<MappedFile> file = MappedFile::Open(filename);
+        if (!file)
+            return 0;
+        return HashBytes(file->Data(), file->Size(), seed);
+    }
+
+    uint64_t HashMeshes(const std::vector<std::shared_ptr<TriangleMesh>> &meshes, uint64_t seed)
+    {
+        uint64_t hash = seed;
+        for (const auto &mesh : meshes)
+            ForEachMeshBuffer(*mesh, [&](const auto &buffer)
+                              {
+                uint64_t count = buffer.size();
+                hash = HashBytes(&count, sizeof(count), hash);
+                hash = HashBytes(buffer.data(), count * sizeof(buffer[0]), hash); });
+        for (const auto &mesh : meshes)
+            if (mesh->IsCompressed())
+            {
+                Float grid[6] = {mesh->quantOrigin.x, mesh->quantOrigin.y, mesh->quantOrigin.z,
+                                 mesh->quantStep.x, mesh->quantStep.y, mesh->quantStep.z};
+                hash = HashBytes(grid, sizeof(grid), hash);
+            }
+        return hash;
+    }
+
+    bool WriteBVHCache(const std::string &filename, uint64_t sceneHash,
+                       const std::vector<std::shared_ptr<TriangleMesh>> &meshes, const BVHAccel &bvh,
+                       const std::vector<std::shared_ptr<const Material>> &materials,
+                       const std::vector<std::shared_ptr<const AreaLight>> &areaLights)
+    {
+        // the leaves' (mesh, triangle) refs are written as they are, so the primitives must be the
+        // meshes, in order
+        const std::vector<std::shared_ptr<Primitive>> &prims = bvh.GetPrimitives();
+        if (prims.size() != meshes.size())
+            return false;
+        std::vector<BVHCacheMesh> meshRecords(meshes.size());
+        for (size_t m = 0; m < meshes.size(); ++m)
+        {
+            const auto *mp = dynamic_cast<const MeshPrimitive *>(prims[m].get());
+            if (!mp || mp->GetMesh() != meshes[m])
+                return false;
+            meshRecords[m].materialId = TableIndex(materials, mp->GetMaterial());
+            meshRecords[m].areaLightId = TableIndex(areaLights, mp->GetAreaLight());
+            if (meshRecords[m].materialId < -1 || meshRecords[m].areaLightId < -1)
+                return false;
+        }
+        const Buffer<PrimitiveRef> &refs = bvh.GetPrimitiveRefs();
+
+        std::string tempName = filename + ".tmp";
+        std::ofstream out(tempName, std::ios::binary | std::ios::trunc);
+        if (!out)
+            return false;
+        BVHCacheHeader header = {};
+        std::memcpy(header.magic, Magic, sizeof(Magic));
+        header.version = BVHCacheVersion;
+        header.floatSize = sizeof(Float);
+        header.nodeSize = sizeof(LinearBVHNode);
+        header.maxPrimsInNode = bvh.MaxPrimsInNode();
+        header.splitMethod = (int32_t)bvh.GetSplitMethod();
+        header.sceneHash = sceneHash;
+        header.nNodes = bvh.GetNodes().size();
+        header.nPrimitives = refs.size();
+        header.nMeshes = meshes.size();
+        const BVHAccel::BuildStats &stats = bvh.GetBuildStats();
+        header.sahCost = stats.sahCost;
+        header.totalNodes = stats.totalNodes;
+        header.leafNodes = stats.leafNodes;
+        header.maxDepth = stats.maxDepth;
+        out.write((const char *)&header, sizeof(header));
+
+        header.nodesOffset = WriteSection(out, bvh.GetNodes().data(), header.nNodes * sizeof(LinearBVHNode));
+        header.refsOffset = WriteSection(out, refs.data(), refs.size() * sizeof(PrimitiveRef));
+        for (size_t m = 0; m < meshes.size(); ++m)
+        {
+            BVHCacheMesh &record = meshRecords[m];
+            record.nTriangles = meshes[m]->nTriangles;
+            record.nVertices = meshes[m]->nVertices;
+            for (int axis = 0; axis < 3; ++axis)
+            {
+                record.quantOrigin[axis] = meshes[m]->quantOrigin[axis];
+                record.quantStep[axis] = meshes[m]->quantStep[axis];
+            }
+            int b = 0;
+            ForEachMeshBuffer(*meshes[m], [&](const auto &buffer)
+                              {
+                record.count[b] = buffer.size();
+                record.offset[b] = WriteSection(out, buffer.data(), buffer.size() * sizeof(buffer[0]));
+                ++b; });
+        }
+        header.meshesOffset = WriteSection(out, meshRecords.data(), meshRecords.size() * sizeof(BVHCacheMesh));
+        header.fileSize = (uint64_t)out.tellp();
+        out.seekp(0);
+        out.write((const char *)&header, sizeof(header));
+        out.close();
+        if (!out)
+        {
+            std::remove(tempName.c_str());
+            return false;
+        }
+        // readers never see a partially written cache
+        std::remove(filename.c_str());
+        return std::rename(tempName.c_str(), filename.c_str()) == 0;
+    }
+
+    bool LoadBVHCache(const std::string &filename, uint64_t sceneHash,
+                      const std::vector<std::shared_ptr<const Material>> &materials,
+                      const BVHCacheAreaLightFactory &createAreaLight, BVHCacheScene *scene)
+    {
+        auto startTime = std::chrono::steady_clock::now();
+        std::shared_ptr<MappedFile> file = MappedFile::Open(filename);
+        if (!file || file->Size() < sizeof(BVHCacheHeader))
+            return false;
+        BVHCacheHeader header;
+        std::memcpy(&header, file->Data(), sizeof(header));
+        if (std::memcmp(header.magic, Magic, sizeof(Magic)) != 0 || header.version != BVHCacheVersion ||
+            header.floatSize != sizeof(Float) || header.nodeSize != sizeof(LinearBVHNode) ||
+            header.sceneHash != sceneHash || header.fileSize != file->Size() ||
+            header.nPrimitives > (uint64_t)std::numeric_limits<int>::max())
+            return false;
+
+        Buffer<LinearBVHNode> nodes;
+        Buffer<PrimitiveRef> refs;
+        Buffer<BVHCacheMesh> meshRecords;
+        if (!MapSection(file, header.nodesOffset, header.nNodes, &nodes) ||
+            !MapSection(file, header.refsOffset, header.nPrimitives, &refs) ||
+            !MapSection(file, header.meshesOffset, header.nMeshes, &meshRecords) ||
+            !ValidateNodes(nodes, header.nPrimitives))
+            return false;
+
+        std::vector<std::shared_ptr<TriangleMesh>> meshes;
+        meshes.reserve(header.nMeshes);
+        for (const BVHCacheMesh &record : meshRecords)
+        {
+            if (record.nTriangles < 0 || record.nTriangles > std::numeric_limits<int>::max() / 3 ||
+                record.nVertices < 0 || record.nVertices > std::numeric_limits<int>::max())
+                return false;
+            auto mesh = std::make_shared<TriangleMesh>((int)record.nTriangles, (int)record.nVertices);
+            int b = 0;
+            bool ok = true;
+            ForEachMeshBuffer(*mesh, [&](auto &buffer)
+                              {
+                ok = ok && MapSection(file, record.offset[b], record.count[b], &buffer);
+                ++b; });
+            if (!ok || !ValidateMesh(*mesh))
+                return false;
+            for (int axis = 0; axis < 3; ++axis)
+            {
+                mesh->quantOrigin[axis] = record.quantOrigin[axis];
+                mesh->quantStep[axis] = record.quantStep[axis];
+            }
+            meshes.push_back(std::move(mesh));
+        }
+
+        for (const PrimitiveRef &ref : refs)
+            if (ref.primitive < 0 || (size_t)ref.primitive >= meshes.size() || ref.part < 0 ||
+                ref.part >= meshes[ref.primitive]->nTriangles)
+                return false;
+        std::vector<std::shared_ptr<Primitive>> prims;
+        prims.reserve(meshes.size());
+        for (size_t m = 0; m < meshes.size(); ++m)
+        {
+            const BVHCacheMesh &record = meshRecords[m];
+            if (record.materialId < -1 || record.materialId >= (int64_t)materials.size() ||
+                record.areaLightId < -1 || (record.areaLightId >= 0 && !createAreaLight))
+                return false;
+            std::shared_ptr<const Material> material = record.materialId >= 0 ? materials[record.materialId] : nullptr;
+            std::shared_ptr<const AreaLight> areaLight;
+            if (record.areaLightId >= 0 && !(areaLight = createAreaLight(record.areaLightId, meshes[m])))
+                return false;
+            prims.push_back(std::make_shared<MeshPrimitive>(meshes[m], std::move(material), std::move(areaLight)));
+        }
+
+        BVHAccel::BuildStats stats;
+        stats.sahCost = (Float)header.sahCost;
+        stats.totalNodes = header.totalNodes;
+        stats.leafNodes = header.leafNodes;
+        stats.maxDepth = header.maxDepth;
+        stats.buildTimeMs = std::chrono::duration<double, std::milli>(
+                                std::chrono::steady_clock::now() - startTime)
+                                .count();
+        scene->meshes = std::move(meshes);
+        scene->bvh = std::make_shared<BVHAccel>(std::move(prims), std::move(refs), std::move(nodes), stats,
+                                                header.maxPrimsInNode, (SplitMethod)header.splitMethod);
+        return true;
+    }
+}
@@ -0,0 +1,53 @@
+#pragma once
+/***
+ *  BVH cache: a flattened BVHAccel and the triangle meshes under it in one versioned file.
+ *  Loading maps the file, range-checks the nodes and meshes once and traces from the mapped
+ *  pages; nothing is parsed or copied.
+ */
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <string>
+#include <vector>
+#include <core/bvh.hpp>
+#include <core/shapes.hpp>
+#include <core/light.hpp>
+namespace reina
+{
+    constexpr uint32_t BVHCacheVersion = 4;
+
+    // 64-bit FNV-1a; chain calls through seed
+    uint64_t HashBytes(const void *data, size_t size, uint64_t seed = 14695981039346656037ull);
+    // hash of a scene file's bytes, 0 if it cannot be read
+    uint64_t HashFile(const std::string &filename, uint64_t seed = 14695981039346656037ull);
+    // hash of the mesh buffers, for scenes built in code
+    uint64_t HashMeshes(const std::vector<std::shared_ptr<TriangleMesh>> &meshes,
+                        uint64_t seed = 14695981039346656037ull);
+
+    struct BVHCacheScene
+    {
+        std::vector<std::shared_ptr<TriangleMesh>> meshes;
+        std::shared_ptr<BVHAccel> bvh;
+    };
+
+    // makes the area light of a cached emissive mesh again, given the index the light had in the
+    // table passed to WriteBVHCache(); lights are built over the loaded meshes, so they are not tabled
+    using BVHCacheAreaLightFactory =
+        std::function<std::shared_ptr<const AreaLight>(int lightId, const std::shared_ptr<TriangleMesh> &mesh)>;
+
+    // bvh must have been built over one MeshPrimitive per mesh, in order. Each mesh's material and
+    // area light are stored as their index in materials and areaLights, so both must be listed
+    // there. The scene hash is the cache key: fold the build settings into it if they may change
+    // between runs. Returns false on I/O errors or a material or light missing from the tables.
+    bool WriteBVHCache(const std::string &filename, uint64_t sceneHash,
+                       const std::vector<std::shared_ptr<TriangleMesh>> &meshes, const BVHAccel &bvh,
+                       const std::vector<std::shared_ptr<const Material>> &materials = {},
+                       const std::vector<std::shared_ptr<const AreaLight>> &areaLights = {});
+    // false if the file is missing, damaged, written by another version or build, or for another
+    // scene hash, or if it names a material outside materials or has emissive meshes and no
+    // createAreaLight. The returned meshes and nodes view the mapping, which they keep alive.
+    bool LoadBVHCache(const std::string &filename, uint64_t sceneHash,
+                      const std::vector<std::shared_ptr<const Material>> &materials,
+                      const BVHCacheAreaLightFactory &createAreaLight, BVHCacheScene *scene);
+}
@@ -1 +1,74 @@
+#include <core/camera.hpp>
+namespace reina
+{
+    // Camera Method Definitions
+    Float Camera::GenerateRayDifferential(const CameraSample &sample, RayDifferential *rd) const
+    {
+        Float weight = GenerateRay(sample, rd);
+        rd->hasDifferentials = false;
+        if (weight == 0)
+            return 0;
+        CameraSample shifted = sample;
+        shifted.pFilm.x += 1;
+        Ray rx, ry;
+        if (GenerateRay(shifted, &rx) == 0)
+            return weight;
+        shifted.pFilm = Point2f(sample.pFilm.x, sample.pFilm.y + 1);
+        if (GenerateRay(shifted, &ry) == 0)
+            return weight;
+        rd->rxOrigin = rx.o;
+        rd->rxDirection = rx.d;
+        rd->ryOrigin = ry.o;
+        rd->ryDirection = ry.d;
+        rd->hasDifferentials = true;
+        return weight;
+    }
 
+    void Camera::Approximate_dp_dxy(const Point3f &p, const Normal3f &n, Float time, int samplesPerPixel,
+                                    Vector3f *dpdx, Vector3f *dpdy) const
+    {
+        *dpdx = *dpdy = Vector3f(0, 0, 0);
+        Point3f o = cameraToWorld(time, Point3f(0, 0, 0));
+        Vector3f w = p - o;
+        Float distance = w.Length();
+        if (pixelSpread == 0 || distance == 0)
+            return;
+        w = w / distance;
+        Vector3f s, t;
+        CoordinateSystem(w, &s, &t);
+        Float scale = 1 / std::sqrt((Float)samplesPerPixel);
+        Vector3f nv(n);
+        Float d = nv.Dot(p - o);
+        Vector3f *dp[2] = {dpdx, dpdy};
+        const Vector3f *axes[2] = {&s, &t};
+        for (int i = 0; i < 2; ++i)
+        {
+            // the offset ray leaves o as the camera ray does; grazing ones miss the plane
+            Vector3f dir = w + *axes[i] * pixelSpread;
+            Float tPlane = d / nv.Dot(dir);
+            if (std::isinf(tPlane) || std::isnan(tPlane) || tPlane <= 0)
+                continue;
+            *dp[i] = ((o + dir * tPlane) - p) * scale;
+        }
+    }
+
+    // PerspectiveCamera Method Definitions
+    PerspectiveCamera::PerspectiveCamera(const AnimatedTransform &cameraToWorld, std::shared_ptr<Film> film, Float fov)
+        : Camera(cameraToWorld, std::move(film))
+    {
+        Float aspect = (Float)this->film->fullResolution.x / this->film->fullResolution.y;
+        Float tanHalfFov = std::tan(Radians(fov) / 2);
+        screenX = tanHalfFov * (aspect > 1 ? aspect : 1);
+        screenY = tanHalfFov * (aspect > 1 ? 1 : 1 / aspect);
+        pixelSpread = 2 * screenY / this->film->fullResolution.y;
+    }
+
+    Float PerspectiveCamera::GenerateRay(const CameraSample &sample, Ray *ray) const
+    {
+        const Point2i &res = film->fullResolution;
+        Float sx = (2 * sample.pFilm.x / res.x - 1) * screenX;
+        Float sy = (1 - 2 * sample.pFilm.y / res.y) * screenY;
+        *ray = cameraToWorld(Ray(Point3f(0, 0, 0), Normalize(Vector3f(sx, sy, 1)), Infinity, sample.time));
+        return 1;
+    }
+}
@@ -1,10 +1,58 @@
 #pragma once
+/***
+ *  CameraSample
+ *  Camera
+ *  PerspectiveCamera
+ */
+#include <memory>
+#include <reina.hpp>
+#include <core/transform.hpp>
+#include <core/ray.hpp>
+#include <core/film.hpp>
 
 namespace reina
 {
+    struct CameraSample
+    {
+        Point2f pFilm; // raster space
+        Point2f pLens;
+        Float time = 0;
+    };
+
     class Camera
     {
     public:
+        // a moving cameraToWorld blurs with the rays' times over its shutter
+        Camera(const AnimatedTransform &cameraToWorld, std::shared_ptr<Film> film)
+            : cameraToWorld(cameraToWorld), film(std::move(film)) {}
         virtual ~Camera() = default;
+        // returns the sample's weight, 0 if it produced no ray
+        virtual Float GenerateRay(const CameraSample &sample, Ray *ray) const = 0;
+        // also traces the rays one pixel over in x and y, for texture footprints
+        virtual Float GenerateRayDifferential(const CameraSample &sample, RayDifferential *rd) const;
+        // the footprint of a pixel at p, on a surface with normal n, for rays without differentials:
+        // where two rays from the camera one pixel apart meet the tangent plane, scaled as camera ray
+        // differentials are for samplesPerPixel. Zero if pixelSpread is unknown
+        void Approximate_dp_dxy(const Point3f &p, const Normal3f &n, Float time, int samplesPerPixel,
+                                Vector3f *dpdx, Vector3f *dpdy) const;
+
+        // Camera Public Data
+        AnimatedTransform cameraToWorld;
+        std::shared_ptr<Film> film;
+        // tangent of the angle between the rays of neighbouring pixels at the image center, 0 if unknown
+        Float pixelSpread = 0;
+    };
+
+    // pinhole camera looking down +z; fov spans the shorter image axis
+    class PerspectiveCamera : public Camera
+    {
+    public:
+        // PerspectiveCamera Public Methods
+        PerspectiveCamera(const AnimatedTransform &cameraToWorld, std::shared_ptr<Film> film, Float fov);
+        Float GenerateRay(const CameraSample &sample, Ray *ray) const override;
+
+    private:
+        // PerspectiveCamera Private Data
+        Float screenX, screenY;
     };
-}
\ No newline at end of file
+}
@@ -0,0 +1,58 @@
+#include <core/film.hpp>
+#include <utils/imageio.hpp>
+namespace reina
+{
+    // Film Method Definitions
+    Film::Film(const Point2i &resolution, const std::string &filename)
+        : fullResolution(resolution), filename(filename),
+          pixels(new Pixel[(size_t)resolution.x * resolution.y])
+    {
+    }
+
+    std::unique_ptr<FilmTile> Film::GetFilmTile(const Bounds2i &tileBounds) const
+    {
+        Bounds2i bounds(Point2i(std::max(tileBounds.pMin.x, 0), std::max(tileBounds.pMin.y, 0)),
+                        Point2i(std::min(tileBounds.pMax.x, fullResolution.x),
+                                std::min(tileBounds.pMax.y, fullResolution.y)));
+        return std::make_unique<FilmTile>(bounds);
+    }
+
+    void Film::MergeFilmTile(std::unique_ptr<FilmTile> tile)
+    {
+        const Bounds2i &b = tile->pixelBounds;
+        for (int y = b.pMin.y; y < b.pMax.y; ++y)
+            for (int x = b.pMin.x; x < b.pMax.x; ++x)
+            {
+                const FilmTile::FilmTilePixel &tilePixel = tile->GetPixel(Point2i(x, y));
+                Pixel &pixel = pixels[(size_t)y * fullResolution.x + x];
+                for (int c = 0; c < 3; ++c)
+                    pixel.rgb[c] += tilePixel.contribSum[c];
+                pixel.filterWeightSum += tilePixel.filterWeightSum;
+            }
+    }
+
+    void Film::Clear()
+    {
+        for (size_t i = 0; i < (size_t)fullResolution.x * fullResolution.y; ++i)
+            pixels[i] = Pixel();
+    }
+
+    std::vector<Float> Film::GetRGB() const
+    {
+        size_t nPixels = (size_t)fullResolution.x * fullResolution.y;
+        std::vector<Float> rgb(3 * nPixels);
+        for (size_t i = 0; i < nPixels; ++i)
+        {
+            Float invWeight = pixels[i].filterWeightSum > 0 ? 1 / pixels[i].filterWeightSum : 0;
+            for (int c = 0; c < 3; ++c)
+                rgb[3 * i + c] = pixels[i].rgb[c] * invWeight;
+        }
+        return rgb;
+    }
+
+    bool Film::WriteImage() const
+    {
+        std::vector<Float> rgb = GetRGB();
+        return reina::WriteImage(filename, rgb.data(), fullResolution.x, fullResolution.y);
+    }
+}
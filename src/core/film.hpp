@@ -0,0 +1,84 @@
+#pragma once
+/***
+ *  Film
+ *  FilmTile
+ */
+#include <memory>
+#include <string>
+#include <vector>
+#include <reina.hpp>
+#include <utils/vecmath.hpp>
+#include <core/spectrum.hpp>
+namespace reina
+{
+    // box-filtered: a sample only touches the pixel it falls in, so tiles never overlap
+    class FilmTile
+    {
+    public:
+        // FilmTile Public Methods
+        FilmTile(const Bounds2i &pixelBounds)
+            : pixelBounds(pixelBounds), pixels(std::max(0, pixelBounds.Area())) {}
+        void AddSample(const Point2i &pixel, const Spectrum &L, Float weight = 1)
+        {
+            FilmTilePixel &p = GetPixel(pixel);
+            p.contribSum += L * weight;
+            p.filterWeightSum += weight;
+        }
+        const Bounds2i &GetPixelBounds() const { return pixelBounds; }
+
+    private:
+        struct FilmTilePixel
+        {
+            Spectrum contribSum = 0;
+            Float filterWeightSum = 0;
+        };
+        FilmTilePixel &GetPixel(const Point2i &p)
+        {
+            int width = pixelBounds.pMax.x - pixelBounds.pMin.x;
+            return pixels[(p.y - pixelBounds.pMin.y) * width + (p.x - pixelBounds.pMin.x)];
+        }
+
+        // FilmTile Private Data
+        const Bounds2i pixelBounds;
+        std::vector<FilmTilePixel> pixels;
+        friend class Film;
+    };
+
+    class Film
+    {
+    public:
+        // Film Public Methods
+        Film(const Point2i &resolution, const std::string &filename);
+        Bounds2i GetPixelBounds() const { return Bounds2i(Point2i(0, 0), fullResolution); }
+        std::unique_ptr<FilmTile> GetFilmTile(const Bounds2i &tileBounds) const;
+        // adds the tile's sums to the film; tiles merged concurrently must not overlap, each writes
+        // only its own pixels and no lock is taken
+        void MergeFilmTile(std::unique_ptr<FilmTile> tile);
+        // unsynchronized as well: concurrent callers must write distinct pixels
+        void AddSample(const Point2i &pixel, const Spectrum &L, Float weight = 1)
+        {
+            Pixel &p = pixels[(size_t)pixel.y * fullResolution.x + pixel.x];
+            for (int c = 0; c < 3; ++c)
+                p.rgb[c] += L[c] * weight;
+            p.filterWeightSum += weight;
+        }
+        void Clear();
+        // resolved RGB, top row first
+        std::vector<Float> GetRGB() const;
+        bool WriteImage() const;
+
+        // Film Public Data
+        const Point2i fullResolution;
+        const std::string filename;
+
+    private:
+        struct Pixel
+        {
+            Float rgb[3] = {0, 0, 0};
+            Float filterWeightSum = 0;
+        };
+
+        // Film Private Data
+        std::unique_ptr<Pixel[]> pixels;
+    };
+}
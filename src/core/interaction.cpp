@@ -0,0 +1,55 @@
+#include <core/interaction.hpp>
+#include <core/camera.hpp>
+namespace reina
+{
+    namespace
+    {
+        bool SolveLinearSystem2x2(const Float A[2][2], const Float B[2], Float *x0, Float *x1)
+        {
+            Float det = A[0][0] * A[1][1] - A[0][1] * A[1][0];
+            if (std::abs(det) < 1e-10f)
+                return false;
+            *x0 = (A[1][1] * B[0] - A[0][1] * B[1]) / det;
+            *x1 = (A[0][0] * B[1] - A[1][0] * B[0]) / det;
+            return !std::isnan(*x0) && !std::isnan(*x1);
+        }
+    }
+
+    // SurfaceInteraction Method Definitions
+    void SurfaceInteraction::ComputeDifferentials(const RayDifferential &ray, const Camera *camera,
+                                                  int samplesPerPixel)
+    {
+        dudx = dvdx = dudy = dvdy = 0;
+        dpdx = dpdy = Vector3f(0, 0, 0);
+        if (ray.hasDifferentials)
+        {
+            // where the offset rays meet the tangent plane
+            Float d = n.Dot(Vector3f(p));
+            Float tx = (d - n.Dot(Vector3f(ray.rxOrigin))) / n.Dot(ray.rxDirection);
+            Float ty = (d - n.Dot(Vector3f(ray.ryOrigin))) / n.Dot(ray.ryDirection);
+            if (std::isinf(tx) || std::isnan(tx) || std::isinf(ty) || std::isnan(ty))
+                return;
+            dpdx = (ray.rxOrigin + ray.rxDirection * tx) - p;
+            dpdy = (ray.ryOrigin + ray.ryDirection * ty) - p;
+        }
+        else if (camera)
+            camera->Approximate_dp_dxy(p, n, time, samplesPerPixel, &dpdx, &dpdy);
+        else
+            return;
+        // dp = dpdu du + dpdv dv, solved in the two dimensions the normal is least aligned with
+        int dim[2];
+        if (std::abs(n.x) > std::abs(n.y) && std::abs(n.x) > std::abs(n.z))
+            dim[0] = 1, dim[1] = 2;
+        else if (std::abs(n.y) > std::abs(n.z))
+            dim[0] = 0, dim[1] = 2;
+        else
+            dim[0] = 0, dim[1] = 1;
+        Float A[2][2] = {{dpdu[dim[0]], dpdv[dim[0]]}, {dpdu[dim[1]], dpdv[dim[1]]}};
+        Float Bx[2] = {dpdx[dim[0]], dpdx[dim[1]]};
+        Float By[2] = {dpdy[dim[0]], dpdy[dim[1]]};
+        if (!SolveLinearSystem2x2(A, Bx, &dudx, &dvdx))
+            dudx = dvdx = 0;
+        if (!SolveLinearSystem2x2(A, By, &dudy, &dvdy))
+            dudy = dvdy = 0;
+    }
+}
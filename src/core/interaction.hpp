@@ -0,0 +1,67 @@
+#pragma once
+/***
+ *  Interaction
+ *  SurfaceInteraction
+ */
+#include <memory>
+#include <reina.hpp>
+#include <utils/vecmath.hpp>
+#include <core/ray.hpp>
+namespace reina
+{
+    class Interaction
+    {
+    public:
+        // Interaction Public Methods
+        Interaction() : time(0) {}
+        Interaction(const Point3f &p, const Normal3f &n, const Vector3f &wo, Float time)
+            : p(p), time(time), wo(wo), n(n) {}
+        bool IsSurfaceInteraction() const { return n != Normal3f(); }
+        // origin pushed off the surface to the side d leaves through
+        Point3f OffsetRayOrigin(const Vector3f &d) const
+        {
+            Vector3f offset = Vector3f(n) * (ShadowEpsilon * (1 + MaxComponent(Abs(Vector3f(p)))));
+            if (d.Dot(n) < 0)
+                offset = -offset;
+            return p + offset;
+        }
+        Ray SpawnRay(const Vector3f &d) const { return Ray(OffsetRayOrigin(d), d, Infinity, time); }
+        // tMax stops just short of p2
+        Ray SpawnRayTo(const Point3f &p2) const
+        {
+            Point3f o = OffsetRayOrigin(p2 - p);
+            return Ray(o, p2 - o, 1 - ShadowEpsilon, time);
+        }
+
+        // Interaction Public Data
+        Point3f p;
+        Float time;
+        Vector3f wo;
+        Normal3f n;
+    };
+
+    class SurfaceInteraction : public Interaction
+    {
+    public:
+        // SurfaceInteraction Public Methods
+        SurfaceInteraction() = default;
+        SurfaceInteraction(const Point3f &p, const Point2f &uv, const Vector3f &wo,
+                           const Normal3f &n, Float time)
+            : Interaction(p, n, wo, time), uv(uv), shadingN(n) {}
+        // screen space derivatives of p and (u, v), from the offset rays of a camera ray. Rays without
+        // differentials, such as bounces, get the footprint camera->Approximate_dp_dxy() gives p, or
+        // zero without a camera
+        void ComputeDifferentials(const RayDifferential &ray, const Camera *camera = nullptr,
+                                  int samplesPerPixel = 1);
+
+        // SurfaceInteraction Public Data
+        Point2f uv;
+        Vector3f dpdu, dpdv;
+        Normal3f shadingN;
+        Vector3f dpdx, dpdy;
+        Float dudx = 0, dvdx = 0, dudy = 0, dvdy = 0;
+        const Primitive *primitive = nullptr;
+        // set by Material::ComputeScatteringFunctions(), owned by its arena
+        BSDF *bsdf = nullptr;
+    };
+}
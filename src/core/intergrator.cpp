@@ -1 +1,267 @@
+#include <core/intergrator.hpp>
+#include <core/sampling.hpp>
+#include <core/materials.hpp>
+#include <utils/parallel.hpp>
+#include <algorithm>
+namespace reina
+{
+    Spectrum SampleOneLight(const SurfaceInteraction &si, const Scene &scene, Float uLight, const Point2f &uLi,
+                            Ray *shadowRay)
+    {
+        if (!si.bsdf)
+            return Spectrum(0);
+        Float lightPmf;
+        const Light *light = scene.GetLightSampler().Sample(si, uLight, &lightPmf);
+        if (!light)
+            return Spectrum(0);
+        Vector3f wi;
+        Float lightPdf;
+        Point3f pLight;
+        Spectrum Li = light->Sample_Li(si, uLi, &wi, &lightPdf, &pLight);
+        if (lightPdf == 0 || Li.IsBlack())
+            return Spectrum(0);
+        Spectrum f = si.bsdf->f(si.wo, wi) * std::abs(wi.Dot(si.shadingN));
+        if (f.IsBlack())
+            return Spectrum(0);
+        *shadowRay = si.SpawnRayTo(pLight);
+        return f * Li / (lightPmf * lightPdf);
+    }
 
+    // PassScheduler Method Definitions
+    PassScheduler::PassScheduler(double budgetSeconds, int maxSamples, int maxPassSamples)
+        : startTime(std::chrono::steady_clock::now()), budget(budgetSeconds), maxSamples(maxSamples),
+          maxPassSamples(std::max(1, maxPassSamples)) {}
+
+    double PassScheduler::ElapsedSeconds() const
+    {
+        return std::chrono::duration<double>(std::chrono::steady_clock::now() - startTime).count();
+    }
+
+    int PassScheduler::NextPass(int64_t nPixels)
+    {
+        int n = std::min(maxPassSamples, maxSamples - samplesScheduled);
+        if (n <= 0 || nPixels <= 0)
+            return 0;
+        if (budget > 0)
+        {
+            if (samplesScheduled == 0)
+                n = 1;
+            else
+            {
+                // a pass at most doubles the samples so far, so the cost estimate stays fresh; the
+                // remaining time keeps a 5% margin for the passes' fixed costs and the image write
+                double remaining = 0.95 * budget - ElapsedSeconds();
+                double secondsPerSample = tracingSeconds / std::max<int64_t>(1, pixelSamplesTraced);
+                double affordable = remaining / (secondsPerSample * nPixels);
+                n = (int)std::min<double>({(double)n, (double)samplesScheduled, affordable});
+                if (n <= 0)
+                    return 0;
+            }
+        }
+        samplesScheduled += n;
+        passStart = std::chrono::steady_clock::now();
+        return n;
+    }
+
+    void PassScheduler::EndPass(int64_t pixelSamples)
+    {
+        tracingSeconds += std::chrono::duration<double>(std::chrono::steady_clock::now() - passStart).count();
+        pixelSamplesTraced += pixelSamples;
+    }
+
+    bool PassScheduler::Expired() const { return budget > 0 && samplesScheduled > 1 && ElapsedSeconds() > budget; }
+
+    // SamplerIntegrator Method Definitions
+    void SamplerIntegrator::Render(const Scene &scene)
+    {
+        Preprocess(scene, *sampler);
+        Film &film = *camera->film;
+        const Bounds2i pixelBounds = film.GetPixelBounds();
+        const Vector2i extent = pixelBounds.Diagonal();
+        const int nTilesX = (extent.x + TileSize - 1) / TileSize;
+        const int nTilesY = (extent.y + TileSize - 1) / TileSize;
+        const int64_t nTiles = (int64_t)nTilesX * nTilesY;
+        const int maxSamples = sampler->SamplesPerPixel();
+
+        const bool isAdaptive = adaptive.errorThreshold > 0;
+        PassScheduler scheduler(timeBudget, maxSamples, isAdaptive ? adaptive.samplesPerPass : maxSamples);
+        // written only by the tile owning the pixel
+        std::vector<AdaptivePixel> adaptivePixels(isAdaptive ? (size_t)extent.x * extent.y : 0);
+        std::vector<int> tileActivePixels(nTiles);
+        for (int64_t tile = 0; tile < nTiles; ++tile)
+            tileActivePixels[tile] = std::min(TileSize, extent.x - (int)(tile % nTilesX) * TileSize) *
+                                     std::min(TileSize, extent.y - (int)(tile / nTilesX) * TileSize);
+        std::vector<int64_t> tileSamples(nTiles, 0);
+
+        int sampleBegin = 0;
+        while (true)
+        {
+            int64_t nActivePixels = 0;
+            for (int n : tileActivePixels)
+                nActivePixels += n;
+            int passSamples = scheduler.NextPass(nActivePixels);
+            if (passSamples == 0)
+                break;
+            int sampleEnd = sampleBegin + passSamples;
+            int64_t samplesBefore = 0;
+            for (int64_t n : tileSamples)
+                samplesBefore += n;
+            // one tile per task: tiles vary a lot in cost, stealing evens it out
+            ParallelFor(nTiles, 1, [&](int64_t begin, int64_t end)
+                        {
+                for (int64_t tile = begin; tile < end; ++tile)
+                {
+                    // tiles dropped at the deadline keep their samples so far, the film stays valid
+                    if (tileActivePixels[tile] == 0 || scheduler.Expired())
+                        continue;
+                    int tx = (int)(tile % nTilesX), ty = (int)(tile / nTilesX);
+                    // samples are keyed by pixel, so the image does not depend on the schedule
+                    SamplerBuffer tileSamplerBuffer;
+                    // per thread, so its blocks outlive the tile and get reused by the next one
+                    thread_local MemoryArena arena;
+                    Sampler &tileSampler = tileSamplerBuffer.Clone(*sampler, sampler->Seed());
+                    Point2i p0(pixelBounds.pMin.x + tx * TileSize, pixelBounds.pMin.y + ty * TileSize);
+                    Point2i p1(std::min(p0.x + TileSize, pixelBounds.pMax.x),
+                               std::min(p0.y + TileSize, pixelBounds.pMax.y));
+                    int nActive = renderTile(scene, tileSampler, arena, Bounds2i(p0, p1), sampleBegin, sampleEnd,
+                                             isAdaptive ? adaptivePixels.data() : nullptr, &tileSamples[tile]);
+                    if (isAdaptive)
+                        tileActivePixels[tile] = nActive;
+                } });
+            int64_t samplesAfter = 0;
+            for (int64_t n : tileSamples)
+                samplesAfter += n;
+            scheduler.EndPass(samplesAfter - samplesBefore);
+            sampleBegin = sampleEnd;
+        }
+        samplesTaken = 0;
+        for (int64_t n : tileSamples)
+            samplesTaken += n;
+        film.WriteImage();
+    }
+
+    int SamplerIntegrator::renderTile(const Scene &scene, Sampler &tileSampler, MemoryArena &arena,
+                                      const Bounds2i &bounds, int sampleBegin, int sampleEnd,
+                                      AdaptivePixel *adaptivePixels, int64_t *nSamples) const
+    {
+        Film &film = *camera->film;
+        std::unique_ptr<FilmTile> filmTile = film.GetFilmTile(bounds);
+        int nActive = 0;
+        std::vector<Point2f> pixelOffsets(sampleEnd - sampleBegin);
+        // a sample's footprint is its share of the pixel
+        const Float differentialScale = 1 / std::sqrt((Float)sampler->SamplesPerPixel());
+        for (int y = bounds.pMin.y; y < bounds.pMax.y; ++y)
+            for (int x = bounds.pMin.x; x < bounds.pMax.x; ++x)
+            {
+                Point2i pixel(x, y);
+                AdaptivePixel *adaptivePixel =
+                    adaptivePixels ? &adaptivePixels[(size_t)y * film.fullResolution.x + x] : nullptr;
+                if (adaptivePixel && adaptivePixel->converged)
+                    continue;
+                tileSampler.GetPixel2D(pixel, sampleBegin, sampleEnd - sampleBegin, pixelOffsets.data());
+                for (int s = sampleBegin; s < sampleEnd; ++s)
+                {
+                    // resumed after the film offset
+                    tileSampler.StartPixelSample(pixel, s, 2);
+                    CameraSample cameraSample;
+                    cameraSample.pFilm = Point2f((Float)x, (Float)y) + Vector2f(pixelOffsets[s - sampleBegin]);
+                    cameraSample.time = tileSampler.Get1D();
+                    cameraSample.pLens = tileSampler.Get2D();
+                    RayDifferential ray;
+                    Float rayWeight = camera->GenerateRayDifferential(cameraSample, &ray);
+                    ray.ScaleDifferentials(differentialScale);
+                    Spectrum L = rayWeight > 0 ? Li(ray, scene, tileSampler, arena) : Spectrum(0);
+                    arena.Reset();
+                    // a NaN or infinite sample would poison the whole pixel
+                    if (L.HasNaNs() || std::isinf(L.y()))
+                        L = Spectrum(0);
+                    filmTile->AddSample(pixel, L, rayWeight);
+                    if (adaptivePixel)
+                        adaptivePixel->luminance.Add(L.y());
+                }
+                *nSamples += sampleEnd - sampleBegin;
+                if (!adaptivePixel)
+                    continue;
+                const VarianceEstimator &lum = adaptivePixel->luminance;
+                adaptivePixel->converged =
+                    lum.Count() >= adaptive.minSamples &&
+                    lum.MeanError() <= adaptive.errorThreshold * std::max(lum.Mean(), adaptive.minLuminance);
+                if (!adaptivePixel->converged)
+                    ++nActive;
+            }
+        film.MergeFilmTile(std::move(filmTile));
+        return nActive;
+    }
+
+    // AOIntegrator Method Definitions
+    Spectrum AOIntegrator::Li(const RayDifferential &ray, const Scene &scene, Sampler &sampler, MemoryArena &arena,
+                              int depth) const
+    {
+        SurfaceInteraction isect;
+        if (!scene.Intersect(ray, &isect))
+            return Spectrum(0);
+        Vector3f n = Normalize(Vector3f(Faceforward(isect.shadingN, -ray.d)));
+        Vector3f s, t;
+        CoordinateSystem(n, &s, &t);
+        Vector3f wl = CosineSampleHemisphere(sampler.Get2D());
+        Vector3f wi = s * wl.x + t * wl.y + n * wl.z;
+        Ray aoRay = isect.SpawnRay(wi);
+        aoRay.tMax = maxDistance;
+        return scene.IntersectP(aoRay) ? Spectrum(0) : Spectrum(1);
+    }
+
+    // PathIntegrator Method Definitions
+    Spectrum PathIntegrator::Li(const RayDifferential &r, const Scene &scene, Sampler &sampler, MemoryArena &arena,
+                                int depth) const
+    {
+        Spectrum L(0), beta(1);
+        // only the camera ray has differentials: bounces take the footprint of a pixel seen from the
+        // camera, rather than the finest texture level
+        RayDifferential ray(r);
+        for (int bounces = 0;; ++bounces)
+        {
+            SurfaceInteraction isect;
+            if (!scene.Intersect(ray, &isect))
+            {
+                if (bounces == 0)
+                    for (const auto &light : scene.infiniteLights)
+                        L += beta * light->Le(ray);
+                break;
+            }
+            if (bounces == 0)
+                if (const AreaLight *area = isect.primitive->GetAreaLight())
+                    L += beta * area->L(isect, -ray.d);
+            const Material *material = isect.primitive->GetMaterial();
+            if (bounces >= maxDepth || !material)
+                break;
+            isect.ComputeDifferentials(ray, camera.get(), sampler.SamplesPerPixel());
+            material->ComputeScatteringFunctions(&isect, arena);
+
+            // light and lobe choice, light position, BSDF direction
+            Point2f u[3];
+            sampler.Get2D(u, 3);
+            Ray shadowRay;
+            Spectrum Ld = SampleOneLight(isect, scene, u[0].x, u[1], &shadowRay);
+            if (!Ld.IsBlack() && !scene.IntersectP(shadowRay))
+                L += beta * Ld;
+
+            Vector3f wi;
+            Float pdf;
+            Spectrum f = isect.bsdf->Sample_f(isect.wo, &wi, u[0].y, u[2], &pdf);
+            if (f.IsBlack() || pdf == 0)
+                break;
+            beta *= f * (std::abs(wi.Dot(isect.shadingN)) / pdf);
+            ray = isect.SpawnRay(wi);
+
+            Float uRoulette = sampler.Get1D();
+            if (bounces >= 3)
+            {
+                Float q = std::max((Float)0.05, 1 - beta.MaxComponentValue());
+                if (uRoulette < q)
+                    break;
+                beta /= 1 - q;
+            }
+        }
+        return L;
+    }
+}
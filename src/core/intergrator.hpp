@@ -1,27 +1,154 @@
 #pragma once
+/***
+ *  Integrator
+ *  PassScheduler
+ *  SamplerIntegrator
+ *  AOIntegrator
+ *  PathIntegrator
+ */
+#include <chrono>
+#include <cstdint>
 #include <memory>
 
 #include <core/camera.hpp>
+#include <core/sampler.hpp>
+#include <core/scene.hpp>
+#include <core/spectrum.hpp>
+#include <utils/memory.hpp>
 
 namespace reina
 {
+    // sample dimensions a camera sample takes (pixel 2, time 1, lens 2), and each path vertex
+    // after it (light and lobe choice 2, light 2, direction 2, roulette 1)
+    constexpr int CameraSampleDimensions = 5;
+    constexpr int PathVertexDimensions = 7;
+
+    // direct light from one light picked by the scene's light sampler: returns f * Li * |cos| / pdf
+    // without the visibility term, which the caller decides by tracing *shadowRay
+    Spectrum SampleOneLight(const SurfaceInteraction &si, const Scene &scene, Float uLight, const Point2f &uLi,
+                            Ray *shadowRay);
+
     class Integrator
     {
     public:
         virtual ~Integrator() = default;
-        virtual void Render() = 0;
+        virtual void Render(const Scene &scene) = 0;
+        // wall-clock budget for Render() in seconds, 0 for none. With a budget the image is rendered in
+        // progressive passes sized from the measured cost of the previous ones, and Render() stops
+        // (still writing the image) once the next pass would not fit; the sampler's samples per pixel
+        // remain the upper limit. The first pass of one sample per pixel is always taken.
+        void SetTimeBudget(double seconds) { timeBudget = seconds; }
+        double TimeBudget() const { return timeBudget; }
+
+    protected:
+        double timeBudget = 0;
+    };
+
+    // schedules the progressive passes of a Render(), either to a wall-clock budget or, without one,
+    // straight to maxSamples in passes of at most maxPassSamples
+    class PassScheduler
+    {
+    public:
+        // PassScheduler Public Methods
+        PassScheduler(double budgetSeconds, int maxSamples, int maxPassSamples);
+        // samples per pixel for the next pass over nPixels pixels, 0 when done
+        int NextPass(int64_t nPixels);
+        // reports the pixel samples the pass returned by NextPass() actually traced
+        void EndPass(int64_t pixelSamples);
+        // past the budget: workers should drop what is left of the current pass. Never true during
+        // the first pass, which guarantees every pixel a sample.
+        bool Expired() const;
+        int SamplesScheduled() const { return samplesScheduled; }
+        double ElapsedSeconds() const;
+
+    private:
+        // PassScheduler Private Data
+        const std::chrono::steady_clock::time_point startTime;
+        const double budget;
+        const int maxSamples, maxPassSamples;
+        int samplesScheduled = 0;
+        std::chrono::steady_clock::time_point passStart;
+        double tracingSeconds = 0;
+        int64_t pixelSamplesTraced = 0;
     };
 
+    // renders square tiles on the thread pool; each tile gets its own clone of the sampler, built in a
+    // SamplerBuffer on the worker's stack, and its own FilmTile, so workers share nothing while rendering
     class SamplerIntegrator : public Integrator
     {
     public:
+        // progressive mode: samples are taken in passes, and a pixel stops once the standard error
+        // of its mean luminance drops below errorThreshold * max(mean, minLuminance). Noisy pixels
+        // go on up to the sampler's samples per pixel. errorThreshold 0 renders uniformly.
+        struct AdaptiveSettings
+        {
+            Float errorThreshold = 0;
+            // samples every pixel gets before it may stop
+            int minSamples = 16;
+            int samplesPerPass = 8;
+            // keeps near-black pixels from chasing a tiny relative error
+            Float minLuminance = 0.01f;
+        };
+
         SamplerIntegrator(std::shared_ptr<const Camera> camera, std::shared_ptr<Sampler> sampler)
             : camera(camera), sampler(sampler) {}
 
-        virtual void Render() override;
+        virtual void Preprocess(const Scene &scene, Sampler &sampler) {}
+        virtual void Render(const Scene &scene) override;
+        // incident radiance along ray; scratch objects such as BSDFs come from arena, which the
+        // caller resets after every sample
+        virtual Spectrum Li(const RayDifferential &ray, const Scene &scene, Sampler &sampler, MemoryArena &arena,
+                            int depth = 0) const = 0;
+        void SetAdaptiveSettings(const AdaptiveSettings &settings) { adaptive = settings; }
+        // camera samples traced by the last Render()
+        int64_t SamplesTaken() const { return samplesTaken; }
+
+        static constexpr int TileSize = 16;
 
     protected:
+        struct AdaptivePixel
+        {
+            VarianceEstimator luminance;
+            bool converged = false;
+        };
+
+        // SamplerIntegrator Protected Methods
+        // traces samples [sampleBegin, sampleEnd) of every pixel in bounds that has not converged;
+        // with adaptivePixels, updates them and returns how many pixels still need samples
+        int renderTile(const Scene &scene, Sampler &tileSampler, MemoryArena &arena, const Bounds2i &bounds,
+                       int sampleBegin, int sampleEnd, AdaptivePixel *adaptivePixels, int64_t *nSamples) const;
+
         std::shared_ptr<const Camera> camera;
         std::shared_ptr<Sampler> sampler;
+        AdaptiveSettings adaptive;
+        int64_t samplesTaken = 0;
+    };
+
+    // ambient occlusion: fraction of cosine-weighted directions that escape within maxDistance
+    class AOIntegrator : public SamplerIntegrator
+    {
+    public:
+        AOIntegrator(std::shared_ptr<const Camera> camera, std::shared_ptr<Sampler> sampler,
+                     Float maxDistance = Infinity)
+            : SamplerIntegrator(camera, sampler), maxDistance(maxDistance) {}
+        Spectrum Li(const RayDifferential &ray, const Scene &scene, Sampler &sampler, MemoryArena &arena,
+                    int depth = 0) const override;
+
+    private:
+        Float maxDistance;
+    };
+
+    // unidirectional path tracer with next event estimation; emission is picked up directly only by
+    // camera rays, every later bounce sees lights through SampleOneLight()
+    class PathIntegrator : public SamplerIntegrator
+    {
+    public:
+        PathIntegrator(std::shared_ptr<const Camera> camera, std::shared_ptr<Sampler> sampler, int maxDepth = 5)
+            : SamplerIntegrator(camera, sampler), maxDepth(maxDepth) {}
+        Spectrum Li(const RayDifferential &ray, const Scene &scene, Sampler &sampler, MemoryArena &arena,
+                    int depth = 0) const override;
+
+    private:
+        const int maxDepth;
     };
-}
\ No newline at end of file
+}
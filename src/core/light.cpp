@@ -0,0 +1,269 @@
+#include <core/light.hpp>
+#include <core/shapes.hpp>
+#include <utils/imageio.hpp>
+#include <utils/parallel.hpp>
+namespace reina
+{
+    // LightBounds Method Definitions
+    namespace
+    {
+        // cos(max(0, a - b)) and sin(max(0, a - b)) from the sines and cosines of a and b
+        Float CosSubClamped(Float sinA, Float cosA, Float sinB, Float cosB)
+        {
+            return cosA > cosB ? 1 : cosA * cosB + sinA * sinB;
+        }
+        Float SinSubClamped(Float sinA, Float cosA, Float sinB, Float cosB)
+        {
+            return cosA > cosB ? 0 : sinA * cosB - cosA * sinB;
+        }
+    }
+
+    Float LightBounds::Importance(const Point3f &p, const Normal3f &n) const
+    {
+        Point3f pc = Centroid();
+        // clamped so that points inside the bounds don't blow up
+        Float d2 = std::max(DistanceSquared(p, pc), bounds.Diagonal().Length() / 2);
+
+        // angle between the cone axis and the direction to p
+        Vector3f wi = p - pc;
+        if (wi.LengthSquared() > 0)
+            wi = Normalize(wi);
+        Float cosThetaW = w.Dot(wi);
+        if (twoSided)
+            cosThetaW = std::abs(cosThetaW);
+        Float sinThetaW = SafeSqrt(1 - cosThetaW * cosThetaW);
+
+        // angle the bounds subtend from p
+        Point3f center;
+        Float radius;
+        bounds.BoundingSphere(&center, &radius);
+        Float dc2 = DistanceSquared(p, center);
+        Float cosThetaB = dc2 < radius * radius ? -1 : SafeSqrt(1 - radius * radius / dc2);
+        Float sinThetaB = SafeSqrt(1 - cosThetaB * cosThetaB);
+
+        // smallest angle any emitter in the bounds can make with p: max(0, thetaW - thetaO - thetaB)
+        Float sinThetaO = SafeSqrt(1 - cosThetaO * cosThetaO);
+        Float cosThetaX = CosSubClamped(sinThetaW, cosThetaW, sinThetaO, cosThetaO);
+        Float sinThetaX = SinSubClamped(sinThetaW, cosThetaW, sinThetaO, cosThetaO);
+        Float cosThetaP = CosSubClamped(sinThetaX, cosThetaX, sinThetaB, cosThetaB);
+        if (cosThetaP <= cosThetaE)
+            return 0;
+        Float importance = phi * cosThetaP / d2;
+
+        // and the smallest incident angle at the receiver
+        if (n != Normal3f())
+        {
+            Float cosThetaI = std::abs(wi.Dot(n));
+            Float sinThetaI = SafeSqrt(1 - cosThetaI * cosThetaI);
+            importance *= CosSubClamped(sinThetaI, cosThetaI, sinThetaB, cosThetaB);
+        }
+        return std::max<Float>(importance, 0);
+    }
+
+    LightBounds Union(const LightBounds &a, const LightBounds &b)
+    {
+        if (a.phi == 0)
+            return b;
+        if (b.phi == 0)
+            return a;
+        DirectionCone cone = Union(DirectionCone(a.w, a.cosThetaO), DirectionCone(b.w, b.cosThetaO));
+        return LightBounds(Union(a.bounds, b.bounds), cone.w, a.phi + b.phi, cone.cosTheta,
+                           std::min(a.cosThetaE, b.cosThetaE), a.twoSided || b.twoSided);
+    }
+
+    // PointLight Method Definitions
+    bool PointLight::Bounds(LightBounds *bounds) const
+    {
+        // emits in all directions: cone of the whole sphere, no falloff past it
+        *bounds = LightBounds(Bounds3f(pLight, pLight), Vector3f(0, 0, 1), Power().y(), -1, 0, false);
+        return true;
+    }
+
+    Spectrum PointLight::Sample_Li(const Interaction &ref, const Point2f &u, Vector3f *wi, Float *pdf,
+                                   Point3f *pSampled) const
+    {
+        *pSampled = pLight;
+        *wi = Normalize(pLight - ref.p);
+        *pdf = 1;
+        return I / DistanceSquared(pLight, ref.p);
+    }
+
+    // DiffuseAreaLight Method Definitions
+    namespace
+    {
+        Float TotalArea(const std::vector<std::shared_ptr<const Shape>> &shapes)
+        {
+            Float area = 0;
+            for (const auto &shape : shapes)
+                area += shape->Area();
+            return area;
+        }
+    }
+
+    DiffuseAreaLight::DiffuseAreaLight(const Spectrum &Lemit, std::shared_ptr<const Shape> shape, bool twoSided)
+        : DiffuseAreaLight(Lemit, std::vector<std::shared_ptr<const Shape>>{std::move(shape)}, twoSided)
+    {
+    }
+
+    DiffuseAreaLight::DiffuseAreaLight(const Spectrum &Lemit, std::vector<std::shared_ptr<const Shape>> shapes,
+                                       bool twoSided)
+        : Lemit(Lemit), shapes(std::move(shapes)), twoSided(twoSided), area(TotalArea(this->shapes))
+    {
+        if (this->shapes.size() > 1)
+        {
+            std::vector<Float> areas(this->shapes.size());
+            for (size_t i = 0; i < areas.size(); ++i)
+                areas[i] = this->shapes[i]->Area();
+            areaDistribution = AliasTable(areas);
+        }
+    }
+
+    Spectrum DiffuseAreaLight::Sample_Li(const Interaction &ref, const Point2f &u, Vector3f *wi, Float *pdf,
+                                         Point3f *pLight) const
+    {
+        // a shape by area, then a point on it: uniform over the total area
+        Point2f uShape = u;
+        const Shape *shape = shapes[0].get();
+        if (!areaDistribution.empty())
+            shape = shapes[areaDistribution.Sample(u.x, nullptr, &uShape.x)].get();
+        Float shapePdf;
+        Interaction pShape = shape->Sample(uShape, &shapePdf);
+        Float areaPdf = 1 / area;
+        Vector3f d = pShape.p - ref.p;
+        Float dist2 = d.LengthSquared();
+        if (dist2 == 0)
+        {
+            *pdf = 0;
+            return Spectrum(0);
+        }
+        *wi = d / std::sqrt(dist2);
+        // area measure to solid angle
+        Float cosLight = std::abs(pShape.n.Dot(-*wi));
+        *pdf = cosLight > 0 ? areaPdf * dist2 / cosLight : 0;
+        *pLight = pShape.p;
+        return L(pShape, -*wi);
+    }
+
+    bool DiffuseAreaLight::Bounds(LightBounds *bounds) const
+    {
+        Bounds3f b;
+        DirectionCone nb;
+        for (const auto &shape : shapes)
+        {
+            b = Union(b, shape->WorldBound());
+            nb = Union(nb, shape->NormalBounds());
+        }
+        // cosine falloff reaches 90 degrees past the normals
+        *bounds = LightBounds(b, nb.w, Power().y(), nb.cosTheta, 0, twoSided);
+        return true;
+    }
+
+    // InfiniteAreaLight Method Definitions
+    InfiniteAreaLight::InfiniteAreaLight(const Transform &lightToWorld, const Spectrum &L, const std::string &filename)
+        : Light((int)LightFlags::Infinite), lightToWorld(lightToWorld)
+    {
+        std::vector<Float> rgb;
+        int w, h;
+        if (filename.empty() || !ReadImage(filename, &rgb, &w, &h))
+        {
+            rgb.assign(3, 1);
+            w = h = 1;
+        }
+        for (size_t i = 0; i < rgb.size(); ++i)
+            rgb[i] *= L[i % 3];
+        setMap(rgb, w, h);
+    }
+
+    InfiniteAreaLight::InfiniteAreaLight(const Transform &lightToWorld, const std::vector<Float> &rgb, int width,
+                                         int height)
+        : Light((int)LightFlags::Infinite), lightToWorld(lightToWorld)
+    {
+        setMap(rgb, width, height);
+    }
+
+    void InfiniteAreaLight::setMap(const std::vector<Float> &rgb, int w, int h)
+    {
+        width = w;
+        height = h;
+        texels.resize((size_t)width * height);
+        // luminance times sin(theta): equirectangular texels shrink towards the poles
+        std::vector<Float> func(texels.size());
+        ParallelFor(height, 16, [&](int64_t begin, int64_t end)
+                    {
+            for (int64_t y = begin; y < end; ++y)
+            {
+                Float sinTheta = std::sin(Pi * (y + 0.5f) / height);
+                for (int x = 0; x < width; ++x)
+                {
+                    size_t i = (size_t)y * width + x;
+                    texels[i] = Spectrum(0);
+                    for (int c = 0; c < 3; ++c)
+                        texels[i][c] = std::max<Float>(0, rgb[3 * i + c]);
+                    func[i] = texels[i].y() * sinTheta;
+                }
+            } });
+        distribution = std::make_unique<Distribution2D>(func.data(), width, height);
+    }
+
+    Spectrum InfiniteAreaLight::lookup(const Point2f &uv) const
+    {
+        int x = Clamp((int)(uv[0] * width), 0, width - 1);
+        int y = Clamp((int)(uv[1] * height), 0, height - 1);
+        return texels[(size_t)y * width + x];
+    }
+
+    void InfiniteAreaLight::Preprocess(const Bounds3f &worldBound)
+    {
+        worldBound.BoundingSphere(&worldCenter, &worldRadius);
+    }
+
+    Spectrum InfiniteAreaLight::Le(const Ray &ray) const
+    {
+        Vector3f w = Normalize(lightToWorld.ApplyInverse(ray.d));
+        return lookup(Point2f(SphericalPhi(w) * Inv2Pi, SphericalTheta(w) * InvPi));
+    }
+
+    Spectrum InfiniteAreaLight::Sample_Li(const Interaction &ref, const Point2f &u, Vector3f *wi, Float *pdf,
+                                          Point3f *pLight) const
+    {
+        Float mapPdf;
+        Point2f uv = distribution->SampleContinuous(u, &mapPdf);
+        Float theta = uv[1] * Pi, phi = uv[0] * 2 * Pi;
+        Float sinTheta = std::sin(theta);
+        if (mapPdf == 0 || sinTheta == 0)
+        {
+            *pdf = 0;
+            return Spectrum(0);
+        }
+        *wi = lightToWorld(SphericalDirection(sinTheta, std::cos(theta), phi));
+        // (u, v) density to solid angle: dw = 2pi^2 sin(theta) du dv
+        *pdf = mapPdf / (2 * Pi * Pi * sinTheta);
+        // far enough to leave the scene
+        *pLight = ref.p + *wi * (2 * worldRadius);
+        return lookup(uv);
+    }
+
+    Float InfiniteAreaLight::Pdf_Li(const Vector3f &w) const
+    {
+        Vector3f wl = Normalize(lightToWorld.ApplyInverse(w));
+        Float theta = SphericalTheta(wl), sinTheta = std::sin(theta);
+        if (sinTheta == 0)
+            return 0;
+        return distribution->Pdf(Point2f(SphericalPhi(wl) * Inv2Pi, theta * InvPi)) / (2 * Pi * Pi * sinTheta);
+    }
+
+    Spectrum InfiniteAreaLight::Power() const
+    {
+        // mean radiance over the sphere, hitting the scene's cross section
+        Spectrum sum(0);
+        Float weightSum = 0;
+        for (int y = 0; y < height; ++y)
+        {
+            Float sinTheta = std::sin(Pi * (y + 0.5f) / height);
+            for (int x = 0; x < width; ++x)
+                sum += texels[(size_t)y * width + x] * sinTheta;
+            weightSum += sinTheta * width;
+        }
+        return Pi * worldRadius * worldRadius * (weightSum > 0 ? sum / weightSum : Spectrum(0));
+    }
+}
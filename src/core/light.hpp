@@ -1,10 +1,165 @@
 #pragma once
+/***
+ *  LightBounds
+ *  Light
+ *  PointLight
+ *  AreaLight
+ *  DiffuseAreaLight
+ *  InfiniteAreaLight
+ */
+#include <memory>
+#include <string>
+#include <vector>
+#include <reina.hpp>
+#include <core/transform.hpp>
+#include <core/ray.hpp>
+#include <core/interaction.hpp>
+#include <core/spectrum.hpp>
+#include <core/sampling.hpp>
 
 namespace reina
 {
+    enum class LightFlags : int
+    {
+        DeltaPosition = 1,
+        DeltaDirection = 2,
+        Area = 4,
+        Infinite = 8
+    };
+
+    inline bool IsDeltaLight(int flags)
+    {
+        return flags & ((int)LightFlags::DeltaPosition | (int)LightFlags::DeltaDirection);
+    }
+
+    // where a light emits from and where to: the emitting normals lie in the cone (w, cosThetaO) and
+    // emission reaches at most acos(cosThetaE) past them. Used to build and traverse the light BVH.
+    struct LightBounds
+    {
+        LightBounds() = default;
+        LightBounds(const Bounds3f &bounds, const Vector3f &w, Float phi, Float cosThetaO, Float cosThetaE,
+                    bool twoSided)
+            : bounds(bounds), w(Normalize(w)), phi(phi), cosThetaO(cosThetaO), cosThetaE(cosThetaE),
+              twoSided(twoSided) {}
+        Point3f Centroid() const { return (bounds.pMin + bounds.pMax) / 2; }
+        // conservative estimate of the light reaching p, on a surface with normal n (zero for none)
+        Float Importance(const Point3f &p, const Normal3f &n) const;
+
+        Bounds3f bounds;
+        Vector3f w;
+        // emitted power, 0 for empty bounds
+        Float phi = 0;
+        Float cosThetaO = 1, cosThetaE = 1;
+        bool twoSided = false;
+    };
+
+    LightBounds Union(const LightBounds &a, const LightBounds &b);
+
     class Light
     {
     public:
+        Light(int flags) : flags(flags) {}
         virtual ~Light() = default;
+        // incident radiance at ref from a sampled point *pLight on the light, along *wi;
+        // *pdf is per unit solid angle (1 for delta lights)
+        virtual Spectrum Sample_Li(const Interaction &ref, const Point2f &u, Vector3f *wi, Float *pdf,
+                                   Point3f *pLight) const = 0;
+        // total emitted power
+        virtual Spectrum Power() const = 0;
+        // radiance carried by a ray that escapes the scene, for infinite lights
+        virtual Spectrum Le(const Ray &ray) const { return Spectrum(0); }
+        virtual void Preprocess(const Bounds3f &worldBound) {}
+        // false for lights without finite bounds (infinite lights)
+        virtual bool Bounds(LightBounds *bounds) const { return false; }
+
+        // Light Public Data
+        const int flags;
+    };
+
+    class PointLight : public Light
+    {
+    public:
+        PointLight(const Point3f &pLight, const Spectrum &I)
+            : Light((int)LightFlags::DeltaPosition), pLight(pLight), I(I) {}
+        Spectrum Sample_Li(const Interaction &ref, const Point2f &u, Vector3f *wi, Float *pdf,
+                           Point3f *pSampled) const override;
+        Spectrum Power() const override { return 4 * Pi * I; }
+        bool Bounds(LightBounds *bounds) const override;
+
+        // PointLight Public Data
+        const Point3f pLight;
+        const Spectrum I;
+    };
+
+    class AreaLight : public Light
+    {
+    public:
+        AreaLight() : Light((int)LightFlags::Area) {}
+        // radiance leaving the point it on the light in direction w
+        virtual Spectrum L(const Interaction &it, const Vector3f &w) const = 0;
+    };
+
+    // uniform emission from one side (the normal's) or both sides of a shape, or of a group of shapes
+    // such as the triangles of an emissive mesh
+    class DiffuseAreaLight : public AreaLight
+    {
+    public:
+        DiffuseAreaLight(const Spectrum &Lemit, std::shared_ptr<const Shape> shape, bool twoSided = false);
+        // one light for all the shapes, which are sampled by area through an alias table
+        DiffuseAreaLight(const Spectrum &Lemit, std::vector<std::shared_ptr<const Shape>> shapes,
+                         bool twoSided = false);
+        Spectrum L(const Interaction &it, const Vector3f &w) const override
+        {
+            return (twoSided || it.n.Dot(w) > 0) ? Lemit : Spectrum(0);
+        }
+        Spectrum Sample_Li(const Interaction &ref, const Point2f &u, Vector3f *wi, Float *pdf,
+                           Point3f *pLight) const override;
+        Spectrum Power() const override { return Lemit * (twoSided ? 2 : 1) * area * Pi; }
+        bool Bounds(LightBounds *bounds) const override;
+
+        // DiffuseAreaLight Public Data
+        const Spectrum Lemit;
+        const std::vector<std::shared_ptr<const Shape>> shapes;
+        const bool twoSided;
+        // total over the shapes
+        const Float area;
+
+    private:
+        // DiffuseAreaLight Private Data
+        AliasTable areaDistribution;
+    };
+
+    // environment light from an equirectangular map around the scene: +z of lightToWorld is the
+    // pole, u = phi / 2pi and v = theta / pi. Directions are importance sampled from a 2D piecewise
+    // constant distribution over the map's luminance, so a small bright sun is found right away.
+    class InfiniteAreaLight : public Light
+    {
+    public:
+        // InfiniteAreaLight Public Methods
+        // the map is a PFM file scaled by L; a missing or unreadable file gives a constant L
+        InfiniteAreaLight(const Transform &lightToWorld, const Spectrum &L, const std::string &filename);
+        // rgb: width * height RGB triples, top row (theta = 0) first
+        InfiniteAreaLight(const Transform &lightToWorld, const std::vector<Float> &rgb, int width, int height);
+        Spectrum Sample_Li(const Interaction &ref, const Point2f &u, Vector3f *wi, Float *pdf,
+                           Point3f *pLight) const override;
+        Spectrum Power() const override;
+        Spectrum Le(const Ray &ray) const override;
+        void Preprocess(const Bounds3f &worldBound) override;
+        // solid angle density of Sample_Li() choosing the world space direction w
+        Float Pdf_Li(const Vector3f &w) const;
+
+    private:
+        // InfiniteAreaLight Private Methods
+        void setMap(const std::vector<Float> &rgb, int width, int height);
+        // nearest texel: piecewise constant like the sampling distribution, so the two match exactly
+        Spectrum lookup(const Point2f &uv) const;
+
+        // InfiniteAreaLight Private Data
+        const Transform lightToWorld;
+        std::vector<Spectrum> texels;
+        int width = 1, height = 1;
+        std::unique_ptr<Distribution2D> distribution;
+        Point3f worldCenter;
+        Float worldRadius = 0;
     };
-}
\ No newline at end of file
+}
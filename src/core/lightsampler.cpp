@@ -0,0 +1,260 @@
+#include <core/lightsampler.hpp>
+#include <algorithm>
+#include <stdexcept>
+namespace reina
+{
+    LightSampling ParseLightSampling(const std::string &name)
+    {
+        if (name == "uniform")
+            return LightSampling::Uniform;
+        if (name == "power")
+            return LightSampling::Power;
+        if (name == "bvh")
+            return LightSampling::BVH;
+        throw std::invalid_argument("unknown light sampler \"" + name + "\"");
+    }
+
+    std::unique_ptr<LightSampler> CreateLightSampler(LightSampling method,
+                                                     const std::vector<std::shared_ptr<Light>> &lights)
+    {
+        switch (method)
+        {
+        case LightSampling::Uniform:
+            return std::make_unique<UniformLightSampler>(lights);
+        case LightSampling::Power:
+            return std::make_unique<PowerLightSampler>(lights);
+        default:
+            return std::make_unique<BVHLightSampler>(lights);
+        }
+    }
+
+    // UniformLightSampler Method Definitions
+    const Light *UniformLightSampler::Sample(const Interaction &ref, Float u, Float *pmf) const
+    {
+        if (lights.empty())
+            return nullptr;
+        int n = (int)lights.size();
+        *pmf = (Float)1 / n;
+        return lights[std::min((int)(u * n), n - 1)].get();
+    }
+
+    Float UniformLightSampler::PMF(const Interaction &ref, const Light *light) const
+    {
+        return lights.empty() ? 0 : (Float)1 / lights.size();
+    }
+
+    // PowerLightSampler Method Definitions
+    PowerLightSampler::PowerLightSampler(std::vector<std::shared_ptr<Light>> l) : lights(std::move(l))
+    {
+        std::vector<Float> power(lights.size());
+        for (size_t i = 0; i < lights.size(); ++i)
+        {
+            lightToIndex[lights[i].get()] = (int)i;
+            power[i] = lights[i]->Power().y();
+        }
+        distribution = AliasTable(power);
+    }
+
+    const Light *PowerLightSampler::Sample(const Interaction &ref, Float u, Float *pmf) const
+    {
+        if (lights.empty())
+            return nullptr;
+        return lights[distribution.Sample(u, pmf)].get();
+    }
+
+    Float PowerLightSampler::PMF(const Interaction &ref, const Light *light) const
+    {
+        auto it = lightToIndex.find(light);
+        return it == lightToIndex.end() ? 0 : distribution.PMF(it->second);
+    }
+
+    // BVHLightSampler Method Definitions
+    BVHLightSampler::BVHLightSampler(std::vector<std::shared_ptr<Light>> l) : lights(std::move(l))
+    {
+        std::vector<std::pair<int, LightBounds>> bvhLights;
+        for (size_t i = 0; i < lights.size(); ++i)
+        {
+            LightBounds lightBounds;
+            if (!lights[i]->Bounds(&lightBounds))
+                infiniteLights.push_back(lights[i].get());
+            else if (lightBounds.phi > 0)
+                bvhLights.push_back(std::make_pair((int)i, lightBounds));
+        }
+        if (!bvhLights.empty())
+        {
+            nodes.reserve(2 * bvhLights.size() - 1);
+            buildBVH(bvhLights, 0, (int)bvhLights.size(), -1);
+        }
+    }
+
+    namespace
+    {
+        // expected importance of a node: power, times the solid angle of the directions it emits into
+        // (the cone plus its falloff), times its surface area, with long thin bounds penalized
+        Float EvaluateCost(const LightBounds &b, const Bounds3f &bounds, int dim)
+        {
+            Float thetaO = SafeACos(b.cosThetaO), thetaE = SafeACos(b.cosThetaE);
+            Float thetaW = std::min(thetaO + thetaE, Pi);
+            Float sinThetaO = SafeSqrt(1 - b.cosThetaO * b.cosThetaO);
+            Float mOmega = 2 * Pi * (1 - b.cosThetaO) +
+                           Pi / 2 * (2 * thetaW * sinThetaO - std::cos(thetaO - 2 * thetaW) -
+                                     2 * thetaO * sinThetaO + b.cosThetaO);
+            Vector3f d = bounds.Diagonal();
+            Float kr = d[dim] > 0 ? MaxComponent(d) / d[dim] : 1;
+            return b.phi * mOmega * kr * b.bounds.SurfaceArea();
+        }
+    }
+
+    int BVHLightSampler::buildBVH(std::vector<std::pair<int, LightBounds>> &bvhLights, int start, int end,
+                                  int parent)
+    {
+        int nodeIndex = (int)nodes.size();
+        nodes.push_back(LightBVHNode());
+        if (end - start == 1)
+        {
+            nodes[nodeIndex] = LightBVHNode{bvhLights[start].second, bvhLights[start].first, parent, true};
+            lightToLeaf[lights[bvhLights[start].first].get()] = nodeIndex;
+            return nodeIndex;
+        }
+
+        Bounds3f bounds, centroidBounds;
+        for (int i = start; i < end; ++i)
+        {
+            bounds = Union(bounds, bvhLights[i].second.bounds);
+            centroidBounds = Union(centroidBounds, bvhLights[i].second.Centroid());
+        }
+
+        // binned split minimizing the summed cost of the two children
+        constexpr int nBuckets = 12;
+        Float minCost = Infinity;
+        int minBucket = -1, minDim = -1;
+        auto bucketOf = [&](const LightBounds &lb, int dim)
+        {
+            int b = (int)(nBuckets * centroidBounds.Offset(lb.Centroid())[dim]);
+            return Clamp(b, 0, nBuckets - 1);
+        };
+        for (int dim = 0; dim < 3; ++dim)
+        {
+            if (centroidBounds.pMax[dim] == centroidBounds.pMin[dim])
+                continue;
+            LightBounds bucketBounds[nBuckets];
+            for (int i = start; i < end; ++i)
+            {
+                int b = bucketOf(bvhLights[i].second, dim);
+                bucketBounds[b] = Union(bucketBounds[b], bvhLights[i].second);
+            }
+            // costs of splitting after each bucket, from a forward and a backward sweep
+            Float cost[nBuckets - 1];
+            LightBounds below, above;
+            for (int i = 0; i < nBuckets - 1; ++i)
+            {
+                below = Union(below, bucketBounds[i]);
+                cost[i] = EvaluateCost(below, bounds, dim);
+            }
+            for (int i = nBuckets - 1; i >= 1; --i)
+            {
+                above = Union(above, bucketBounds[i]);
+                cost[i - 1] += EvaluateCost(above, bounds, dim);
+            }
+            for (int i = 0; i < nBuckets - 1; ++i)
+                if (cost[i] > 0 && cost[i] < minCost)
+                {
+                    minCost = cost[i];
+                    minBucket = i;
+                    minDim = dim;
+                }
+        }
+
+        int mid = (start + end) / 2;
+        if (minDim != -1)
+        {
+            auto pmid = std::partition(bvhLights.begin() + start, bvhLights.begin() + end,
+                                       [&](const std::pair<int, LightBounds> &l)
+                                       { return bucketOf(l.second, minDim) <= minBucket; });
+            int splitAt = (int)(pmid - bvhLights.begin());
+            if (splitAt != start && splitAt != end)
+                mid = splitAt;
+        }
+
+        int child0 = buildBVH(bvhLights, start, mid, nodeIndex);
+        int child1 = buildBVH(bvhLights, mid, end, nodeIndex);
+        nodes[nodeIndex] = LightBVHNode{Union(nodes[child0].lightBounds, nodes[child1].lightBounds), child1,
+                                        parent, false};
+        return nodeIndex;
+    }
+
+    const Light *BVHLightSampler::Sample(const Interaction &ref, Float u, Float *pmf) const
+    {
+        // infinite lights first, each as likely as the whole tree
+        Float pInf = pInfinite();
+        if (u < pInf)
+        {
+            int n = (int)infiniteLights.size();
+            *pmf = pInf / n;
+            return infiniteLights[std::min((int)(u / pInf * n), n - 1)];
+        }
+        if (nodes.empty())
+            return nullptr;
+        u = std::min<Float>((u - pInf) / (1 - pInf), OneMinusEpsilon);
+
+        Float p = 1 - pInf;
+        int nodeIndex = 0;
+        while (true)
+        {
+            const LightBVHNode &node = nodes[nodeIndex];
+            if (node.isLeaf)
+            {
+                // a single light at the root has not been tested yet
+                if (nodeIndex > 0 || node.lightBounds.Importance(ref.p, ref.n) > 0)
+                {
+                    *pmf = p;
+                    return lights[node.childOrLightIndex].get();
+                }
+                return nullptr;
+            }
+            Float ci[2] = {nodes[nodeIndex + 1].lightBounds.Importance(ref.p, ref.n),
+                           nodes[node.childOrLightIndex].lightBounds.Importance(ref.p, ref.n)};
+            if (ci[0] == 0 && ci[1] == 0)
+                return nullptr;
+            // pick a child and rescale u to reuse it further down
+            Float p0 = ci[0] / (ci[0] + ci[1]);
+            if (u < p0)
+            {
+                nodeIndex = nodeIndex + 1;
+                u = std::min<Float>(u / p0, OneMinusEpsilon);
+                p *= p0;
+            }
+            else
+            {
+                nodeIndex = node.childOrLightIndex;
+                u = std::min<Float>((u - p0) / (1 - p0), OneMinusEpsilon);
+                p *= 1 - p0;
+            }
+        }
+    }
+
+    Float BVHLightSampler::PMF(const Interaction &ref, const Light *light) const
+    {
+        auto it = lightToLeaf.find(light);
+        if (it == lightToLeaf.end())
+        {
+            bool isInfinite = std::find(infiniteLights.begin(), infiniteLights.end(), light) != infiniteLights.end();
+            return isInfinite ? pInfinite() / infiniteLights.size() : 0;
+        }
+        int nodeIndex = it->second;
+        if (nodeIndex == 0)
+            return nodes[0].lightBounds.Importance(ref.p, ref.n) > 0 ? 1 - pInfinite() : 0;
+        // the probabilities of the choices that lead from the root down to the leaf
+        Float pmf = 1 - pInfinite();
+        for (int parent = nodes[nodeIndex].parent; parent != -1; nodeIndex = parent, parent = nodes[parent].parent)
+        {
+            Float ci[2] = {nodes[parent + 1].lightBounds.Importance(ref.p, ref.n),
+                           nodes[nodes[parent].childOrLightIndex].lightBounds.Importance(ref.p, ref.n)};
+            Float c = ci[nodeIndex == parent + 1 ? 0 : 1];
+            if (c == 0)
+                return 0;
+            pmf *= c / (ci[0] + ci[1]);
+        }
+        return pmf;
+    }
+}
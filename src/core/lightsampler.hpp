@@ -0,0 +1,101 @@
+#pragma once
+/***
+ *  LightSampler
+ *  UniformLightSampler
+ *  PowerLightSampler
+ *  BVHLightSampler
+ */
+#include <memory>
+#include <string>
+#include <unordered_map>
+#include <vector>
+#include <reina.hpp>
+#include <core/light.hpp>
+#include <core/sampling.hpp>
+
+namespace reina
+{
+    enum class LightSampling
+    {
+        Uniform, // every light equally likely
+        Power,   // proportional to emitted power
+        BVH,     // light BVH: power, distance and orientation as seen from the shading point
+    };
+    // "uniform", "power" or "bvh"; throws std::invalid_argument otherwise
+    LightSampling ParseLightSampling(const std::string &name);
+
+    // picks the light for next event estimation
+    class LightSampler
+    {
+    public:
+        virtual ~LightSampler() = default;
+        // a light for shading at ref with *pmf its probability, or nullptr if none can contribute
+        virtual const Light *Sample(const Interaction &ref, Float u, Float *pmf) const = 0;
+        // probability of Sample() returning light at ref
+        virtual Float PMF(const Interaction &ref, const Light *light) const = 0;
+    };
+
+    std::unique_ptr<LightSampler> CreateLightSampler(LightSampling method,
+                                                     const std::vector<std::shared_ptr<Light>> &lights);
+
+    class UniformLightSampler : public LightSampler
+    {
+    public:
+        UniformLightSampler(std::vector<std::shared_ptr<Light>> lights) : lights(std::move(lights)) {}
+        const Light *Sample(const Interaction &ref, Float u, Float *pmf) const override;
+        Float PMF(const Interaction &ref, const Light *light) const override;
+
+    private:
+        std::vector<std::shared_ptr<Light>> lights;
+    };
+
+    class PowerLightSampler : public LightSampler
+    {
+    public:
+        PowerLightSampler(std::vector<std::shared_ptr<Light>> lights);
+        const Light *Sample(const Interaction &ref, Float u, Float *pmf) const override;
+        Float PMF(const Interaction &ref, const Light *light) const override;
+
+    private:
+        std::vector<std::shared_ptr<Light>> lights;
+        AliasTable distribution;
+        std::unordered_map<const Light *, int> lightToIndex;
+    };
+
+    // depth-first flattened like LinearBVHNode: the first child directly follows its parent
+    struct LightBVHNode
+    {
+        LightBounds lightBounds;
+        int childOrLightIndex; // interior: second child, leaf: light index
+        int parent;            // -1 at the root
+        bool isLeaf;
+    };
+
+    // binary BVH over the bounded lights, one light per leaf. Sampling descends from the root picking
+    // each child with probability proportional to its LightBounds::Importance(), so a light is chosen
+    // in O(log n) and mostly among those that matter at the shading point. Infinite lights are chosen
+    // uniformly beside the tree.
+    class BVHLightSampler : public LightSampler
+    {
+    public:
+        // BVHLightSampler Public Methods
+        BVHLightSampler(std::vector<std::shared_ptr<Light>> lights);
+        const Light *Sample(const Interaction &ref, Float u, Float *pmf) const override;
+        Float PMF(const Interaction &ref, const Light *light) const override;
+        const std::vector<LightBVHNode> &GetNodes() const { return nodes; }
+
+    private:
+        // BVHLightSampler Private Methods
+        int buildBVH(std::vector<std::pair<int, LightBounds>> &bvhLights, int start, int end, int parent);
+        Float pInfinite() const
+        {
+            return (Float)infiniteLights.size() / (Float)(infiniteLights.size() + (nodes.empty() ? 0 : 1));
+        }
+
+        // BVHLightSampler Private Data
+        std::vector<std::shared_ptr<Light>> lights;
+        std::vector<const Light *> infiniteLights;
+        std::vector<LightBVHNode> nodes;
+        std::unordered_map<const Light *, int> lightToLeaf;
+    };
+}
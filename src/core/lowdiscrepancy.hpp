@@ -0,0 +1,80 @@
+#pragma once
+/***
+ *  Low-discrepancy points: the first two Sobol' dimensions and their randomizations
+ */
+#include <array>
+#include <cstdint>
+#include <reina.hpp>
+#include <utils/math.hpp>
+namespace reina
+{
+    // generator matrices, one 32-bit column per index bit. Dimension 0 is van der Corput (bit
+    // reversal), dimension 1 comes from the primitive polynomial x + 1: column i is the previous one
+    // xor'ed with itself shifted by one, which gives Pascal's triangle mod 2.
+    constexpr int SobolMatrixSize = 32;
+    constexpr std::array<uint32_t, 2 * SobolMatrixSize> SobolMatrices = []
+    {
+        std::array<uint32_t, 2 * SobolMatrixSize> m{};
+        for (int i = 0; i < SobolMatrixSize; ++i)
+            m[i] = 0x80000000u >> i;
+        m[SobolMatrixSize] = 0x80000000u;
+        for (int i = 1; i < SobolMatrixSize; ++i)
+            m[SobolMatrixSize + i] = m[SobolMatrixSize + i - 1] ^ (m[SobolMatrixSize + i - 1] >> 1);
+        return m;
+    }();
+
+    // randomizations of the 32-bit fixed point sample v, keyed by a per-dimension seed
+    struct NoRandomizer
+    {
+        uint32_t operator()(uint32_t v) const { return v; }
+    };
+
+    // flips bit b depending on the bits above it: a full Owen scramble, 31 hashes a sample
+    struct OwenScrambler
+    {
+        OwenScrambler(uint32_t seed) : seed(seed) {}
+        uint32_t operator()(uint32_t v) const
+        {
+            if (seed & 1)
+                v ^= 1u << 31;
+            for (int b = 1; b < 32; ++b)
+            {
+                uint32_t mask = (~0u) << (32 - b);
+                if ((uint32_t)MixBits((v & mask) ^ seed) & (1u << b))
+                    v ^= 1u << (31 - b);
+            }
+            return v;
+        }
+        uint32_t seed;
+    };
+
+    // Owen scrambling approximated by a nested-uniform hash of the reversed bits (Laine-Karras,
+    // with Vegdahl's constants): a few multiplies instead of 31 hashes
+    struct FastOwenScrambler
+    {
+        FastOwenScrambler(uint32_t seed) : seed(seed) {}
+        uint32_t operator()(uint32_t v) const
+        {
+            v = ReverseBits32(v);
+            v ^= v * 0x3d20adea;
+            v += seed;
+            v *= (seed >> 16) | 1;
+            v ^= v * 0x05526c56;
+            v ^= v * 0x53a22864;
+            return ReverseBits32(v);
+        }
+        uint32_t seed;
+    };
+
+    // point a of Sobol' dimension 0 or 1, randomized, in [0, 1)
+    template <typename R>
+    inline Float SobolSample(uint64_t a, int dimension, R randomizer)
+    {
+        uint32_t v = 0;
+        for (int i = dimension * SobolMatrixSize; a != 0; a >>= 1, i++)
+            if (a & 1)
+                v ^= SobolMatrices[i];
+        v = randomizer(v);
+        return std::min<Float>(v * 0x1p-32f, OneMinusEpsilon);
+    }
+}
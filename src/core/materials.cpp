@@ -0,0 +1,91 @@
+#include <core/materials.hpp>
+#include <core/sampling.hpp>
+namespace reina
+{
+    namespace
+    {
+        Vector3f ShadingTangent(const Vector3f &n)
+        {
+            Vector3f s, t;
+            CoordinateSystem(n, &s, &t);
+            return s;
+        }
+    }
+
+    // BxDF Method Definitions
+    Spectrum BxDF::Sample_f(const Vector3f &wo, Vector3f *wi, const Point2f &u, Float *pdf) const
+    {
+        *wi = CosineSampleHemisphere(u);
+        if (wo.z < 0)
+            wi->z *= -1;
+        *pdf = Pdf(wo, *wi);
+        return f(wo, *wi);
+    }
+
+    Float BxDF::Pdf(const Vector3f &wo, const Vector3f &wi) const
+    {
+        return SameHemisphere(wo, wi) ? AbsCosTheta(wi) * InvPi : 0;
+    }
+
+    // BSDF Method Definitions
+    BSDF::BSDF(const SurfaceInteraction &si)
+        : ng(Normalize(Vector3f(si.n))), ns(Normalize(Vector3f(si.shadingN))), ss(ShadingTangent(ns)),
+          ts(ns.Cross(ss))
+    {
+    }
+
+    Spectrum BSDF::f(const Vector3f &woW, const Vector3f &wiW) const
+    {
+        Vector3f wo = WorldToLocal(woW), wi = WorldToLocal(wiW);
+        if (wo.z == 0)
+            return Spectrum(0);
+        // the geometric normal decides whether this is reflection, against light leaks from
+        // interpolated normals; all lobes so far are reflective
+        if (wiW.Dot(ng) * woW.Dot(ng) <= 0)
+            return Spectrum(0);
+        Spectrum f(0);
+        for (int i = 0; i < nBxDFs; ++i)
+            f += bxdfs[i]->f(wo, wi);
+        return f;
+    }
+
+    Spectrum BSDF::Sample_f(const Vector3f &woW, Vector3f *wiW, Float uComponent, const Point2f &u,
+                            Float *pdf) const
+    {
+        *pdf = 0;
+        if (nBxDFs == 0)
+            return Spectrum(0);
+        int comp = std::min((int)(uComponent * nBxDFs), nBxDFs - 1);
+        Vector3f wo = WorldToLocal(woW), wi;
+        if (wo.z == 0)
+            return Spectrum(0);
+        bxdfs[comp]->Sample_f(wo, &wi, u, pdf);
+        if (*pdf == 0)
+            return Spectrum(0);
+        *wiW = LocalToWorld(wi);
+        *pdf = Pdf(woW, *wiW);
+        return f(woW, *wiW);
+    }
+
+    Float BSDF::Pdf(const Vector3f &woW, const Vector3f &wiW) const
+    {
+        if (nBxDFs == 0)
+            return 0;
+        Vector3f wo = WorldToLocal(woW), wi = WorldToLocal(wiW);
+        if (wo.z == 0)
+            return 0;
+        Float pdf = 0;
+        for (int i = 0; i < nBxDFs; ++i)
+            pdf += bxdfs[i]->Pdf(wo, wi);
+        return pdf / nBxDFs;
+    }
+
+    // MatteMaterial Method Definitions
+    void MatteMaterial::ComputeScatteringFunctions(SurfaceInteraction *si, MemoryArena &arena) const
+    {
+        si->bsdf = arena.New<BSDF>(*si);
+        Spectrum kd = Kd->Evaluate(*si);
+        if (!kd.IsBlack())
+            si->bsdf->Add(arena.New<LambertianReflection>(kd));
+    }
+}
@@ -1 +1,85 @@
-#pragma once
\ No newline at end of file
+#pragma once
+/***
+ *  BxDF
+ *  LambertianReflection
+ *  BSDF
+ *  Material
+ *  MatteMaterial
+ */
+#include <memory>
+#include <reina.hpp>
+#include <utils/vecmath.hpp>
+#include <utils/memory.hpp>
+#include <core/interaction.hpp>
+#include <core/spectrum.hpp>
+#include <core/texture.hpp>
+namespace reina
+{
+    // BxDFs work in the shading frame: the normal is +z
+    inline Float CosTheta(const Vector3f &w) { return w.z; }
+    inline Float AbsCosTheta(const Vector3f &w) { return std::abs(w.z); }
+    inline bool SameHemisphere(const Vector3f &w, const Vector3f &wp) { return w.z * wp.z > 0; }
+
+    class BxDF
+    {
+    public:
+        virtual ~BxDF() = default;
+        virtual Spectrum f(const Vector3f &wo, const Vector3f &wi) const = 0;
+        // default: cosine-weighted hemisphere on wo's side
+        virtual Spectrum Sample_f(const Vector3f &wo, Vector3f *wi, const Point2f &u, Float *pdf) const;
+        virtual Float Pdf(const Vector3f &wo, const Vector3f &wi) const;
+    };
+
+    class LambertianReflection : public BxDF
+    {
+    public:
+        LambertianReflection(const Spectrum &R) : R(R) {}
+        Spectrum f(const Vector3f &wo, const Vector3f &wi) const override { return R * InvPi; }
+
+    private:
+        const Spectrum R;
+    };
+
+    // the lobes at one shading point, mixed with equal probability when sampling; the BSDF and its
+    // lobes live in the MemoryArena of the thread shading the point
+    class BSDF
+    {
+    public:
+        // BSDF Public Methods
+        BSDF(const SurfaceInteraction &si);
+        void Add(BxDF *b) { bxdfs[nBxDFs++] = b; }
+        Vector3f WorldToLocal(const Vector3f &v) const { return Vector3f(v.Dot(ss), v.Dot(ts), v.Dot(ns)); }
+        Vector3f LocalToWorld(const Vector3f &v) const { return ss * v.x + ts * v.y + ns * v.z; }
+        Spectrum f(const Vector3f &woW, const Vector3f &wiW) const;
+        Spectrum Sample_f(const Vector3f &woW, Vector3f *wiW, Float uComponent, const Point2f &u,
+                          Float *pdf) const;
+        Float Pdf(const Vector3f &woW, const Vector3f &wiW) const;
+
+        static constexpr int MaxBxDFs = 8;
+
+    private:
+        // BSDF Private Data
+        const Vector3f ng, ns, ss, ts;
+        int nBxDFs = 0;
+        BxDF *bxdfs[MaxBxDFs];
+    };
+
+    class Material
+    {
+    public:
+        virtual ~Material() = default;
+        // sets si->bsdf, allocated from arena: it stays valid until the arena is reset
+        virtual void ComputeScatteringFunctions(SurfaceInteraction *si, MemoryArena &arena) const = 0;
+    };
+
+    class MatteMaterial : public Material
+    {
+    public:
+        MatteMaterial(const Spectrum &Kd) : Kd(std::make_shared<ConstantTexture<Spectrum>>(Kd)) {}
+        MatteMaterial(std::shared_ptr<Texture<Spectrum>> Kd) : Kd(std::move(Kd)) {}
+        void ComputeScatteringFunctions(SurfaceInteraction *si, MemoryArena &arena) const override;
+
+    private:
+        const std::shared_ptr<Texture<Spectrum>> Kd;
+    };
+}
@@ -0,0 +1,443 @@
+#include <core/mipmap.hpp>
+#include <utils/float.hpp>
+#include <utils/imageio.hpp>
+#include <utils/parallel.hpp>
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <fstream>
+#include <thread>
+#ifdef _WIN32
+#define NOMINMAX
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+namespace reina
+{
+    namespace
+    {
+        constexpr char Magic[8] = {'R', 'E', 'I', 'N', 'A', 'T', 'E', 'X'};
+        // tiles start on a page, and stay on one when their size is a multiple of it
+        constexpr uint64_t TilesAlignment = 4096;
+
+        struct TiledMIPMapHeader
+        {
+            char magic[8];
+            uint32_t version;
+            uint32_t tileSize;
+            int32_t width, height;
+            uint32_t nLevels;
+            uint32_t pad;
+            uint64_t tilesOffset;
+            uint64_t fileSize;
+        };
+
+        std::vector<Point2i> LevelResolutions(int width, int height)
+        {
+            std::vector<Point2i> resolutions = {Point2i(width, height)};
+            while (width > 1 || height > 1)
+            {
+                width = (width + 1) / 2;
+                height = (height + 1) / 2;
+                resolutions.push_back(Point2i(width, height));
+            }
+            return resolutions;
+        }
+
+        // a texel of the coarser level averages the texels it covers, weighted by the overlap; with
+        // an odd resolution it covers one and a half
+        struct BoxWeights
+        {
+            int first;
+            Float w[3];
+        };
+
+        std::vector<BoxWeights> ComputeBoxWeights(int from, int to)
+        {
+            std::vector<BoxWeights> weights(to);
+            Float scale = (Float)from / to;
+            for (int i = 0; i < to; ++i)
+            {
+                Float a = i * scale, b = (i + 1) * scale;
+                weights[i].first = (int)a;
+                for (int k = 0; k < 3; ++k)
+                {
+                    int j = weights[i].first + k;
+                    weights[i].w[k] = std::max((Float)0, std::min(b, (Float)(j + 1)) - std::max(a, (Float)j)) / scale;
+                }
+            }
+            return weights;
+        }
+
+        // the next level, from width and then height; RGB triples, rows bottom up
+        std::vector<Float> Downsample(const std::vector<Float> &level, const Point2i &res, const Point2i &next)
+        {
+            std::vector<BoxWeights> wx = ComputeBoxWeights(res.x, next.x), wy = ComputeBoxWeights(res.y, next.y);
+            std::vector<Float> rows((size_t)next.x * res.y * 3, 0), down((size_t)next.x * next.y * 3, 0);
+            for (int y = 0; y < res.y; ++y)
+                for (int x = 0; x < next.x; ++x)
+                    for (int k = 0; k < 3; ++k)
+                        if (wx[x].w[k] > 0)
+                            for (int c = 0; c < 3; ++c)
+                                rows[((size_t)y * next.x + x) * 3 + c] +=
+                                    wx[x].w[k] * level[((size_t)y * res.x + wx[x].first + k) * 3 + c];
+            for (int y = 0; y < next.y; ++y)
+                for (int k = 0; k < 3; ++k)
+                    if (wy[y].w[k] > 0)
+                        for (size_t i = 0; i < (size_t)next.x * 3; ++i)
+                            down[(size_t)y * next.x * 3 + i] +=
+                                wy[y].w[k] * rows[(size_t)(wy[y].first + k) * next.x * 3 + i];
+            return down;
+        }
+
+        int64_t CountTiles(const std::vector<Point2i> &resolutions, int tileSize)
+        {
+            int64_t n = 0;
+            for (const Point2i &res : resolutions)
+                n += (int64_t)((res.x + tileSize - 1) / tileSize) * ((res.y + tileSize - 1) / tileSize);
+            return n;
+        }
+
+        // positional reads, so that threads can share the file without a lock
+#ifdef _WIN32
+        intptr_t OpenFile(const std::string &filename)
+        {
+            HANDLE file = CreateFileA(filename.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING,
+                                      FILE_ATTRIBUTE_NORMAL, nullptr);
+            return file == INVALID_HANDLE_VALUE ? -1 : (intptr_t)file;
+        }
+        void CloseFile(intptr_t file) { CloseHandle((HANDLE)file); }
+        uint64_t FileSize(intptr_t file)
+        {
+            LARGE_INTEGER size;
+            return GetFileSizeEx((HANDLE)file, &size) ? (uint64_t)size.QuadPart : 0;
+        }
+        bool ReadAt(intptr_t file, void *data, size_t bytes, uint64_t offset)
+        {
+            OVERLAPPED overlapped = {};
+            overlapped.Offset = (DWORD)offset;
+            overlapped.OffsetHigh = (DWORD)(offset >> 32);
+            DWORD read;
+            return ReadFile((HANDLE)file, data, (DWORD)bytes, &read, &overlapped) && read == bytes;
+        }
+#else
+        intptr_t OpenFile(const std::string &filename) { return open(filename.c_str(), O_RDONLY); }
+        void CloseFile(intptr_t file) { close((int)file); }
+        uint64_t FileSize(intptr_t file)
+        {
+            struct stat st;
+            return fstat((int)file, &st) == 0 ? (uint64_t)st.st_size : 0;
+        }
+        bool ReadAt(intptr_t file, void *data, size_t bytes, uint64_t offset)
+        {
+            uint8_t *p = (uint8_t *)data;
+            while (bytes > 0)
+            {
+                ssize_t n = pread((int)file, p, bytes, (off_t)offset);
+                if (n <= 0)
+                    return false;
+                p += n;
+                bytes -= n;
+                offset += n;
+            }
+            return true;
+        }
+#endif
+    }
+
+    bool WriteTiledMIPMap(const std::string &imageFilename, const std::string &filename, int tileSize)
+    {
+        if (tileSize < 8 || tileSize > 256 || (tileSize & (tileSize - 1)) != 0)
+            return false;
+        std::vector<Float> image;
+        int width, height;
+        if (!ReadImage(imageFilename, &image, &width, &height))
+            return false;
+        std::vector<Point2i> resolutions = LevelResolutions(width, height);
+        const size_t tileBytes = (size_t)tileSize * tileSize * 3 * sizeof(uint16_t);
+
+        TiledMIPMapHeader header = {};
+        std::memcpy(header.magic, Magic, sizeof(Magic));
+        header.version = TiledMIPMapVersion;
+        header.tileSize = tileSize;
+        header.width = width;
+        header.height = height;
+        header.nLevels = (uint32_t)resolutions.size();
+        header.tilesOffset = TilesAlignment;
+        header.fileSize = header.tilesOffset + CountTiles(resolutions, tileSize) * tileBytes;
+        std::ofstream out(filename, std::ios::binary);
+        if (!out)
+            return false;
+        out.write((const char *)&header, sizeof(header));
+        std::vector<char> zeros(header.tilesOffset - sizeof(header), 0);
+        out.write(zeros.data(), zeros.size());
+
+        // texture space has (0, 0) at the lower left: rows go bottom up from here on
+        std::vector<Float> level(image.size());
+        for (int y = 0; y < height; ++y)
+            std::copy_n(&image[(size_t)(height - 1 - y) * width * 3], width * 3, &level[(size_t)y * width * 3]);
+        image = std::vector<Float>();
+        std::vector<uint16_t> tile((size_t)tileSize * tileSize * 3);
+        for (size_t l = 0; l < resolutions.size(); ++l)
+        {
+            const Point2i res = resolutions[l];
+            // tiles in row order; texels past the edge of the level repeat its last row and column
+            for (int ty = 0; ty < res.y; ty += tileSize)
+                for (int tx = 0; tx < res.x; tx += tileSize)
+                {
+                    for (int y = 0; y < tileSize; ++y)
+                        for (int x = 0; x < tileSize; ++x)
+                        {
+                            const Float *texel =
+                                &level[((size_t)std::min(ty + y, res.y - 1) * res.x + std::min(tx + x, res.x - 1)) * 3];
+                            for (int c = 0; c < 3; ++c)
+                                tile[((size_t)y * tileSize + x) * 3 + c] = FloatToHalf((float)texel[c]);
+                        }
+                    out.write((const char *)tile.data(), tileBytes);
+                }
+            if (l + 1 == resolutions.size())
+                break;
+            level = Downsample(level, res, resolutions[l + 1]);
+        }
+        out.close();
+        return out.good();
+    }
+
+    // TextureCache Method Definitions
+    TextureCache::TextureCache(size_t maxBytes, int tileSize)
+        : tileSize(tileSize), tileTexels((size_t)tileSize * tileSize), tileBytes(tileTexels * 3 * sizeof(uint16_t))
+    {
+        size_t minSlots = (size_t)MinSlotsPerThread * std::max(1, NumSystemCores());
+        nSlots = (int)std::min<size_t>(std::max(maxBytes / tileBytes, minSlots), 1 << 30);
+        slots.reset(new Slot[nSlots]);
+        texels.reset(new uint16_t[(size_t)nSlots * tileTexels * 3]);
+    }
+
+    bool TextureCache::pin(int slot, uint64_t key)
+    {
+        std::atomic<uint64_t> &state = slots[slot].state;
+        uint64_t s = state.load(std::memory_order_relaxed);
+        while ((s >> PinBits) == key)
+            if (state.compare_exchange_weak(s, s + 1, std::memory_order_acquire, std::memory_order_relaxed))
+                return true;
+        return false;
+    }
+
+    void TextureCache::load(const TiledMIPMap *mipmap, int32_t tile)
+    {
+        std::unique_lock<std::mutex> lock(mutex);
+        // resident or loading already
+        int32_t expected = TiledMIPMap::NotResident;
+        if (!mipmap->pageTable[tile].compare_exchange_strong(expected, TiledMIPMap::Loading))
+            return;
+        int slot = evict();
+        slots[slot].owner = mipmap;
+        slots[slot].tile = tile;
+        lock.unlock();
+
+        // the slot is Busy: nothing reads or evicts it while the disk is read
+        uint16_t *dst = &texels[(size_t)slot * tileTexels * 3];
+        mipmap->readTile(tile, dst);
+        tileLoads.fetch_add(1, std::memory_order_relaxed);
+        slots[slot].state.store(tileKey(mipmap->id, tile) << PinBits, std::memory_order_release);
+        mipmap->pageTable[tile].store(slot, std::memory_order_release);
+    }
+
+    int TextureCache::evict()
+    {
+        for (int64_t scanned = 0;; ++scanned)
+        {
+            Slot &slot = slots[clockHand];
+            int index = clockHand;
+            clockHand = clockHand + 1 == nSlots ? 0 : clockHand + 1;
+            // second chance for tiles hit since the hand last passed
+            if (slot.referenced.load(std::memory_order_relaxed))
+            {
+                slot.referenced.store(false, std::memory_order_relaxed);
+                continue;
+            }
+            // a pinned or loading slot is skipped; the pins are short, so one frees up soon
+            uint64_t state = slot.state.load(std::memory_order_relaxed);
+            if ((state & PinMask) == 0 && (state >> PinBits) != BusyKey &&
+                slot.state.compare_exchange_strong(state, BusyKey << PinBits, std::memory_order_acquire,
+                                                   std::memory_order_relaxed))
+            {
+                // lookups that still find the slot through the page table fail to pin it
+                if (slot.owner)
+                    slot.owner->pageTable[slot.tile].store(TiledMIPMap::NotResident, std::memory_order_relaxed);
+                slot.owner = nullptr;
+                slot.tile = -1;
+                return index;
+            }
+            if (scanned > 2 * (int64_t)nSlots)
+                std::this_thread::yield();
+        }
+    }
+
+    uint32_t TextureCache::registerMIPMap()
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        if (!freeIds.empty())
+        {
+            uint32_t id = freeIds.back();
+            freeIds.pop_back();
+            return id;
+        }
+        // the id 0xffff would make the BusyKey of tile 0xffffffff
+        return nextId < 0xffff ? nextId++ : 0;
+    }
+
+    void TextureCache::release(const TiledMIPMap *mipmap)
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        for (int i = 0; i < nSlots; ++i)
+            if (slots[i].owner == mipmap)
+            {
+                slots[i].state.store(0, std::memory_order_relaxed);
+                slots[i].referenced.store(false, std::memory_order_relaxed);
+                slots[i].owner = nullptr;
+                slots[i].tile = -1;
+            }
+        freeIds.push_back(mipmap->id);
+    }
+
+    // TiledMIPMap Method Definitions
+    std::shared_ptr<TiledMIPMap> TiledMIPMap::Open(const std::string &filename, TextureCache *cache)
+    {
+        intptr_t file = OpenFile(filename);
+        if (file == -1)
+            return nullptr;
+        std::shared_ptr<TiledMIPMap> mipmap(new TiledMIPMap(cache));
+        mipmap->file = file;
+        TiledMIPMapHeader header;
+        if (!ReadAt(file, &header, sizeof(header), 0) || std::memcmp(header.magic, Magic, sizeof(Magic)) != 0 ||
+            header.version != TiledMIPMapVersion || (int)header.tileSize != cache->TileSize() ||
+            header.width <= 0 || header.height <= 0 || header.fileSize != FileSize(file))
+            return nullptr;
+        std::vector<Point2i> resolutions = LevelResolutions(header.width, header.height);
+        int64_t nTiles = CountTiles(resolutions, header.tileSize);
+        if (header.nLevels != resolutions.size() || nTiles > std::numeric_limits<int32_t>::max() ||
+            header.tilesOffset + nTiles * cache->tileBytes != header.fileSize)
+            return nullptr;
+
+        mipmap->tileShift = Log2Int(header.tileSize);
+        mipmap->tilesOffset = header.tilesOffset;
+        int32_t firstTile = 0;
+        for (const Point2i &res : resolutions)
+        {
+            int nTilesX = (res.x + header.tileSize - 1) / header.tileSize;
+            int nTilesY = (res.y + header.tileSize - 1) / header.tileSize;
+            mipmap->levels.push_back({res, nTilesX, firstTile});
+            firstTile += nTilesX * nTilesY;
+        }
+        mipmap->nTiles = (int32_t)nTiles;
+        mipmap->pageTable.reset(new std::atomic<int32_t>[nTiles]);
+        for (int32_t i = 0; i < mipmap->nTiles; ++i)
+            mipmap->pageTable[i].store(NotResident, std::memory_order_relaxed);
+        mipmap->id = cache->registerMIPMap();
+        return mipmap->id != 0 ? mipmap : nullptr;
+    }
+
+    TiledMIPMap::~TiledMIPMap()
+    {
+        if (id != 0)
+            cache->release(this);
+        if (file != -1)
+            CloseFile(file);
+    }
+
+    template <typename F>
+    void TiledMIPMap::withTile(int32_t tile, F f) const
+    {
+        const uint64_t key = TextureCache::tileKey(id, tile);
+        while (true)
+        {
+            int32_t slot = pageTable[tile].load(std::memory_order_acquire);
+            if (slot >= 0 && cache->pin(slot, key))
+            {
+                cache->touch(slot);
+                f(cache->slotTexels(slot));
+                cache->unpin(slot);
+                return;
+            }
+            if (slot == Loading)
+                std::this_thread::yield();
+            else
+                cache->load(this, tile);
+        }
+    }
+
+    void TiledMIPMap::readTile(int32_t tile, uint16_t *texels) const
+    {
+        const size_t bytes = cache->tileBytes;
+        // a file damaged since Open() reads as black rather than failing the render
+        if (!ReadAt(file, texels, bytes, tilesOffset + (uint64_t)tile * bytes))
+            std::memset(texels, 0, bytes);
+    }
+
+    Spectrum TiledMIPMap::Texel(int level, int s, int t) const
+    {
+        const Point2i res = levels[level].resolution;
+        s %= res.x;
+        t %= res.y;
+        if (s < 0)
+            s += res.x;
+        if (t < 0)
+            t += res.y;
+        const int mask = cache->TileSize() - 1;
+        Spectrum texel;
+        withTile(tileIndex(level, s, t), [&](const uint16_t *texels)
+                 {
+            const uint16_t *p = &texels[(((t & mask) << tileShift) + (s & mask)) * 3];
+            texel = Spectrum(HalfToFloat(p[0]), HalfToFloat(p[1]), HalfToFloat(p[2])); });
+        return texel;
+    }
+
+    Spectrum TiledMIPMap::Bilerp(int level, const Point2f &st) const
+    {
+        const Point2i res = levels[level].resolution;
+        Float s = st.x * res.x - (Float)0.5, t = st.y * res.y - (Float)0.5;
+        Float s0f = std::floor(s), t0f = std::floor(t);
+        Float ds = s - s0f, dt = t - t0f;
+        // wrapped here already, so that the common case of all four texels in one tile is told apart
+        int s0 = (int)std::fmod(s0f, (Float)res.x), t0 = (int)std::fmod(t0f, (Float)res.y);
+        if (s0 < 0)
+            s0 += res.x;
+        if (t0 < 0)
+            t0 += res.y;
+        int s1 = s0 + 1 == res.x ? 0 : s0 + 1, t1 = t0 + 1 == res.y ? 0 : t0 + 1;
+        if ((s0 >> tileShift) != (s1 >> tileShift) || (t0 >> tileShift) != (t1 >> tileShift))
+            return (1 - ds) * (1 - dt) * Texel(level, s0, t0) + ds * (1 - dt) * Texel(level, s1, t0) +
+                   (1 - ds) * dt * Texel(level, s0, t1) + ds * dt * Texel(level, s1, t1);
+        const int mask = cache->TileSize() - 1;
+        Spectrum result;
+        withTile(tileIndex(level, s0, t0), [&](const uint16_t *texels)
+                 {
+            const uint16_t *p00 = &texels[(((t0 & mask) << tileShift) + (s0 & mask)) * 3];
+            const uint16_t *p10 = &texels[(((t0 & mask) << tileShift) + (s1 & mask)) * 3];
+            const uint16_t *p01 = &texels[(((t1 & mask) << tileShift) + (s0 & mask)) * 3];
+            const uint16_t *p11 = &texels[(((t1 & mask) << tileShift) + (s1 & mask)) * 3];
+            for (int c = 0; c < 3; ++c)
+                result[c] = (1 - ds) * (1 - dt) * HalfToFloat(p00[c]) + ds * (1 - dt) * HalfToFloat(p10[c]) +
+                            (1 - ds) * dt * HalfToFloat(p01[c]) + ds * dt * HalfToFloat(p11[c]); });
+        return result;
+    }
+
+    Spectrum TiledMIPMap::Lookup(const Point2f &st, Float width) const
+    {
+        // level l has texels about 2^l / (finest resolution) apart
+        const Point2i res = levels[0].resolution;
+        Float level = std::log2(std::max(width * std::max(res.x, res.y), (Float)1e-8));
+        int nLevels = Levels();
+        if (!(level > 0))
+            return Bilerp(0, st);
+        if (level >= nLevels - 1)
+            return Texel(nLevels - 1, 0, 0);
+        int iLevel = (int)level;
+        Float delta = level - iLevel;
+        return (1 - delta) * Bilerp(iLevel, st) + delta * Bilerp(iLevel + 1, st);
+    }
+}
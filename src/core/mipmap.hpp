@@ -0,0 +1,153 @@
+#pragma once
+/***
+ *  TextureCache: fixed-size, thread-safe cache of MIP map tiles
+ *  TiledMIPMap: MIP pyramid kept on disk in tiles, read through a TextureCache
+ *
+ *  Images are pre-tiled once by WriteTiledMIPMap() into a pyramid of half-float RGB tiles; at
+ *  render time only the tiles lookups touch are resident, in a cache of a fixed number of slots.
+ *  A hit takes no lock: the tile is found through its MIP map's page table and pinned with one
+ *  compare-and-swap. Misses serialize on a mutex only to pick a victim, with CLOCK (an
+ *  approximation of LRU that costs hits nothing but a flag), and read the disk after releasing it.
+ */
+#include <atomic>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+#include <reina.hpp>
+#include <utils/vecmath.hpp>
+#include <utils/memory.hpp>
+#include <core/spectrum.hpp>
+namespace reina
+{
+    class TiledMIPMap;
+
+    constexpr uint32_t TiledMIPMapVersion = 1;
+
+    // pre-tiles a PFM into a MIP pyramid of tileSize x tileSize tiles, tileSize a power of two in
+    // [8, 256]. Levels halve the resolution, rounding up, down to 1 x 1, box filtered by coverage.
+    // Returns false if the image cannot be read or the file written.
+    bool WriteTiledMIPMap(const std::string &imageFilename, const std::string &filename, int tileSize = 64);
+
+    class TextureCache
+    {
+    public:
+        // TextureCache Public Methods
+        // holds maxBytes of tiles, but never fewer than a few per thread: lookups pin one tile at
+        // a time and each thread loads at most one, so that many slots always leave a victim
+        explicit TextureCache(size_t maxBytes, int tileSize = 64);
+        TextureCache(const TextureCache &) = delete;
+        TextureCache &operator=(const TextureCache &) = delete;
+        int TileSize() const { return tileSize; }
+        int Slots() const { return nSlots; }
+        size_t MemoryUsed() const { return (size_t)nSlots * tileBytes; }
+        // tiles read from disk so far, i.e. misses
+        int64_t TileLoads() const { return tileLoads.load(std::memory_order_relaxed); }
+
+    private:
+        friend class TiledMIPMap;
+        // a slot's state packs the key of the tile it holds and the count of lookups pinning it;
+        // keys are (MIP map id << 32 | tile), 0 when empty, BusyKey while being evicted or loaded
+        static constexpr int PinBits = 16;
+        static constexpr uint64_t PinMask = (1ull << PinBits) - 1;
+        static constexpr uint64_t BusyKey = (1ull << (64 - PinBits)) - 1;
+        static constexpr int MinSlotsPerThread = 4;
+
+        struct alignas(CacheLineSize) Slot
+        {
+            std::atomic<uint64_t> state{0};
+            // CLOCK's reference bit, set by hits
+            std::atomic<bool> referenced{false};
+            // written under the mutex while the slot is Busy
+            const TiledMIPMap *owner = nullptr;
+            int32_t tile = -1;
+        };
+
+        // TextureCache Private Methods
+        static uint64_t tileKey(uint32_t id, int32_t tile) { return (uint64_t)id << 32 | (uint32_t)tile; }
+        const uint16_t *slotTexels(int slot) const { return &texels[(size_t)slot * tileTexels * 3]; }
+        // false if the slot no longer holds key; else the texels stay put until unpin()
+        bool pin(int slot, uint64_t key);
+        void unpin(int slot) { slots[slot].state.fetch_sub(1, std::memory_order_release); }
+        void touch(int slot)
+        {
+            if (!slots[slot].referenced.load(std::memory_order_relaxed))
+                slots[slot].referenced.store(true, std::memory_order_relaxed);
+        }
+        // loads the tile unless it is resident or another thread is loading it
+        void load(const TiledMIPMap *mipmap, int32_t tile);
+        // claims an unpinned slot, under the mutex, and unmaps its previous tile
+        int evict();
+        uint32_t registerMIPMap();
+        // drops the MIP map's tiles; it must have no lookups in flight
+        void release(const TiledMIPMap *mipmap);
+
+        // TextureCache Private Data
+        const int tileSize;
+        const size_t tileTexels, tileBytes;
+        int nSlots;
+        std::unique_ptr<Slot[]> slots;
+        std::unique_ptr<uint16_t[]> texels;
+        std::mutex mutex;
+        int clockHand = 0;
+        std::vector<uint32_t> freeIds;
+        uint32_t nextId = 1;
+        std::atomic<int64_t> tileLoads{0};
+    };
+
+    class TiledMIPMap
+    {
+    public:
+        // TiledMIPMap Public Methods
+        // nullptr if the file is missing, not a tiled MIP map of this version, or tiled with
+        // another size than the cache's
+        static std::shared_ptr<TiledMIPMap> Open(const std::string &filename, TextureCache *cache);
+        ~TiledMIPMap();
+        TiledMIPMap(const TiledMIPMap &) = delete;
+        TiledMIPMap &operator=(const TiledMIPMap &) = delete;
+        int Levels() const { return (int)levels.size(); }
+        Point2i LevelResolution(int level) const { return levels[level].resolution; }
+        // coordinates wrap around: textures repeat
+        Spectrum Texel(int level, int s, int t) const;
+        Spectrum Bilerp(int level, const Point2f &st) const;
+        // trilinear filtering between the two levels whose texel spacing brackets width, the
+        // footprint of the lookup in st space
+        Spectrum Lookup(const Point2f &st, Float width) const;
+
+    private:
+        friend class TextureCache;
+        static constexpr int32_t NotResident = -1, Loading = -2;
+
+        struct Level
+        {
+            Point2i resolution;
+            int nTilesX;
+            int32_t firstTile;
+        };
+
+        // TiledMIPMap Private Methods
+        TiledMIPMap(TextureCache *cache) : cache(cache) {}
+        int32_t tileIndex(int level, int s, int t) const
+        {
+            return levels[level].firstTile + (t >> tileShift) * levels[level].nTilesX + (s >> tileShift);
+        }
+        // calls f with the texels of the tile, pinned in the cache meanwhile
+        template <typename F>
+        void withTile(int32_t tile, F f) const;
+        // reads the tile from disk; zeros if that fails
+        void readTile(int32_t tile, uint16_t *texels) const;
+
+        // TiledMIPMap Private Data
+        TextureCache *cache;
+        uint32_t id = 0;
+        // file descriptor, or HANDLE on Windows
+        intptr_t file = -1;
+        int tileShift = 0;
+        uint64_t tilesOffset = 0;
+        std::vector<Level> levels;
+        // the cache slot of every tile, or NotResident / Loading
+        std::unique_ptr<std::atomic<int32_t>[]> pageTable;
+        int32_t nTiles = 0;
+    };
+}
@@ -0,0 +1,103 @@
+#include <core/primitive.hpp>
+namespace reina
+{
+    // GeometricPrimitive Method Definitions
+    Bounds3f GeometricPrimitive::WorldBound() const
+    {
+        return shape->WorldBound();
+    }
+
+    bool GeometricPrimitive::Intersect(const Ray &ray, SurfaceInteraction *isect) const
+    {
+        Float tHit;
+        if (!shape->Intersect(ray, &tHit, isect))
+            return false;
+        ray.tMax = tHit;
+        isect->primitive = this;
+        return true;
+    }
+
+    bool GeometricPrimitive::IntersectP(const Ray &ray) const
+    {
+        return shape->IntersectP(ray);
+    }
+
+    // MeshPrimitive Method Definitions
+    Bounds3f MeshPrimitive::WorldBound() const
+    {
+        Bounds3f b;
+        for (int i = 0; i < mesh->nTriangles; ++i)
+            b = Union(b, PartBound(i));
+        return b;
+    }
+
+    Bounds3f MeshPrimitive::WorldBoundAt(Float time) const
+    {
+        Bounds3f b;
+        for (int i = 0; i < mesh->nTriangles; ++i)
+            b = Union(b, PartBoundAt(i, time));
+        return b;
+    }
+
+    bool MeshPrimitive::Intersect(const Ray &ray, SurfaceInteraction *isect) const
+    {
+        bool hit = false;
+        for (int i = 0; i < mesh->nTriangles; ++i)
+            hit |= IntersectPart(i, ray, isect);
+        return hit;
+    }
+
+    bool MeshPrimitive::IntersectP(const Ray &ray) const
+    {
+        for (int i = 0; i < mesh->nTriangles; ++i)
+            if (IntersectPPart(i, ray))
+                return true;
+        return false;
+    }
+
+    bool MeshPrimitive::IntersectPart(int part, const Ray &ray, SurfaceInteraction *isect) const
+    {
+        Float tHit;
+        if (!Triangle(mesh.get(), part).Intersect(ray, &tHit, isect))
+            return false;
+        ray.tMax = tHit;
+        isect->primitive = this;
+        return true;
+    }
+
+    // Instance Method Definitions
+    Instance::Instance(std::shared_ptr<const Aggregate> blas, const AnimatedTransform &instanceToWorld)
+        : blas(std::move(blas)), instanceToWorld(instanceToWorld)
+    {
+    }
+
+    Bounds3f Instance::WorldBoundAt(Float time) const
+    {
+        // a motion BVH lerps between the boxes at 0 and 1, which a rotating path leaves: those get
+        // the box of the whole shutter at both ends
+        if (instanceToWorld.HasRotation())
+            return WorldBound();
+        Transform interpolated;
+        return toWorldAt(time, &interpolated)(blas->WorldBound());
+    }
+
+    bool Instance::Intersect(const Ray &ray, SurfaceInteraction *isect) const
+    {
+        Transform interpolated;
+        const Transform &toWorld = toWorldAt(ray.time, &interpolated);
+        // trace in object space; the unnormalized direction keeps t comparable
+        Ray r = toWorld.ApplyInverse(ray);
+        if (!blas->Intersect(r, isect))
+            return false;
+        ray.tMax = r.tMax;
+        if (!toWorld.IsIdentity())
+            *isect = toWorld(*isect);
+        return true;
+    }
+
+    bool Instance::IntersectP(const Ray &ray) const
+    {
+        Transform interpolated;
+        return blas->IntersectP(toWorldAt(ray.time, &interpolated).ApplyInverse(ray));
+    }
+}
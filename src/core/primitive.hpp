@@ -1 +1,135 @@
-#pragma once
\ No newline at end of file
+#pragma once
+/***
+ *  Primitive
+ *  GeometricPrimitive
+ *  MeshPrimitive
+ *  Instance
+ *  Aggregate
+ */
+#include <memory>
+#include <vector>
+#include <reina.hpp>
+#include <utils/vecmath.hpp>
+#include <core/transform.hpp>
+#include <core/ray.hpp>
+#include <core/interaction.hpp>
+#include <core/shapes.hpp>
+namespace reina
+{
+    class Primitive
+    {
+    public:
+        virtual ~Primitive() = default;
+        virtual Bounds3f WorldBound() const = 0;
+        // bounds at a shutter time in [0, 1]; WorldBound() covers the whole shutter
+        virtual Bounds3f WorldBoundAt(Float time) const { return WorldBound(); }
+        // on a hit, ray.tMax is shortened to the hit distance
+        virtual bool Intersect(const Ray &ray, SurfaceInteraction *isect) const = 0;
+        virtual bool IntersectP(const Ray &ray) const = 0;
+        // null for aggregates and for surfaces that only emit
+        virtual const Material *GetMaterial() const { return nullptr; }
+        virtual const AreaLight *GetAreaLight() const { return nullptr; }
+
+        // a BVH bounds and tests the parts of a primitive one by one, e.g. the triangles of a
+        // mesh; its leaves reference a part as a (primitive, part) pair. One part by default
+        virtual int NumParts() const { return 1; }
+        virtual Bounds3f PartBound(int part) const { return WorldBound(); }
+        virtual Bounds3f PartBoundAt(int part, Float time) const { return WorldBoundAt(time); }
+        virtual bool IntersectPart(int part, const Ray &ray, SurfaceInteraction *isect) const
+        {
+            return Intersect(ray, isect);
+        }
+        virtual bool IntersectPPart(int part, const Ray &ray) const { return IntersectP(ray); }
+    };
+
+    class GeometricPrimitive : public Primitive
+    {
+    public:
+        // GeometricPrimitive Public Methods
+        GeometricPrimitive(const std::shared_ptr<Shape> &shape, std::shared_ptr<const Material> material = nullptr,
+                           std::shared_ptr<const AreaLight> areaLight = nullptr)
+            : shape(shape), material(std::move(material)), areaLight(std::move(areaLight)) {}
+        Bounds3f WorldBound() const override;
+        Bounds3f WorldBoundAt(Float time) const override { return shape->WorldBoundAt(time); }
+        bool Intersect(const Ray &ray, SurfaceInteraction *isect) const override;
+        bool IntersectP(const Ray &ray) const override;
+        const std::shared_ptr<Shape> &GetShape() const { return shape; }
+        const Material *GetMaterial() const override { return material.get(); }
+        const AreaLight *GetAreaLight() const override { return areaLight.get(); }
+
+    private:
+        // GeometricPrimitive Private Data
+        std::shared_ptr<Shape> shape;
+        std::shared_ptr<const Material> material;
+        std::shared_ptr<const AreaLight> areaLight;
+    };
+
+    // a whole triangle mesh with one material and area light; its parts are the triangles, so a BVH
+    // over it stores 8 bytes a triangle and no per-triangle objects
+    class MeshPrimitive : public Primitive
+    {
+    public:
+        // MeshPrimitive Public Methods
+        MeshPrimitive(std::shared_ptr<TriangleMesh> mesh, std::shared_ptr<const Material> material = nullptr,
+                      std::shared_ptr<const AreaLight> areaLight = nullptr)
+            : mesh(std::move(mesh)), material(std::move(material)), areaLight(std::move(areaLight)) {}
+        Bounds3f WorldBound() const override;
+        Bounds3f WorldBoundAt(Float time) const override;
+        // every triangle in turn; a BVH tests them through IntersectPart() instead
+        bool Intersect(const Ray &ray, SurfaceInteraction *isect) const override;
+        bool IntersectP(const Ray &ray) const override;
+        const Material *GetMaterial() const override { return material.get(); }
+        const AreaLight *GetAreaLight() const override { return areaLight.get(); }
+        int NumParts() const override { return mesh->nTriangles; }
+        Bounds3f PartBound(int part) const override { return Triangle(mesh.get(), part).WorldBound(); }
+        Bounds3f PartBoundAt(int part, Float time) const override
+        {
+            return Triangle(mesh.get(), part).WorldBoundAt(time);
+        }
+        bool IntersectPart(int part, const Ray &ray, SurfaceInteraction *isect) const override;
+        bool IntersectPPart(int part, const Ray &ray) const override
+        {
+            return Triangle(mesh.get(), part).IntersectP(ray);
+        }
+        const std::shared_ptr<TriangleMesh> &GetMesh() const { return mesh; }
+
+    private:
+        // MeshPrimitive Private Data
+        std::shared_ptr<TriangleMesh> mesh;
+        std::shared_ptr<const Material> material;
+        std::shared_ptr<const AreaLight> areaLight;
+    };
+
+    class Aggregate : public Primitive
+    {
+    };
+
+    // one placement of a shared bottom-level aggregate; a BVHAccel over instances is the top level.
+    // The placement may move over the shutter, following each ray's time
+    class Instance : public Primitive
+    {
+    public:
+        // Instance Public Methods
+        Instance(std::shared_ptr<const Aggregate> blas, const AnimatedTransform &instanceToWorld);
+        // recomputed on every call so that it follows a refit of the shared aggregate
+        Bounds3f WorldBound() const override { return instanceToWorld.MotionBounds(blas->WorldBound()); }
+        Bounds3f WorldBoundAt(Float time) const override;
+        bool Intersect(const Ray &ray, SurfaceInteraction *isect) const override;
+        bool IntersectP(const Ray &ray) const override;
+
+    private:
+        // Instance Private Methods
+        // static placements are returned as they are, without a copy
+        const Transform &toWorldAt(Float time, Transform *interpolated) const
+        {
+            if (!instanceToWorld.IsAnimated())
+                return instanceToWorld.StartTransform();
+            instanceToWorld.Interpolate(time, interpolated);
+            return *interpolated;
+        }
+
+        // Instance Private Data
+        std::shared_ptr<const Aggregate> blas;
+        AnimatedTransform instanceToWorld;
+    };
+}
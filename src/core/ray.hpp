@@ -6,6 +6,9 @@
 #include <reina.hpp>
 #include <utils/vecmath.hpp>
 #include <core/medium.hpp>
+#if defined(__SSE2__) || defined(_M_X64)
+#include <immintrin.h>
+#endif
 
 namespace reina
 {
@@ -66,4 +69,147 @@ namespace reina
         Vector3f rxDirection, ryDirection;
     };
 
-}
\ No newline at end of file
+
+    // Bounds3 slab tests
+    template <typename T>
+    inline bool Bounds3<T>::IntersectP(const Ray &ray, Float *hitt0, Float *hitt1) const
+    {
+        Float t0 = 0, t1 = ray.tMax;
+        for (int i = 0; i < 3; ++i)
+        {
+            Float invRayDir = 1 / ray.d[i];
+            Float tNear = (pMin[i] - ray.o[i]) * invRayDir;
+            Float tFar = (pMax[i] - ray.o[i]) * invRayDir;
+            if (tNear > tFar)
+                std::swap(tNear, tFar);
+            tFar *= 1 + 2 * gamma(3);
+            t0 = tNear > t0 ? tNear : t0;
+            t1 = tFar < t1 ? tFar : t1;
+            if (t0 > t1)
+                return false;
+        }
+        if (hitt0)
+            *hitt0 = t0;
+        if (hitt1)
+            *hitt1 = t1;
+        return true;
+    }
+
+    template <typename T>
+    inline bool Bounds3<T>::IntersectP(const Ray &ray, const Vector3f &invDir,
+                                       const int dirIsNeg[3]) const
+    {
+        // near/far slabs are picked by the sign of the direction, no swaps
+        const Bounds3<T> &bounds = *this;
+        Float tMin = (bounds[dirIsNeg[0]].x - ray.o.x) * invDir.x;
+        Float tMax = (bounds[1 - dirIsNeg[0]].x - ray.o.x) * invDir.x;
+        Float tyMin = (bounds[dirIsNeg[1]].y - ray.o.y) * invDir.y;
+        Float tyMax = (bounds[1 - dirIsNeg[1]].y - ray.o.y) * invDir.y;
+        Float tzMin = (bounds[dirIsNeg[2]].z - ray.o.z) * invDir.z;
+        Float tzMax = (bounds[1 - dirIsNeg[2]].z - ray.o.z) * invDir.z;
+        const Float scale = 1 + 2 * gamma(3);
+        // accumulators go first: a NaN slab (origin on a plane, 0 * inf) is then ignored
+        Float t0 = std::max((Float)0, tMin);
+        t0 = std::max(t0, tyMin);
+        t0 = std::max(t0, tzMin);
+        Float t1 = std::min(ray.tMax, tMax * scale);
+        t1 = std::min(t1, tyMax * scale);
+        t1 = std::min(t1, tzMax * scale);
+        return t0 <= t1;
+    }
+
+    // WideBounds3f slab test
+    template <int N>
+    inline int WideBounds3f<N>::IntersectP(const Ray &ray, const Vector3f &invDir,
+                                           const int dirIsNeg[3], Float *tNear) const
+    {
+        const Float *nearX = dirIsNeg[0] ? pMax[0] : pMin[0];
+        const Float *farX = dirIsNeg[0] ? pMin[0] : pMax[0];
+        const Float *nearY = dirIsNeg[1] ? pMax[1] : pMin[1];
+        const Float *farY = dirIsNeg[1] ? pMin[1] : pMax[1];
+        const Float *nearZ = dirIsNeg[2] ? pMax[2] : pMin[2];
+        const Float *farZ = dirIsNeg[2] ? pMin[2] : pMax[2];
+        const Float scale = 1 + 2 * gamma(3);
+        int hits = 0;
+        int i = 0;
+#ifndef REINA_FLOAT_AS_DOUBLE
+#if defined(__AVX512F__)
+        if constexpr (N % 16 == 0)
+        {
+            const __m512 ox = _mm512_set1_ps(ray.o.x), oy = _mm512_set1_ps(ray.o.y), oz = _mm512_set1_ps(ray.o.z);
+            const __m512 ix = _mm512_set1_ps(invDir.x), iy = _mm512_set1_ps(invDir.y), iz = _mm512_set1_ps(invDir.z);
+            const __m512 s = _mm512_set1_ps(scale), zero = _mm512_setzero_ps(), rayTMax = _mm512_set1_ps(ray.tMax);
+            for (; i < N; i += 16)
+            {
+                __m512 t0 = _mm512_max_ps(_mm512_mul_ps(_mm512_sub_ps(_mm512_load_ps(nearX + i), ox), ix), zero);
+                t0 = _mm512_max_ps(_mm512_mul_ps(_mm512_sub_ps(_mm512_load_ps(nearY + i), oy), iy), t0);
+                t0 = _mm512_max_ps(_mm512_mul_ps(_mm512_sub_ps(_mm512_load_ps(nearZ + i), oz), iz), t0);
+                __m512 t1 = _mm512_min_ps(_mm512_mul_ps(_mm512_sub_ps(_mm512_load_ps(farX + i), ox), ix), rayTMax);
+                t1 = _mm512_min_ps(_mm512_mul_ps(_mm512_sub_ps(_mm512_load_ps(farY + i), oy), iy), t1);
+                t1 = _mm512_min_ps(_mm512_mul_ps(_mm512_sub_ps(_mm512_load_ps(farZ + i), oz), iz), t1);
+                hits |= (int)_mm512_cmp_ps_mask(t0, _mm512_mul_ps(t1, s), _CMP_LE_OQ) << i;
+                if (tNear)
+                    _mm512_storeu_ps(tNear + i, t0);
+            }
+            return hits;
+        }
+#endif
+#if defined(__AVX__)
+        if constexpr (N % 8 == 0)
+        {
+            const __m256 ox = _mm256_set1_ps(ray.o.x), oy = _mm256_set1_ps(ray.o.y), oz = _mm256_set1_ps(ray.o.z);
+            const __m256 ix = _mm256_set1_ps(invDir.x), iy = _mm256_set1_ps(invDir.y), iz = _mm256_set1_ps(invDir.z);
+            const __m256 s = _mm256_set1_ps(scale), zero = _mm256_setzero_ps(), rayTMax = _mm256_set1_ps(ray.tMax);
+            for (; i < N; i += 8)
+            {
+                __m256 t0 = _mm256_max_ps(_mm256_mul_ps(_mm256_sub_ps(_mm256_load_ps(nearX + i), ox), ix), zero);
+                t0 = _mm256_max_ps(_mm256_mul_ps(_mm256_sub_ps(_mm256_load_ps(nearY + i), oy), iy), t0);
+                t0 = _mm256_max_ps(_mm256_mul_ps(_mm256_sub_ps(_mm256_load_ps(nearZ + i), oz), iz), t0);
+                __m256 t1 = _mm256_min_ps(_mm256_mul_ps(_mm256_sub_ps(_mm256_load_ps(farX + i), ox), ix), rayTMax);
+                t1 = _mm256_min_ps(_mm256_mul_ps(_mm256_sub_ps(_mm256_load_ps(farY + i), oy), iy), t1);
+                t1 = _mm256_min_ps(_mm256_mul_ps(_mm256_sub_ps(_mm256_load_ps(farZ + i), oz), iz), t1);
+                hits |= _mm256_movemask_ps(_mm256_cmp_ps(t0, _mm256_mul_ps(t1, s), _CMP_LE_OQ)) << i;
+                if (tNear)
+                    _mm256_storeu_ps(tNear + i, t0);
+            }
+            return hits;
+        }
+#endif
+#if defined(__SSE2__) || defined(_M_X64)
+        if constexpr (N % 4 == 0)
+        {
+            const __m128 ox = _mm_set1_ps(ray.o.x), oy = _mm_set1_ps(ray.o.y), oz = _mm_set1_ps(ray.o.z);
+            const __m128 ix = _mm_set1_ps(invDir.x), iy = _mm_set1_ps(invDir.y), iz = _mm_set1_ps(invDir.z);
+            const __m128 s = _mm_set1_ps(scale), zero = _mm_setzero_ps(), rayTMax = _mm_set1_ps(ray.tMax);
+            for (; i < N; i += 4)
+            {
+                __m128 t0 = _mm_max_ps(_mm_mul_ps(_mm_sub_ps(_mm_load_ps(nearX + i), ox), ix), zero);
+                t0 = _mm_max_ps(_mm_mul_ps(_mm_sub_ps(_mm_load_ps(nearY + i), oy), iy), t0);
+                t0 = _mm_max_ps(_mm_mul_ps(_mm_sub_ps(_mm_load_ps(nearZ + i), oz), iz), t0);
+                __m128 t1 = _mm_min_ps(_mm_mul_ps(_mm_sub_ps(_mm_load_ps(farX + i), ox), ix), rayTMax);
+                t1 = _mm_min_ps(_mm_mul_ps(_mm_sub_ps(_mm_load_ps(farY + i), oy), iy), t1);
+                t1 = _mm_min_ps(_mm_mul_ps(_mm_sub_ps(_mm_load_ps(farZ + i), oz), iz), t1);
+                hits |= _mm_movemask_ps(_mm_cmple_ps(t0, _mm_mul_ps(t1, s))) << i;
+                if (tNear)
+                    _mm_storeu_ps(tNear + i, t0);
+            }
+            return hits;
+        }
+#endif
+#endif
+        // scalar fallback
+        for (; i < N; ++i)
+        {
+            Float t0 = std::max((Float)0, (nearX[i] - ray.o.x) * invDir.x);
+            t0 = std::max(t0, (nearY[i] - ray.o.y) * invDir.y);
+            t0 = std::max(t0, (nearZ[i] - ray.o.z) * invDir.z);
+            Float t1 = std::min(ray.tMax, (farX[i] - ray.o.x) * invDir.x);
+            t1 = std::min(t1, (farY[i] - ray.o.y) * invDir.y);
+            t1 = std::min(t1, (farZ[i] - ray.o.z) * invDir.z);
+            hits |= (t0 <= t1 * scale) << i;
+            if (tNear)
+                tNear[i] = t0;
+        }
+        return hits;
+    }
+}
@@ -0,0 +1,161 @@
+#pragma once
+/***
+ *  RayPacket / HitPacket: N coherent rays and their hits, SoA
+ *  RayStream / HitStream: arbitrary ray counts, SoA
+ */
+#include <cstdint>
+#include <vector>
+#include <reina.hpp>
+#include <core/ray.hpp>
+#include <core/interaction.hpp>
+namespace reina
+{
+    template <int N>
+    class alignas(N * sizeof(Float)) RayPacket
+    {
+    public:
+        // RayPacket Public Methods
+        RayPacket()
+        {
+            for (int i = 0; i < N; ++i)
+                Set(i, Ray(Point3f(), Vector3f(0, 0, 1), 0));
+            activeMask = 0;
+        }
+        void Set(int lane, const Ray &r)
+        {
+            ox[lane] = r.o.x;
+            oy[lane] = r.o.y;
+            oz[lane] = r.o.z;
+            dx[lane] = r.d.x;
+            dy[lane] = r.d.y;
+            dz[lane] = r.d.z;
+            tMax[lane] = r.tMax;
+            time[lane] = r.time;
+            activeMask |= 1u << lane;
+        }
+        Ray Get(int lane) const
+        {
+            return Ray(Point3f(ox[lane], oy[lane], oz[lane]), Vector3f(dx[lane], dy[lane], dz[lane]),
+                       tMax[lane], time[lane]);
+        }
+
+        // RayPacket Public Data
+        Float ox[N], oy[N], oz[N];
+        Float dx[N], dy[N], dz[N];
+        mutable Float tMax[N];
+        Float time[N];
+        uint32_t activeMask;
+    };
+
+    template <int N>
+    class alignas(N * sizeof(Float)) HitPacket
+    {
+    public:
+        // HitPacket Public Methods
+        HitPacket() { Clear(); }
+        void Clear()
+        {
+            hitMask = 0;
+            for (int i = 0; i < N; ++i)
+                primitive[i] = nullptr;
+        }
+        void Set(int lane, Float tHit, const SurfaceInteraction &si)
+        {
+            t[lane] = tHit;
+            px[lane] = si.p.x;
+            py[lane] = si.p.y;
+            pz[lane] = si.p.z;
+            nx[lane] = si.n.x;
+            ny[lane] = si.n.y;
+            nz[lane] = si.n.z;
+            snx[lane] = si.shadingN.x;
+            sny[lane] = si.shadingN.y;
+            snz[lane] = si.shadingN.z;
+            u[lane] = si.uv.x;
+            v[lane] = si.uv.y;
+            dpdux[lane] = si.dpdu.x;
+            dpduy[lane] = si.dpdu.y;
+            dpduz[lane] = si.dpdu.z;
+            dpdvx[lane] = si.dpdv.x;
+            dpdvy[lane] = si.dpdv.y;
+            dpdvz[lane] = si.dpdv.z;
+            primitive[lane] = si.primitive;
+            hitMask |= 1u << lane;
+        }
+
+        // HitPacket Public Data
+        Float t[N];
+        Float px[N], py[N], pz[N];
+        Float nx[N], ny[N], nz[N];
+        Float snx[N], sny[N], snz[N]; // shading normal
+        Float u[N], v[N];
+        // for texture footprints
+        Float dpdux[N], dpduy[N], dpduz[N];
+        Float dpdvx[N], dpdvy[N], dpdvz[N];
+        const Primitive *primitive[N];
+        uint32_t hitMask;
+    };
+
+    using RayPacket8 = RayPacket<8>;
+    using RayPacket16 = RayPacket<16>;
+    using HitPacket8 = HitPacket<8>;
+    using HitPacket16 = HitPacket<16>;
+
+    class RayStream
+    {
+    public:
+        // RayStream Public Methods
+        void Resize(size_t n)
+        {
+            for (std::vector<Float> *c : {&ox, &oy, &oz, &dx, &dy, &dz, &tMax, &time})
+                c->resize(n);
+        }
+        size_t Size() const { return ox.size(); }
+        void Set(size_t i, const Ray &r)
+        {
+            ox[i] = r.o.x;
+            oy[i] = r.o.y;
+            oz[i] = r.o.z;
+            dx[i] = r.d.x;
+            dy[i] = r.d.y;
+            dz[i] = r.d.z;
+            tMax[i] = r.tMax;
+            time[i] = r.time;
+        }
+        Ray Get(size_t i) const
+        {
+            return Ray(Point3f(ox[i], oy[i], oz[i]), Vector3f(dx[i], dy[i], dz[i]), tMax[i], time[i]);
+        }
+
+        // RayStream Public Data
+        std::vector<Float> ox, oy, oz;
+        std::vector<Float> dx, dy, dz;
+        std::vector<Float> tMax, time;
+    };
+
+    class HitStream
+    {
+    public:
+        // HitStream Public Methods
+        void Resize(size_t n)
+        {
+            for (std::vector<Float> *c : {&t, &px, &py, &pz, &nx, &ny, &nz, &snx, &sny, &snz, &u, &v, &dpdux,
+                                          &dpduy, &dpduz, &dpdvx, &dpdvy, &dpdvz})
+                c->resize(n);
+            primitive.assign(n, nullptr);
+        }
+        size_t Size() const { return t.size(); }
+        bool Hit(size_t i) const { return primitive[i] != nullptr; }
+
+        // HitStream Public Data
+        std::vector<Float> t;
+        std::vector<Float> px, py, pz;
+        std::vector<Float> nx, ny, nz;
+        std::vector<Float> snx, sny, snz; // shading normal
+        std::vector<Float> u, v;
+        // for texture footprints
+        std::vector<Float> dpdux, dpduy, dpduz;
+        std::vector<Float> dpdvx, dpdvy, dpdvz;
+        std::vector<const Primitive *> primitive;
+    };
+}
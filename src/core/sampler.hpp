@@ -1,12 +1,285 @@
 #pragma once
+/***
+ *  Sampler
+ *  SamplerBuffer
+ *  IndependentSampler
+ *  ZSobolSampler
+ */
+#include <cstddef>
+#include <memory>
+#include <new>
+#include <stdexcept>
+#include <string>
+#include <reina.hpp>
+#include <utils/vecmath.hpp>
+#include <utils/rng.hpp>
+#include <core/lowdiscrepancy.hpp>
 namespace reina
 {
     class Sampler
     {
     public:
+        Sampler(int samplesPerPixel) : samplesPerPixel(samplesPerPixel) {}
         virtual ~Sampler() = default;
-        virtual float Sample() = 0;
-        // clone
-        virtual Sampler *Clone(int seed) const = 0;
+        int SamplesPerPixel() const { return samplesPerPixel; }
+        // selects the sample vector of one pixel sample; the dimensions then follow in order, starting
+        // at dimension (each Get1D() takes one, each Get2D() two), so a path can be resumed mid-way
+        virtual void StartPixelSample(const Point2i &p, int sampleIndex, int dimension = 0) = 0;
+        virtual Float Get1D() = 0;
+        virtual Point2f Get2D() = 0;
+        // offset of the film sample inside its pixel
+        virtual Point2f GetPixel2D() { return Get2D(); }
+        // batched forms, one virtual call for n dimensions: the values n single calls would return
+        virtual void Get1D(Float *u, int n)
+        {
+            for (int i = 0; i < n; ++i)
+                u[i] = Get1D();
+        }
+        virtual void Get2D(Point2f *u, int n)
+        {
+            for (int i = 0; i < n; ++i)
+                u[i] = Get2D();
+        }
+        // film offsets of samples [sampleBegin, sampleBegin + n) of pixel p, each what GetPixel2D()
+        // returns first after StartPixelSample(p, sample); the current pixel sample is lost
+        virtual void GetPixel2D(const Point2i &p, int sampleBegin, int n, Point2f *u)
+        {
+            for (int i = 0; i < n; ++i)
+            {
+                StartPixelSample(p, sampleBegin + i);
+                u[i] = GetPixel2D();
+            }
+        }
+        // constructs a copy with its own seed in storage, which must hold CloneSize() bytes aligned for
+        // any scalar type; the caller destroys it with ~Sampler(). SamplerBuffer does both.
+        virtual Sampler *Clone(void *storage, int seed) const = 0;
+        virtual size_t CloneSize() const = 0;
+        // the seed it was made with; samples are keyed by pixel, so clones for other threads pass it
+        // on to keep drawing from the same image-wide sequence
+        virtual int Seed() const = 0;
+
+    protected:
+        const int samplesPerPixel;
     };
-}
\ No newline at end of file
+
+    // in-place home for a sampler clone, on the stack or in thread-local storage: restarting a
+    // sampler per tile or chunk then allocates nothing. Larger samplers fall back to the heap.
+    class SamplerBuffer
+    {
+    public:
+        static constexpr size_t Capacity = 128;
+
+        SamplerBuffer() = default;
+        SamplerBuffer(const SamplerBuffer &) = delete;
+        SamplerBuffer &operator=(const SamplerBuffer &) = delete;
+        ~SamplerBuffer() { Reset(); }
+        // replaces the sampler held so far
+        Sampler &Clone(const Sampler &prototype, int seed)
+        {
+            Reset();
+            void *storage = inlineStorage;
+            if (prototype.CloneSize() > Capacity)
+            {
+                heapStorage.reset(new std::max_align_t[(prototype.CloneSize() + sizeof(std::max_align_t) - 1) /
+                                                       sizeof(std::max_align_t)]);
+                storage = heapStorage.get();
+            }
+            sampler = prototype.Clone(storage, seed);
+            return *sampler;
+        }
+        void Reset()
+        {
+            if (sampler)
+                sampler->~Sampler();
+            sampler = nullptr;
+        }
+
+    private:
+        alignas(std::max_align_t) unsigned char inlineStorage[Capacity];
+        std::unique_ptr<std::max_align_t[]> heapStorage;
+        Sampler *sampler = nullptr;
+    };
+
+    // uniform random samples, one PCG stream per pixel sample
+    class IndependentSampler : public Sampler
+    {
+    public:
+        IndependentSampler(int samplesPerPixel, int seed = 0) : Sampler(samplesPerPixel), seed(seed) {}
+        void StartPixelSample(const Point2i &p, int sampleIndex, int dimension = 0) override
+        {
+            uint64_t pixel = ((uint64_t)(uint32_t)p.x << 32) | (uint32_t)p.y;
+            rng.SetSequence(MixBits(pixel ^ ((uint64_t)seed << 48)), MixBits((uint64_t)sampleIndex));
+            rng.Advance(dimension);
+        }
+        using Sampler::Get1D;
+        using Sampler::Get2D;
+        using Sampler::GetPixel2D;
+        Float Get1D() override { return rng.UniformFloat(); }
+        Point2f Get2D() override
+        {
+            Float u0 = rng.UniformFloat();
+            return Point2f(u0, rng.UniformFloat());
+        }
+        void Get1D(Float *u, int n) override { rng.UniformFloats(u, n); }
+        void Get2D(Point2f *u, int n) override
+        {
+            // through a small buffer, in runs the wide generator fills
+            Float v[32];
+            for (int i = 0; i < n; i += 16)
+            {
+                int m = std::min(16, n - i);
+                rng.UniformFloats(v, 2 * m);
+                for (int j = 0; j < m; ++j)
+                    u[i + j] = Point2f(v[2 * j], v[2 * j + 1]);
+            }
+        }
+        Sampler *Clone(void *storage, int seed) const override
+        {
+            return new (storage) IndependentSampler(samplesPerPixel, seed);
+        }
+        size_t CloneSize() const override { return sizeof(IndependentSampler); }
+        int Seed() const override { return seed; }
+
+    private:
+        int seed;
+        RNG rng;
+    };
+
+    // Owen-scrambled Sobol' points in Z (Morton) order over the image (Ahmed and Wonka, "Screen-space
+    // blue-noise sampling"): pixel p's samples are consecutive indices of one global sequence, so
+    // neighbouring pixels share its stratification and the error is spread as blue noise. Each
+    // dimension (pair) uses Sobol' dimension 0 (and 1) with its own scramble seed and its own
+    // shuffle of the base-4 index digits, so dimensions stay decorrelated. The samples per pixel
+    // are rounded up to a power of two.
+    class ZSobolSampler : public Sampler
+    {
+    public:
+        enum class Randomize
+        {
+            None,
+            FastOwen,
+            Owen
+        };
+
+        ZSobolSampler(int samplesPerPixel, const Point2i &fullResolution, Randomize randomize = Randomize::FastOwen,
+                      int seed = 0)
+            : Sampler(RoundUpPow2(std::max(1, samplesPerPixel))), fullResolution(fullResolution),
+              randomize(randomize), seed(seed)
+        {
+            log2SamplesPerPixel = Log2Int((uint32_t)this->samplesPerPixel);
+            int res = RoundUpPow2(std::max(1, std::max(fullResolution.x, fullResolution.y)));
+            int log4SamplesPerPixel = (log2SamplesPerPixel + 1) / 2;
+            nBase4Digits = Log2Int((uint32_t)res) + log4SamplesPerPixel;
+        }
+        using Sampler::Get1D;
+        using Sampler::Get2D;
+        using Sampler::GetPixel2D;
+        void StartPixelSample(const Point2i &p, int sampleIndex, int dim = 0) override
+        {
+            dimension = dim;
+            mortonIndex = (EncodeMorton2((uint32_t)p.x, (uint32_t)p.y) << log2SamplesPerPixel) | (uint64_t)sampleIndex;
+        }
+        Float Get1D() override
+        {
+            uint64_t sampleIndex = getSampleIndex();
+            ++dimension;
+            return sample(sampleIndex, 0, (uint32_t)dimensionHash());
+        }
+        Point2f Get2D() override
+        {
+            uint64_t sampleIndex = getSampleIndex();
+            dimension += 2;
+            uint64_t bits = dimensionHash();
+            return Point2f(sample(sampleIndex, 0, (uint32_t)bits), sample(sampleIndex, 1, (uint32_t)(bits >> 32)));
+        }
+        void Get1D(Float *u, int n) override
+        {
+            for (int i = 0; i < n; ++i)
+                u[i] = ZSobolSampler::Get1D();
+        }
+        void Get2D(Point2f *u, int n) override
+        {
+            for (int i = 0; i < n; ++i)
+                u[i] = ZSobolSampler::Get2D();
+        }
+        void GetPixel2D(const Point2i &p, int sampleBegin, int n, Point2f *u) override
+        {
+            for (int i = 0; i < n; ++i)
+            {
+                ZSobolSampler::StartPixelSample(p, sampleBegin + i);
+                u[i] = ZSobolSampler::Get2D();
+            }
+        }
+        Sampler *Clone(void *storage, int seed) const override
+        {
+            return new (storage) ZSobolSampler(samplesPerPixel, fullResolution, randomize, seed);
+        }
+        size_t CloneSize() const override { return sizeof(ZSobolSampler); }
+        int Seed() const override { return seed; }
+
+    private:
+        // ZSobolSampler Private Methods
+        uint64_t dimensionHash() const { return MixBits(((uint64_t)dimension << 32) ^ (uint32_t)seed); }
+        Float sample(uint64_t a, int sobolDimension, uint32_t hash) const
+        {
+            switch (randomize)
+            {
+            case Randomize::None:
+                return SobolSample(a, sobolDimension, NoRandomizer());
+            case Randomize::Owen:
+                return SobolSample(a, sobolDimension, OwenScrambler(hash));
+            default:
+                return SobolSample(a, sobolDimension, FastOwenScrambler(hash));
+            }
+        }
+        // the Morton index with its base-4 digits shuffled, per dimension, by a permutation that
+        // depends on the digits above them: a random but still stratified order of the pixel's samples
+        uint64_t getSampleIndex() const
+        {
+            static const uint8_t permutations[24][4] = {
+                {0, 1, 2, 3}, {0, 1, 3, 2}, {0, 2, 1, 3}, {0, 2, 3, 1}, {0, 3, 2, 1}, {0, 3, 1, 2},
+                {1, 0, 2, 3}, {1, 0, 3, 2}, {1, 2, 0, 3}, {1, 2, 3, 0}, {1, 3, 2, 0}, {1, 3, 0, 2},
+                {2, 1, 0, 3}, {2, 1, 3, 0}, {2, 0, 1, 3}, {2, 0, 3, 1}, {2, 3, 0, 1}, {2, 3, 1, 0},
+                {3, 1, 2, 0}, {3, 1, 0, 2}, {3, 2, 1, 0}, {3, 2, 0, 1}, {3, 0, 2, 1}, {3, 0, 1, 2}};
+            uint64_t sampleIndex = 0;
+            // an odd power of two samples leaves one base-2 digit at the bottom
+            bool pow2Samples = log2SamplesPerPixel & 1;
+            int lastDigit = pow2Samples ? 1 : 0;
+            for (int i = nBase4Digits - 1; i >= lastDigit; --i)
+            {
+                int digitShift = 2 * i - (pow2Samples ? 1 : 0);
+                int digit = (mortonIndex >> digitShift) & 3;
+                uint64_t higherDigits = mortonIndex >> (digitShift + 2);
+                int p = (MixBits(higherDigits ^ (0x55555555u * (uint64_t)dimension)) >> 24) % 24;
+                sampleIndex |= (uint64_t)permutations[p][digit] << digitShift;
+            }
+            if (pow2Samples)
+            {
+                int digit = mortonIndex & 1;
+                sampleIndex |= digit ^ (MixBits((mortonIndex >> 1) ^ (0x55555555u * (uint64_t)dimension)) & 1);
+            }
+            return sampleIndex;
+        }
+
+        // ZSobolSampler Private Data
+        const Point2i fullResolution;
+        const Randomize randomize;
+        const int seed;
+        int log2SamplesPerPixel, nBase4Digits;
+        uint64_t mortonIndex = 0;
+        int dimension = 0;
+    };
+
+    // the pixel sampler named by Config::PixelSampler(): "zsobol" or "independent"; throws
+    // std::invalid_argument otherwise
+    inline std::shared_ptr<Sampler> CreateSampler(const std::string &name, int samplesPerPixel,
+                                                  const Point2i &fullResolution, int seed = 0)
+    {
+        if (name == "zsobol")
+            return std::make_shared<ZSobolSampler>(samplesPerPixel, fullResolution,
+                                                   ZSobolSampler::Randomize::FastOwen, seed);
+        if (name == "independent")
+            return std::make_shared<IndependentSampler>(samplesPerPixel, seed);
+        throw std::invalid_argument("unknown sampler \"" + name + "\"");
+    }
+}
@@ -0,0 +1,98 @@
+#include <core/sampling.hpp>
+#include <utils/parallel.hpp>
+#include <numeric>
+namespace reina
+{
+    // AliasTable Method Definitions
+    AliasTable::AliasTable(const std::vector<Float> &weights) : bins(weights.size())
+    {
+        const int64_t n = (int64_t)bins.size();
+        if (n == 0)
+            return;
+        const int64_t chunkSize = 16384, nChunks = (n + chunkSize - 1) / chunkSize;
+
+        // normalize in parallel; the sums stay in double so that long tables don't drift
+        std::vector<double> chunkSums(nChunks, 0);
+        ParallelFor(nChunks, 1, [&](int64_t begin, int64_t end)
+                    {
+            for (int64_t c = begin; c < end; ++c)
+                for (int64_t i = c * chunkSize; i < std::min(n, (c + 1) * chunkSize); ++i)
+                    chunkSums[c] += std::max<Float>(0, weights[i]); });
+        const double sum = std::accumulate(chunkSums.begin(), chunkSums.end(), 0.0);
+
+        // split into outcomes below and above the average, each chunk on its own
+        struct Outcome
+        {
+            double pHat; // probability times n: 1 fills a bin exactly
+            int index;
+        };
+        std::vector<std::vector<Outcome>> chunkUnder(nChunks), chunkOver(nChunks);
+        ParallelFor(nChunks, 1, [&](int64_t begin, int64_t end)
+                    {
+            for (int64_t c = begin; c < end; ++c)
+                for (int64_t i = c * chunkSize; i < std::min(n, (c + 1) * chunkSize); ++i)
+                {
+                    double p = sum > 0 ? std::max<Float>(0, weights[i]) / sum : 1.0 / n;
+                    bins[i].p = (Float)p;
+                    Outcome outcome{p * n, (int)i};
+                    (outcome.pHat < 1 ? chunkUnder[c] : chunkOver[c]).push_back(outcome);
+                } });
+        std::vector<Outcome> under, over;
+        for (int64_t c = 0; c < nChunks; ++c)
+        {
+            under.insert(under.end(), chunkUnder[c].begin(), chunkUnder[c].end());
+            over.insert(over.end(), chunkOver[c].begin(), chunkOver[c].end());
+        }
+
+        // Vose pairing: each bin below the average is topped up by one above it
+        while (!under.empty() && !over.empty())
+        {
+            Outcome un = under.back(), ov = over.back();
+            under.pop_back();
+            over.pop_back();
+            bins[un.index].q = (Float)un.pHat;
+            bins[un.index].alias = ov.index;
+            Outcome rest{un.pHat + ov.pHat - 1, ov.index};
+            (rest.pHat < 1 ? under : over).push_back(rest);
+        }
+        // what is left is 1 up to rounding
+        for (const std::vector<Outcome> *left : {&under, &over})
+            for (const Outcome &outcome : *left)
+            {
+                bins[outcome.index].q = 1;
+                bins[outcome.index].alias = outcome.index;
+            }
+    }
+
+    // Distribution1D Method Definitions
+    Distribution1D::Distribution1D(const Float *f, int n) : func(f, f + n), cdf(n + 1)
+    {
+        // running integral, in double as rows can be long
+        double sum = 0;
+        cdf[0] = 0;
+        for (int i = 0; i < n; ++i)
+        {
+            func[i] = std::max<Float>(0, func[i]);
+            sum += (double)func[i] / n;
+            cdf[i + 1] = (Float)sum;
+        }
+        funcInt = (Float)sum;
+        for (int i = 1; i <= n; ++i)
+            // all zero: sample uniformly
+            cdf[i] = funcInt > 0 ? cdf[i] / funcInt : (Float)i / n;
+        cdf[n] = 1;
+    }
+
+    // Distribution2D Method Definitions
+    Distribution2D::Distribution2D(const Float *f, int nu, int nv) : pConditionalV(nv)
+    {
+        ParallelFor(nv, 16, [&](int64_t begin, int64_t end)
+                    {
+            for (int64_t v = begin; v < end; ++v)
+                pConditionalV[v] = std::make_unique<Distribution1D>(&f[v * nu], nu); });
+        std::vector<Float> marginalFunc(nv);
+        for (int v = 0; v < nv; ++v)
+            marginalFunc[v] = pConditionalV[v]->funcInt;
+        pMarginal = std::make_unique<Distribution1D>(marginalFunc.data(), nv);
+    }
+}
@@ -0,0 +1,175 @@
+#pragma once
+/***
+ *  Sampling routines
+ *  AliasTable
+ *  Distribution1D
+ *  Distribution2D
+ */
+#include <memory>
+#include <vector>
+#include <reina.hpp>
+#include <utils/math.hpp>
+#include <utils/vecmath.hpp>
+namespace reina
+{
+    // area-preserving map of [0,1)^2 onto the unit disk (Shirley-Chiu)
+    inline Point2f ConcentricSampleDisk(const Point2f &u)
+    {
+        Point2f uOffset = u * (Float)2 - Vector2f(1, 1);
+        if (uOffset.x == 0 && uOffset.y == 0)
+            return Point2f(0, 0);
+        Float theta, r;
+        if (std::abs(uOffset.x) > std::abs(uOffset.y))
+        {
+            r = uOffset.x;
+            theta = (Pi / 4) * (uOffset.y / uOffset.x);
+        }
+        else
+        {
+            r = uOffset.y;
+            theta = (Pi / 2) - (Pi / 4) * (uOffset.x / uOffset.y);
+        }
+        return Point2f(r * std::cos(theta), r * std::sin(theta));
+    }
+
+    // cosine-weighted direction around +z
+    inline Vector3f CosineSampleHemisphere(const Point2f &u)
+    {
+        Point2f d = ConcentricSampleDisk(u);
+        Float z = std::sqrt(std::max((Float)0, 1 - d.x * d.x - d.y * d.y));
+        return Vector3f(d.x, d.y, z);
+    }
+
+    inline Float CosineHemispherePdf(Float cosTheta) { return cosTheta * InvPi; }
+
+    // uniform barycentrics (b0, b1) over a triangle
+    inline Point2f UniformSampleTriangle(const Point2f &u)
+    {
+        Float su0 = std::sqrt(u.x);
+        return Point2f(1 - su0, u.y * su0);
+    }
+
+    // Walker/Vose alias table: draws from a discrete distribution in O(1), with one table lookup and
+    // one comparison, where a CDF needs a binary search
+    class AliasTable
+    {
+    public:
+        // AliasTable Public Methods
+        AliasTable() = default;
+        // weights need not be normalized, negative ones count as zero; all zero gives a uniform table.
+        // Large tables are normalized in parallel.
+        explicit AliasTable(const std::vector<Float> &weights);
+        // index i with probability PMF(i); *uRemapped is a fresh uniform sample for the caller to reuse
+        int Sample(Float u, Float *pmf = nullptr, Float *uRemapped = nullptr) const
+        {
+            int n = (int)bins.size();
+            int offset = std::min((int)(u * n), n - 1);
+            Float up = std::min<Float>(u * n - offset, OneMinusEpsilon);
+            const Bin &bin = bins[offset];
+            int index = up < bin.q ? offset : bin.alias;
+            if (pmf)
+                *pmf = bins[index].p;
+            if (uRemapped)
+                *uRemapped = index == offset ? std::min<Float>(up / bin.q, OneMinusEpsilon)
+                                             : std::min<Float>((up - bin.q) / (1 - bin.q), OneMinusEpsilon);
+            return index;
+        }
+        Float PMF(int index) const { return bins[index].p; }
+        size_t size() const { return bins.size(); }
+        bool empty() const { return bins.empty(); }
+
+    private:
+        // AliasTable Private Data
+        struct Bin
+        {
+            // bin i yields i with probability q, its alias otherwise
+            Float q = 1;
+            Float p = 0;
+            int alias = 0;
+        };
+        std::vector<Bin> bins;
+    };
+
+    // piecewise-constant function over [0, 1] sampled by inverting its CDF, O(log n). Unlike
+    // AliasTable the mapping from u is monotonic, so stratified samples stay stratified.
+    class Distribution1D
+    {
+    public:
+        // Distribution1D Public Methods
+        Distribution1D(const Float *f, int n);
+        int Count() const { return (int)func.size(); }
+        // a point in [0, 1) with density *pdf; *offset is the piece it falls in
+        Float SampleContinuous(Float u, Float *pdf, int *offset = nullptr) const
+        {
+            int o = findInterval(u);
+            if (offset)
+                *offset = o;
+            Float du = u - cdf[o];
+            if (cdf[o + 1] - cdf[o] > 0)
+                du /= cdf[o + 1] - cdf[o];
+            if (pdf)
+                *pdf = funcInt > 0 ? func[o] / funcInt : 0;
+            return (o + du) / Count();
+        }
+        // density at x in [0, 1]
+        Float Pdf(Float x) const
+        {
+            int o = Clamp((int)(x * Count()), 0, Count() - 1);
+            return funcInt > 0 ? func[o] / funcInt : 0;
+        }
+
+        // Distribution1D Public Data
+        std::vector<Float> func, cdf;
+        Float funcInt;
+
+    private:
+        // last o with cdf[o] <= u
+        int findInterval(Float u) const
+        {
+            int first = 0, len = (int)cdf.size();
+            while (len > 0)
+            {
+                int half = len >> 1, middle = first + half;
+                if (cdf[middle] <= u)
+                {
+                    first = middle + 1;
+                    len -= half + 1;
+                }
+                else
+                    len = half;
+            }
+            return Clamp(first - 1, 0, (int)cdf.size() - 2);
+        }
+    };
+
+    // piecewise-constant function over [0, 1]^2, given nu * nv values with u varying fastest: v is
+    // drawn from the marginal, then u from that row's conditional
+    class Distribution2D
+    {
+    public:
+        // Distribution2D Public Methods
+        // rows are built in parallel
+        Distribution2D(const Float *f, int nu, int nv);
+        Point2f SampleContinuous(const Point2f &u, Float *pdf) const
+        {
+            Float pdfs[2];
+            int v;
+            Float d1 = pMarginal->SampleContinuous(u[1], &pdfs[1], &v);
+            Float d0 = pConditionalV[v]->SampleContinuous(u[0], &pdfs[0]);
+            *pdf = pdfs[0] * pdfs[1];
+            return Point2f(d0, d1);
+        }
+        Float Pdf(const Point2f &p) const
+        {
+            const Distribution1D &row = *pConditionalV[Clamp((int)(p[1] * pMarginal->Count()), 0,
+                                                             pMarginal->Count() - 1)];
+            int iu = Clamp((int)(p[0] * row.Count()), 0, row.Count() - 1);
+            return pMarginal->funcInt > 0 ? row.func[iu] / pMarginal->funcInt : 0;
+        }
+
+    private:
+        // Distribution2D Private Data
+        std::vector<std::unique_ptr<Distribution1D>> pConditionalV;
+        std::unique_ptr<Distribution1D> pMarginal;
+    };
+}
@@ -0,0 +1,59 @@
+#include <core/scene.hpp>
+#include <core/bvh.hpp>
+#include <utils/parallel.hpp>
+namespace reina
+{
+    // Scene Method Definitions
+    Scene::Scene(std::shared_ptr<Primitive> aggregate, std::vector<std::shared_ptr<Light>> lights,
+                 LightSampling lightSampling)
+        : lights(std::move(lights)), aggregate(std::move(aggregate))
+    {
+        worldBound = this->aggregate->WorldBound();
+        for (const auto &light : this->lights)
+        {
+            light->Preprocess(worldBound);
+            if (light->flags & (int)LightFlags::Infinite)
+                infiniteLights.push_back(light);
+        }
+        // after Preprocess(), which may be what gives a light its bounds and power
+        lightSampler = CreateLightSampler(lightSampling, this->lights);
+    }
+
+    void Scene::IntersectStream(const RayStream &rays, HitStream *hits) const
+    {
+        if (const auto *bvh = dynamic_cast<const BVHAccel *>(aggregate.get()))
+        {
+            bvh->IntersectStream(rays, hits);
+            return;
+        }
+        hits->Resize(rays.Size());
+        ParallelFor(rays.Size(), 1024, [&](int64_t begin, int64_t end)
+                    {
+            for (int64_t i = begin; i < end; ++i)
+            {
+                Ray ray = rays.Get(i);
+                SurfaceInteraction si;
+                if (!aggregate->Intersect(ray, &si))
+                    continue;
+                hits->t[i] = ray.tMax;
+                hits->px[i] = si.p.x;
+                hits->py[i] = si.p.y;
+                hits->pz[i] = si.p.z;
+                hits->nx[i] = si.n.x;
+                hits->ny[i] = si.n.y;
+                hits->nz[i] = si.n.z;
+                hits->snx[i] = si.shadingN.x;
+                hits->sny[i] = si.shadingN.y;
+                hits->snz[i] = si.shadingN.z;
+                hits->u[i] = si.uv.x;
+                hits->v[i] = si.uv.y;
+                hits->dpdux[i] = si.dpdu.x;
+                hits->dpduy[i] = si.dpdu.y;
+                hits->dpduz[i] = si.dpdu.z;
+                hits->dpdvx[i] = si.dpdv.x;
+                hits->dpdvy[i] = si.dpdv.y;
+                hits->dpdvz[i] = si.dpdv.z;
+                hits->primitive[i] = si.primitive;
+            } });
+    }
+}
@@ -1,11 +1,40 @@
 #pragma once
+/***
+ *  Scene
+ */
+#include <memory>
+#include <vector>
+#include <reina.hpp>
+#include <core/primitive.hpp>
+#include <core/raypacket.hpp>
+#include <core/light.hpp>
+#include <core/lightsampler.hpp>
 
 namespace reina
 {
     class Scene
     {
     public:
-        Scene() = default;
-        ~Scene() = default;
+        // Scene Public Methods
+        Scene(std::shared_ptr<Primitive> aggregate, std::vector<std::shared_ptr<Light>> lights = {},
+              LightSampling lightSampling = LightSampling::BVH);
+        const Bounds3f &WorldBound() const { return worldBound; }
+        bool Intersect(const Ray &ray, SurfaceInteraction *isect) const { return aggregate->Intersect(ray, isect); }
+        bool IntersectP(const Ray &ray) const { return aggregate->IntersectP(ray); }
+        // batched closest hits; sorted packet traversal when the aggregate is a BVHAccel
+        void IntersectStream(const RayStream &rays, HitStream *hits) const;
+        // chooses the light for next event estimation
+        const LightSampler &GetLightSampler() const { return *lightSampler; }
+
+        // Scene Public Data
+        std::vector<std::shared_ptr<Light>> lights;
+        // the lights with an Le() for escaping rays
+        std::vector<std::shared_ptr<Light>> infiniteLights;
+
+    private:
+        // Scene Private Data
+        std::shared_ptr<Primitive> aggregate;
+        Bounds3f worldBound;
+        std::unique_ptr<LightSampler> lightSampler;
     };
-}
\ No newline at end of file
+}
@@ -0,0 +1,465 @@
+#include <core/shapes.hpp>
+#include <core/sampling.hpp>
+#include <algorithm>
+#include <cassert>
+#include <cmath>
+namespace reina
+{
+    // TriangleMesh Method Definitions
+    TriangleMesh::TriangleMesh(std::vector<int> indices, const std::vector<Point3f> &P,
+                               const std::vector<Normal3f> &N, const std::vector<Point2f> &UV)
+        : nTriangles((int)indices.size() / 3), nVertices((int)P.size()),
+          vertexIndices(std::move(indices))
+    {
+        assert(vertexIndices.size() % 3 == 0);
+        px.resize(nVertices);
+        py.resize(nVertices);
+        pz.resize(nVertices);
+        for (int i = 0; i < nVertices; ++i)
+        {
+            px[i] = P[i].x;
+            py[i] = P[i].y;
+            pz[i] = P[i].z;
+        }
+        if (!N.empty())
+        {
+            assert((int)N.size() == nVertices);
+            nx.resize(nVertices);
+            ny.resize(nVertices);
+            nz.resize(nVertices);
+            for (int i = 0; i < nVertices; ++i)
+            {
+                nx[i] = N[i].x;
+                ny[i] = N[i].y;
+                nz[i] = N[i].z;
+            }
+        }
+        if (!UV.empty())
+        {
+            assert((int)UV.size() == nVertices);
+            u.resize(nVertices);
+            v.resize(nVertices);
+            for (int i = 0; i < nVertices; ++i)
+            {
+                u[i] = UV[i].x;
+                v[i] = UV[i].y;
+            }
+        }
+    }
+
+    TriangleMesh::TriangleMesh(int nTriangles, int nVertices) : nTriangles(nTriangles), nVertices(nVertices)
+    {
+    }
+
+    void TriangleMesh::UpdatePositions(const std::vector<Point3f> &P)
+    {
+        assert((int)P.size() == nVertices);
+        if (IsCompressed())
+        {
+            quantizeKey(0, P);
+            if (HasPrecomputedEdges())
+                PrecomputeEdges();
+            return;
+        }
+        for (int i = 0; i < nVertices; ++i)
+        {
+            px[i] = P[i].x;
+            py[i] = P[i].y;
+            pz[i] = P[i].z;
+        }
+        if (HasPrecomputedEdges())
+            PrecomputeEdges();
+    }
+
+    void TriangleMesh::SetEndPositions(const std::vector<Point3f> &P1)
+    {
+        assert((int)P1.size() == nVertices);
+        if (IsCompressed())
+        {
+            quantizeKey(1, P1);
+            return;
+        }
+        px1.resize(nVertices);
+        py1.resize(nVertices);
+        pz1.resize(nVertices);
+        for (int i = 0; i < nVertices; ++i)
+        {
+            px1[i] = P1[i].x;
+            py1[i] = P1[i].y;
+            pz1[i] = P1[i].z;
+        }
+    }
+
+    void TriangleMesh::PrecomputeEdges()
+    {
+        edges.resize(nTriangles);
+        for (int i = 0; i < nTriangles; ++i)
+        {
+            const int *vi = &vertexIndices[3 * i];
+            Point3f p0 = P(vi[0]);
+            edges[i].p0 = p0;
+            edges[i].e1 = P(vi[1]) - p0;
+            edges[i].e2 = P(vi[2]) - p0;
+        }
+    }
+
+    namespace
+    {
+        // extent / 65535 rounded up to 8 significant bits: a 16-bit q times the step is then exact,
+        // so a vertex decodes to the same Float whether or not the compiler fuses the multiply-add,
+        // in the intersector as in the bounds
+        Float QuantizationStep(Float extent)
+        {
+            if (!(extent > 0))
+                return 0;
+            int exponent;
+            Float mantissa = std::frexp(extent / 65535, &exponent);
+            return std::ldexp(std::ceil(mantissa * 256) / 256, exponent);
+        }
+
+        uint16_t Quantize(Float x, Float origin, Float step)
+        {
+            if (step == 0)
+                return 0;
+            return (uint16_t)std::min<Float>(65535, std::round((x - origin) / step));
+        }
+
+        Bounds3f BoundsOf(const std::vector<Point3f> &P)
+        {
+            Bounds3f bounds;
+            for (const Point3f &p : P)
+                bounds = Union(bounds, p);
+            return bounds;
+        }
+
+        bool IsEmpty(const Bounds3f &b) { return b.pMin.x > b.pMax.x; }
+    }
+
+    TriangleMesh::QuantizedPoint TriangleMesh::quantize(const Point3f &p) const
+    {
+        return QuantizedPoint{Quantize(p.x, quantOrigin.x, quantStep.x), Quantize(p.y, quantOrigin.y, quantStep.y),
+                              Quantize(p.z, quantOrigin.z, quantStep.z)};
+    }
+
+    void TriangleMesh::setQuantizationGrid(const Bounds3f &bounds)
+    {
+        quantOrigin = bounds.pMin;
+        for (int axis = 0; axis < 3; ++axis)
+            quantStep[axis] = QuantizationStep(bounds.pMax[axis] - bounds.pMin[axis]);
+    }
+
+    void TriangleMesh::quantizeKey(int key, const std::vector<Point3f> &P)
+    {
+        Buffer<QuantizedPoint> &q = key == 0 ? pq : pq1, &other = key == 0 ? pq1 : pq;
+        Bounds3f &otherBounds = keyBounds[1 - key];
+        if (!other.empty() && IsEmpty(otherBounds))
+            for (const QuantizedPoint &p : other)
+                otherBounds = Union(otherBounds, decode(p));
+        Bounds3f newBounds = BoundsOf(P);
+        Bounds3f grid = other.empty() ? newBounds : Union(newBounds, otherBounds);
+        if (grid != Union(keyBounds[0], keyBounds[1]))
+        {
+            // a new grid: the other key is off by at most half a step of the first grid plus half
+            // a step of this one, however many times it moves
+            std::vector<Point3f> &otherP = decodedKey[1 - key];
+            if (otherP.empty())
+                for (const QuantizedPoint &p : other)
+                    otherP.push_back(decode(p));
+            setQuantizationGrid(grid);
+            other.resize(otherP.size());
+            for (size_t i = 0; i < otherP.size(); ++i)
+                other[i] = quantize(otherP[i]);
+        }
+        keyBounds[key] = newBounds;
+        decodedKey[key] = std::vector<Point3f>();
+        q.resize(nVertices);
+        for (int i = 0; i < nVertices; ++i)
+            q[i] = quantize(P[i]);
+    }
+
+    void TriangleMesh::Compress()
+    {
+        if (IsCompressed() || nVertices == 0)
+            return;
+        std::vector<Point3f> P(nVertices), P1;
+        for (int i = 0; i < nVertices; ++i)
+            P[i] = this->P(i);
+        if (HasMotion())
+            for (int i = 0; i < nVertices; ++i)
+                P1.push_back(this->P(i, 1));
+        if (HasNormals())
+        {
+            nq.resize(nVertices);
+            for (int i = 0; i < nVertices; ++i)
+                nq[i] = EncodeOctahedral(Vector3f(N(i)));
+        }
+        if (HasUVs())
+        {
+            uvq.resize(nVertices);
+            for (int i = 0; i < nVertices; ++i)
+                uvq[i] = HalfUV{FloatToHalf(u[i]), FloatToHalf(v[i])};
+        }
+        // one grid for both keys, so that a vertex at rest decodes the same at either end
+        keyBounds[0] = BoundsOf(P);
+        keyBounds[1] = BoundsOf(P1);
+        decodedKey[0] = decodedKey[1] = std::vector<Point3f>();
+        setQuantizationGrid(Union(keyBounds[0], keyBounds[1]));
+        pq.resize(nVertices);
+        for (int i = 0; i < nVertices; ++i)
+            pq[i] = quantize(P[i]);
+        pq1.resize(P1.size());
+        for (size_t i = 0; i < P1.size(); ++i)
+            pq1[i] = quantize(P1[i]);
+        // assigned rather than cleared, which would keep the capacity
+        px = py = pz = Buffer<Float>();
+        px1 = py1 = pz1 = Buffer<Float>();
+        nx = ny = nz = Buffer<Float>();
+        u = v = Buffer<Float>();
+        if (HasPrecomputedEdges())
+            PrecomputeEdges();
+    }
+
+    std::shared_ptr<TriangleMesh> CreateTriangleMesh(std::vector<int> vertexIndices, const std::vector<Point3f> &P,
+                                                     const std::vector<Normal3f> &N, const std::vector<Point2f> &UV,
+                                                     bool precomputeEdges, bool compress)
+    {
+        auto mesh = std::make_shared<TriangleMesh>(std::move(vertexIndices), P, N, UV);
+        if (compress)
+            mesh->Compress();
+        if (precomputeEdges)
+            mesh->PrecomputeEdges();
+        return mesh;
+    }
+
+    std::vector<std::shared_ptr<Shape>> CreateTriangleShapes(const std::shared_ptr<TriangleMesh> &mesh)
+    {
+        struct TriangleBlock
+        {
+            std::shared_ptr<TriangleMesh> mesh;
+            std::vector<Triangle> triangles;
+        };
+        auto block = std::make_shared<TriangleBlock>();
+        block->mesh = mesh;
+        block->triangles.reserve(mesh->nTriangles);
+        for (int i = 0; i < mesh->nTriangles; ++i)
+            block->triangles.emplace_back(mesh.get(), i);
+        std::vector<std::shared_ptr<Shape>> tris;
+        tris.reserve(mesh->nTriangles);
+        // aliasing constructor: every triangle shares the block's control block
+        for (Triangle &tri : block->triangles)
+            tris.push_back(std::shared_ptr<Shape>(block, &tri));
+        return tris;
+    }
+
+    // Triangle Method Definitions
+    Bounds3f Triangle::ObjectBound() const
+    {
+        if (mesh->HasMotion())
+            return Union(WorldBoundAt(0), WorldBoundAt(1));
+        return WorldBoundAt(0);
+    }
+
+    Bounds3f Triangle::WorldBoundAt(Float time) const
+    {
+        const int *v = &mesh->vertexIndices[3 * triNumber];
+        return Union(Bounds3f(mesh->P(v[0], time), mesh->P(v[1], time)), mesh->P(v[2], time));
+    }
+
+    Float Triangle::Area() const
+    {
+        const int *v = &mesh->vertexIndices[3 * triNumber];
+        Point3f p0 = mesh->P(v[0]), p1 = mesh->P(v[1]), p2 = mesh->P(v[2]);
+        return 0.5f * (p1 - p0).Cross(p2 - p0).Length();
+    }
+
+    Interaction Triangle::Sample(const Point2f &u, Float *pdf) const
+    {
+        const int *v = &mesh->vertexIndices[3 * triNumber];
+        Point3f p0 = mesh->P(v[0]), p1 = mesh->P(v[1]), p2 = mesh->P(v[2]);
+        Point2f b = UniformSampleTriangle(u);
+        Interaction it;
+        it.p = p0 * b.x + p1 * b.y + p2 * (1 - b.x - b.y);
+        it.n = Normalize(Normal3f((p0 - p2).Cross(p1 - p2)));
+        if (mesh->HasNormals())
+        {
+            Normal3f ns = mesh->N(v[0]) * b.x + mesh->N(v[1]) * b.y + mesh->N(v[2]) * (1 - b.x - b.y);
+            it.n = Faceforward(it.n, Vector3f(ns));
+        }
+        *pdf = 1 / Area();
+        return it;
+    }
+
+    DirectionCone Triangle::NormalBounds() const
+    {
+        const int *v = &mesh->vertexIndices[3 * triNumber];
+        Point3f p0 = mesh->P(v[0]), p1 = mesh->P(v[1]), p2 = mesh->P(v[2]);
+        Normal3f n = Normalize(Normal3f((p0 - p2).Cross(p1 - p2)));
+        // oriented as in Sample(), by the normal interpolated at the centroid
+        if (mesh->HasNormals())
+            n = Faceforward(n, Vector3f(mesh->N(v[0]) + mesh->N(v[1]) + mesh->N(v[2])));
+        return DirectionCone(Vector3f(n));
+    }
+
+    bool Triangle::intersectWatertight(const Ray &ray, Float *tHit, Float *b0, Float *b1, Float *b2) const
+    {
+        const int *v = &mesh->vertexIndices[3 * triNumber];
+        const Point3f p0 = mesh->P(v[0], ray.time), p1 = mesh->P(v[1], ray.time), p2 = mesh->P(v[2], ray.time);
+
+        // move to ray space: origin at the ray origin, the ray along +z
+        Point3f p0t = p0 - Vector3f(ray.o);
+        Point3f p1t = p1 - Vector3f(ray.o);
+        Point3f p2t = p2 - Vector3f(ray.o);
+        int kz = MaxDimension(Abs(ray.d));
+        int kx = kz + 1;
+        if (kx == 3)
+            kx = 0;
+        int ky = kx + 1;
+        if (ky == 3)
+            ky = 0;
+        Vector3f d = Permute(ray.d, kx, ky, kz);
+        p0t = Permute(p0t, kx, ky, kz);
+        p1t = Permute(p1t, kx, ky, kz);
+        p2t = Permute(p2t, kx, ky, kz);
+        Float Sx = -d.x / d.z;
+        Float Sy = -d.y / d.z;
+        Float Sz = 1.f / d.z;
+        p0t.x += Sx * p0t.z;
+        p0t.y += Sy * p0t.z;
+        p1t.x += Sx * p1t.z;
+        p1t.y += Sy * p1t.z;
+        p2t.x += Sx * p2t.z;
+        p2t.y += Sy * p2t.z;
+
+        // edge functions in double: float products are exact there, so a shared edge gets exactly
+        // opposite values in both neighbours even if the compiler contracts into FMAs
+        Float e0 = (Float)((double)p1t.x * (double)p2t.y - (double)p1t.y * (double)p2t.x);
+        Float e1 = (Float)((double)p2t.x * (double)p0t.y - (double)p2t.y * (double)p0t.x);
+        Float e2 = (Float)((double)p0t.x * (double)p1t.y - (double)p0t.y * (double)p1t.x);
+        if ((e0 < 0 || e1 < 0 || e2 < 0) && (e0 > 0 || e1 > 0 || e2 > 0))
+            return false;
+        Float det = e0 + e1 + e2;
+        if (det == 0)
+            return false;
+
+        p0t.z *= Sz;
+        p1t.z *= Sz;
+        p2t.z *= Sz;
+        Float tScaled = e0 * p0t.z + e1 * p1t.z + e2 * p2t.z;
+        if (det < 0 && (tScaled >= 0 || tScaled < ray.tMax * det))
+            return false;
+        else if (det > 0 && (tScaled <= 0 || tScaled > ray.tMax * det))
+            return false;
+        Float invDet = 1 / det;
+        Float t = tScaled * invDet;
+
+        // reject hits that are not provably in front of the origin
+        Float maxZt = MaxComponent(Abs(Vector3f(p0t.z, p1t.z, p2t.z)));
+        Float deltaZ = gamma(3) * maxZt;
+        Float maxXt = MaxComponent(Abs(Vector3f(p0t.x, p1t.x, p2t.x)));
+        Float maxYt = MaxComponent(Abs(Vector3f(p0t.y, p1t.y, p2t.y)));
+        Float deltaX = gamma(5) * (maxXt + maxZt);
+        Float deltaY = gamma(5) * (maxYt + maxZt);
+        Float deltaE = 2 * (gamma(2) * maxXt * maxYt + deltaY * maxXt + deltaX * maxYt);
+        Float maxE = MaxComponent(Abs(Vector3f(e0, e1, e2)));
+        Float deltaT = 3 * (gamma(3) * maxE * maxZt + deltaE * maxZt + deltaZ * maxE) * std::abs(invDet);
+        if (t <= deltaT)
+            return false;
+
+        *b0 = e0 * invDet;
+        *b1 = e1 * invDet;
+        *b2 = e2 * invDet;
+        *tHit = t;
+        return true;
+    }
+
+    bool Triangle::intersectPrecomputed(const Ray &ray, Float *tHit, Float *b0, Float *b1, Float *b2) const
+    {
+        // Moller-Trumbore on the stored edges; not watertight along shared edges
+        const TriangleMesh::TriangleEdges &e = mesh->edges[triNumber];
+        Vector3f pvec = ray.d.Cross(e.e2);
+        Float det = e.e1.Dot(pvec);
+        if (det == 0)
+            return false;
+        Float invDet = 1 / det;
+        Vector3f tvec = ray.o - e.p0;
+        Float u = tvec.Dot(pvec) * invDet;
+        if (u < 0 || u > 1)
+            return false;
+        Vector3f qvec = tvec.Cross(e.e1);
+        Float v = ray.d.Dot(qvec) * invDet;
+        if (v < 0 || u + v > 1)
+            return false;
+        Float t = e.e2.Dot(qvec) * invDet;
+        if (t <= 0 || t >= ray.tMax)
+            return false;
+        *b0 = 1 - u - v;
+        *b1 = u;
+        *b2 = v;
+        *tHit = t;
+        return true;
+    }
+
+    void Triangle::fillInteraction(const Ray &ray, Float b0, Float b1, Float b2, SurfaceInteraction *isect) const
+    {
+        const int *v = &mesh->vertexIndices[3 * triNumber];
+        const Point3f p0 = mesh->P(v[0], ray.time), p1 = mesh->P(v[1], ray.time), p2 = mesh->P(v[2], ray.time);
+        Point2f uv[3];
+        if (mesh->HasUVs())
+        {
+            uv[0] = mesh->UV(v[0]);
+            uv[1] = mesh->UV(v[1]);
+            uv[2] = mesh->UV(v[2]);
+        }
+        else
+        {
+            uv[0] = Point2f(0, 0);
+            uv[1] = Point2f(1, 0);
+            uv[2] = Point2f(1, 1);
+        }
+        Point3f pHit = p0 * b0 + p1 * b1 + p2 * b2;
+        Point2f uvHit = uv[0] * b0 + uv[1] * b1 + uv[2] * b2;
+        Normal3f n = Normalize(Normal3f((p0 - p2).Cross(p1 - p2)));
+        *isect = SurfaceInteraction(pHit, uvHit, -ray.d, n, ray.time);
+        // dp/du and dp/dv from the edges in both spaces; any frame of the plane if the uvs are degenerate
+        Vector2f duv02 = uv[0] - uv[2], duv12 = uv[1] - uv[2];
+        Vector3f dp02 = p0 - p2, dp12 = p1 - p2;
+        Float determinant = duv02.x * duv12.y - duv02.y * duv12.x;
+        if (std::abs(determinant) >= 1e-8f)
+        {
+            Float invDet = 1 / determinant;
+            isect->dpdu = (dp02 * duv12.y - dp12 * duv02.y) * invDet;
+            isect->dpdv = (dp12 * duv02.x - dp02 * duv12.x) * invDet;
+        }
+        if (isect->dpdu.Cross(isect->dpdv).LengthSquared() == 0)
+            CoordinateSystem(Vector3f(n), &isect->dpdu, &isect->dpdv);
+        if (mesh->HasNormals())
+        {
+            Normal3f ns = mesh->N(v[0]) * b0 + mesh->N(v[1]) * b1 + mesh->N(v[2]) * b2;
+            if (ns.LengthSquared() > 0)
+            {
+                isect->shadingN = Normalize(ns);
+                // the geometric normal follows the side of the interpolated one
+                isect->n = Faceforward(n, Vector3f(isect->shadingN));
+            }
+        }
+    }
+
+    bool Triangle::Intersect(const Ray &ray, Float *tHit, SurfaceInteraction *isect) const
+    {
+        Float b0, b1, b2;
+        bool hit = (mesh->HasPrecomputedEdges() && !mesh->HasMotion()) ? intersectPrecomputed(ray, tHit, &b0, &b1, &b2)
+                                               : intersectWatertight(ray, tHit, &b0, &b1, &b2);
+        if (!hit)
+            return false;
+        if (isect)
+            fillInteraction(ray, b0, b1, b2, isect);
+        return true;
+    }
+
+    bool Triangle::IntersectP(const Ray &ray) const
+    {
+        Float tHit, b0, b1, b2;
+        return (mesh->HasPrecomputedEdges() && !mesh->HasMotion()) ? intersectPrecomputed(ray, &tHit, &b0, &b1, &b2)
+                                           : intersectWatertight(ray, &tHit, &b0, &b1, &b2);
+    }
+}
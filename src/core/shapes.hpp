@@ -0,0 +1,178 @@
+#pragma once
+/***
+ *  Shape
+ *  TriangleMesh
+ *  Triangle
+ */
+#include <memory>
+#include <vector>
+#include <reina.hpp>
+#include <utils/vecmath.hpp>
+#include <utils/float.hpp>
+#include <utils/buffer.hpp>
+#include <core/ray.hpp>
+#include <core/interaction.hpp>
+namespace reina
+{
+    class Shape
+    {
+    public:
+        virtual ~Shape() = default;
+        virtual Bounds3f ObjectBound() const = 0;
+        virtual Bounds3f WorldBound() const { return ObjectBound(); }
+        // bounds at a shutter time in [0, 1]; WorldBound() covers the whole shutter
+        virtual Bounds3f WorldBoundAt(Float time) const { return WorldBound(); }
+        virtual bool Intersect(const Ray &ray, Float *tHit, SurfaceInteraction *isect) const = 0;
+        virtual bool IntersectP(const Ray &ray) const
+        {
+            Float tHit = ray.tMax;
+            SurfaceInteraction isect;
+            return Intersect(ray, &tHit, &isect);
+        }
+        virtual Float Area() const = 0;
+        // uniform point on the surface; *pdf is per unit area
+        virtual Interaction Sample(const Point2f &u, Float *pdf) const = 0;
+        // directions of the surface normals Sample() returns
+        virtual DirectionCone NormalBounds() const { return DirectionCone::EntireSphere(); }
+    };
+
+    // vertex data is stored once per mesh, one array per component
+    class TriangleMesh
+    {
+    public:
+        // TriangleMesh Public Methods
+        TriangleMesh(std::vector<int> vertexIndices, const std::vector<Point3f> &P,
+                     const std::vector<Normal3f> &N = {}, const std::vector<Point2f> &UV = {});
+        // empty buffers for the caller to fill in, e.g. with views into a mapped BVH cache
+        TriangleMesh(int nTriangles, int nVertices);
+        Point3f P(int i) const
+        {
+            if (IsCompressed())
+                return decode(pq[i]);
+            return Point3f(px[i], py[i], pz[i]);
+        }
+        // position at a shutter time in [0, 1], linear between the two keys
+        Point3f P(int i, Float time) const
+        {
+            if (!HasMotion())
+                return P(i);
+            Point3f p0 = P(i), p1 = IsCompressed() ? decode(pq1[i]) : Point3f(px1[i], py1[i], pz1[i]);
+            return Point3f(reina::Lerp(time, p0.x, p1.x), reina::Lerp(time, p0.y, p1.y),
+                           reina::Lerp(time, p0.z, p1.z));
+        }
+        Normal3f N(int i) const
+        {
+            if (IsCompressed())
+                return Normal3f(DecodeOctahedral(nq[i]));
+            return Normal3f(nx[i], ny[i], nz[i]);
+        }
+        Point2f UV(int i) const
+        {
+            if (IsCompressed())
+                return Point2f(HalfToFloat(uvq[i].u), HalfToFloat(uvq[i].v));
+            return Point2f(u[i], v[i]);
+        }
+        bool HasNormals() const { return !nx.empty() || !nq.empty(); }
+        bool HasUVs() const { return !u.empty() || !uvq.empty(); }
+        bool HasPrecomputedEdges() const { return !edges.empty(); }
+        bool HasMotion() const { return !px1.empty() || !pq1.empty(); }
+        bool IsCompressed() const { return !pq.empty(); }
+        // deforms the mesh in place; follow with a BVH Refit()
+        void UpdatePositions(const std::vector<Point3f> &P);
+        // positions at shutter close, turns on vertex motion blur
+        void SetEndPositions(const std::vector<Point3f> &P1);
+        // stores p0/e1/e2 per triangle: +36 bytes a triangle, no index gathers and fewer FLOPs per test
+        void PrecomputeEdges();
+        // replaces the Float vertex buffers with positions quantized to 16 bits over the mesh bounds,
+        // 32-bit octahedral normals and half precision UVs: 14 instead of 32 bytes a vertex. The
+        // accessors decode, so intersection and shading see the quantized mesh, which stays
+        // watertight; positions move by up to half a grid step, about 1/131000 of the extent
+        void Compress();
+
+        struct TriangleEdges
+        {
+            Point3f p0;
+            Vector3f e1, e2;
+        };
+        struct QuantizedPoint
+        {
+            uint16_t x, y, z;
+        };
+        struct HalfUV
+        {
+            uint16_t u, v;
+        };
+
+        // TriangleMesh Public Data
+        const int nTriangles, nVertices;
+        Buffer<int> vertexIndices;
+        Buffer<Float> px, py, pz;
+        Buffer<Float> px1, py1, pz1;
+        Buffer<Float> nx, ny, nz;
+        Buffer<Float> u, v;
+        Buffer<TriangleEdges> edges;
+        // the compressed vertices; a position decodes to quantOrigin + q * quantStep, per axis
+        Buffer<QuantizedPoint> pq, pq1;
+        Buffer<uint32_t> nq;
+        Buffer<HalfUV> uvq;
+        Point3f quantOrigin;
+        Vector3f quantStep;
+
+    private:
+        // TriangleMesh Private Methods
+        Point3f decode(const QuantizedPoint &q) const
+        {
+            return Point3f(quantOrigin.x + q.x * quantStep.x, quantOrigin.y + q.y * quantStep.y,
+                           quantOrigin.z + q.z * quantStep.z);
+        }
+        QuantizedPoint quantize(const Point3f &p) const;
+        // sets the grid both keys share, over bounds
+        void setQuantizationGrid(const Bounds3f &bounds);
+        // requantizes the positions of one key, 0 or 1. The other key goes onto a new grid only
+        // when the union of the bounds changes, and then from its positions as first decoded, so
+        // that repeated updates do not pile up rounding errors
+        void quantizeKey(int key, const std::vector<Point3f> &P);
+
+        // TriangleMesh Private Data
+        // bounds of the positions each key was last given; the grid spans their union. Empty
+        // when not known, as for a mesh loaded from a BVH cache
+        Bounds3f keyBounds[2];
+        // a key's positions as decoded before its first move to another grid, kept until the key
+        // is set again: 12 more bytes a vertex, for meshes updated in place only
+        std::vector<Point3f> decodedKey[2];
+    };
+
+    class Triangle : public Shape
+    {
+    public:
+        // Triangle Public Methods
+        Triangle(const TriangleMesh *mesh, int triNumber) : mesh(mesh), triNumber(triNumber) {}
+        Bounds3f ObjectBound() const override;
+        Bounds3f WorldBoundAt(Float time) const override;
+        bool Intersect(const Ray &ray, Float *tHit, SurfaceInteraction *isect) const override;
+        bool IntersectP(const Ray &ray) const override;
+        Float Area() const override;
+        Interaction Sample(const Point2f &u, Float *pdf) const override;
+        DirectionCone NormalBounds() const override;
+        int TriangleIndex() const { return triNumber; }
+
+    private:
+        // Triangle Private Methods
+        bool intersectWatertight(const Ray &ray, Float *tHit, Float *b0, Float *b1, Float *b2) const;
+        bool intersectPrecomputed(const Ray &ray, Float *tHit, Float *b0, Float *b1, Float *b2) const;
+        void fillInteraction(const Ray &ray, Float b0, Float b1, Float b2, SurfaceInteraction *isect) const;
+
+        // Triangle Private Data
+        const TriangleMesh *mesh;
+        int triNumber;
+    };
+
+    // traced through a MeshPrimitive, which keeps no per-triangle objects
+    std::shared_ptr<TriangleMesh> CreateTriangleMesh(std::vector<int> vertexIndices, const std::vector<Point3f> &P,
+                                                     const std::vector<Normal3f> &N = {},
+                                                     const std::vector<Point2f> &UV = {},
+                                                     bool precomputeEdges = false, bool compress = false);
+    // one Shape per triangle, for what needs them one by one such as a DiffuseAreaLight; the shapes
+    // share one allocation, which keeps the mesh alive
+    std::vector<std::shared_ptr<Shape>> CreateTriangleShapes(const std::shared_ptr<TriangleMesh> &mesh);
+}
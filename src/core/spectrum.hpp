@@ -0,0 +1,70 @@
+#pragma once
+/***
+ *  RGBSpectrum
+ */
+#include <algorithm>
+#include <cmath>
+#include <ostream>
+#include <reina.hpp>
+namespace reina
+{
+    class RGBSpectrum
+    {
+    public:
+        // RGBSpectrum Public Methods
+        RGBSpectrum(Float v = 0) { c[0] = c[1] = c[2] = v; }
+        RGBSpectrum(Float r, Float g, Float b)
+        {
+            c[0] = r;
+            c[1] = g;
+            c[2] = b;
+        }
+        RGBSpectrum &operator+=(const RGBSpectrum &s)
+        {
+            for (int i = 0; i < 3; ++i)
+                c[i] += s.c[i];
+            return *this;
+        }
+        RGBSpectrum operator+(const RGBSpectrum &s) const { return RGBSpectrum(*this) += s; }
+        RGBSpectrum operator-(const RGBSpectrum &s) const
+        {
+            return RGBSpectrum(c[0] - s.c[0], c[1] - s.c[1], c[2] - s.c[2]);
+        }
+        RGBSpectrum &operator*=(const RGBSpectrum &s)
+        {
+            for (int i = 0; i < 3; ++i)
+                c[i] *= s.c[i];
+            return *this;
+        }
+        RGBSpectrum operator*(const RGBSpectrum &s) const { return RGBSpectrum(*this) *= s; }
+        RGBSpectrum &operator*=(Float a)
+        {
+            for (int i = 0; i < 3; ++i)
+                c[i] *= a;
+            return *this;
+        }
+        RGBSpectrum operator*(Float a) const { return RGBSpectrum(*this) *= a; }
+        friend RGBSpectrum operator*(Float a, const RGBSpectrum &s) { return s * a; }
+        RGBSpectrum operator/(Float a) const { return *this * (1 / a); }
+        RGBSpectrum &operator/=(Float a) { return *this *= (1 / a); }
+        bool operator==(const RGBSpectrum &s) const { return c[0] == s.c[0] && c[1] == s.c[1] && c[2] == s.c[2]; }
+        bool operator!=(const RGBSpectrum &s) const { return !(*this == s); }
+        Float operator[](int i) const { return c[i]; }
+        Float &operator[](int i) { return c[i]; }
+        bool IsBlack() const { return c[0] == 0 && c[1] == 0 && c[2] == 0; }
+        bool HasNaNs() const { return std::isnan(c[0]) || std::isnan(c[1]) || std::isnan(c[2]); }
+        Float MaxComponentValue() const { return std::max(c[0], std::max(c[1], c[2])); }
+        // luminance, Rec. 709 primaries
+        Float y() const { return 0.212671f * c[0] + 0.715160f * c[1] + 0.072169f * c[2]; }
+        friend std::ostream &operator<<(std::ostream &os, const RGBSpectrum &s)
+        {
+            os << "[ " << s.c[0] << ", " << s.c[1] << ", " << s.c[2] << " ]";
+            return os;
+        }
+
+        // RGBSpectrum Public Data
+        Float c[3];
+    };
+
+    using Spectrum = RGBSpectrum;
+}
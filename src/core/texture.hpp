@@ -0,0 +1,54 @@
+#pragma once
+/***
+ *  Texture
+ *  ConstantTexture
+ *  ImageTexture
+ */
+#include <algorithm>
+#include <memory>
+#include <reina.hpp>
+#include <core/interaction.hpp>
+#include <core/mipmap.hpp>
+#include <core/spectrum.hpp>
+namespace reina
+{
+    template <typename T>
+    class Texture
+    {
+    public:
+        virtual ~Texture() = default;
+        virtual T Evaluate(const SurfaceInteraction &si) const = 0;
+    };
+
+    template <typename T>
+    class ConstantTexture : public Texture<T>
+    {
+    public:
+        ConstantTexture(const T &value) : value(value) {}
+        T Evaluate(const SurfaceInteraction &) const override { return value; }
+
+    private:
+        T value;
+    };
+
+    // the surface's (u, v), scaled, looked up in a tiled MIP map. The level follows the pixel's
+    // footprint from SurfaceInteraction::ComputeDifferentials(); with no footprint at all it is
+    // the finest one.
+    class ImageTexture : public Texture<Spectrum>
+    {
+    public:
+        ImageTexture(std::shared_ptr<TiledMIPMap> mipmap, Float uScale = 1, Float vScale = 1)
+            : mipmap(std::move(mipmap)), uScale(uScale), vScale(vScale) {}
+        Spectrum Evaluate(const SurfaceInteraction &si) const override
+        {
+            Point2f st(si.uv.x * uScale, si.uv.y * vScale);
+            Float width = 2 * std::max({std::abs(si.dudx * uScale), std::abs(si.dudy * uScale),
+                                        std::abs(si.dvdx * vScale), std::abs(si.dvdy * vScale)});
+            return mipmap->Lookup(st, width);
+        }
+
+    private:
+        std::shared_ptr<TiledMIPMap> mipmap;
+        Float uScale, vScale;
+    };
+}
@@ -0,0 +1,667 @@
+#include <core/transform.hpp>
+#include <utils/math.hpp>
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <stdexcept>
+namespace reina
+{
+    // Matrix4x4 Method Definitions
+    Matrix4x4::Matrix4x4(const Float mat[4][4])
+    {
+        std::memcpy(m, mat, 16 * sizeof(Float));
+    }
+
+    Matrix4x4::Matrix4x4(Float t00, Float t01, Float t02, Float t03, Float t10, Float t11,
+                         Float t12, Float t13, Float t20, Float t21, Float t22, Float t23,
+                         Float t30, Float t31, Float t32, Float t33)
+    {
+        m[0][0] = t00;
+        m[0][1] = t01;
+        m[0][2] = t02;
+        m[0][3] = t03;
+        m[1][0] = t10;
+        m[1][1] = t11;
+        m[1][2] = t12;
+        m[1][3] = t13;
+        m[2][0] = t20;
+        m[2][1] = t21;
+        m[2][2] = t22;
+        m[2][3] = t23;
+        m[3][0] = t30;
+        m[3][1] = t31;
+        m[3][2] = t32;
+        m[3][3] = t33;
+    }
+
+    Matrix4x4 Matrix4x4::Mul(const Matrix4x4 &m1, const Matrix4x4 &m2)
+    {
+        Matrix4x4 r;
+        for (int i = 0; i < 4; ++i)
+            for (int j = 0; j < 4; ++j)
+                r.m[i][j] = m1.m[i][0] * m2.m[0][j] + m1.m[i][1] * m2.m[1][j] +
+                            m1.m[i][2] * m2.m[2][j] + m1.m[i][3] * m2.m[3][j];
+        return r;
+    }
+
+    Matrix4x4 Transpose(const Matrix4x4 &m)
+    {
+        return Matrix4x4(m.m[0][0], m.m[1][0], m.m[2][0], m.m[3][0], m.m[0][1],
+                         m.m[1][1], m.m[2][1], m.m[3][1], m.m[0][2], m.m[1][2],
+                         m.m[2][2], m.m[3][2], m.m[0][3], m.m[1][3], m.m[2][3],
+                         m.m[3][3]);
+    }
+
+    Matrix4x4 Inverse(const Matrix4x4 &m)
+    {
+        // Gauss-Jordan elimination with full pivoting
+        int indxc[4], indxr[4];
+        int ipiv[4] = {0, 0, 0, 0};
+        Float minv[4][4];
+        std::memcpy(minv, m.m, 4 * 4 * sizeof(Float));
+        for (int i = 0; i < 4; i++)
+        {
+            int irow = 0, icol = 0;
+            Float big = 0.f;
+            for (int j = 0; j < 4; j++)
+            {
+                if (ipiv[j] != 1)
+                {
+                    for (int k = 0; k < 4; k++)
+                    {
+                        if (ipiv[k] == 0)
+                        {
+                            if (std::abs(minv[j][k]) >= big)
+                            {
+                                big = Float(std::abs(minv[j][k]));
+                                irow = j;
+                                icol = k;
+                            }
+                        }
+                        else if (ipiv[k] > 1)
+                            throw std::runtime_error("Singular matrix in MatrixInvert");
+                    }
+                }
+            }
+            ++ipiv[icol];
+            if (irow != icol)
+            {
+                for (int k = 0; k < 4; ++k)
+                    std::swap(minv[irow][k], minv[icol][k]);
+            }
+            indxr[i] = irow;
+            indxc[i] = icol;
+            if (minv[icol][icol] == 0.f)
+                throw std::runtime_error("Singular matrix in MatrixInvert");
+
+            Float pivinv = 1. / minv[icol][icol];
+            minv[icol][icol] = 1.;
+            for (int j = 0; j < 4; j++)
+                minv[icol][j] *= pivinv;
+
+            for (int j = 0; j < 4; j++)
+            {
+                if (j != icol)
+                {
+                    Float save = minv[j][icol];
+                    minv[j][icol] = 0;
+                    for (int k = 0; k < 4; k++)
+                        minv[j][k] -= minv[icol][k] * save;
+                }
+            }
+        }
+        for (int j = 3; j >= 0; j--)
+        {
+            if (indxr[j] != indxc[j])
+            {
+                for (int k = 0; k < 4; k++)
+                    std::swap(minv[k][indxr[j]], minv[k][indxc[j]]);
+            }
+        }
+        return Matrix4x4(minv);
+    }
+
+    std::ostream &operator<<(std::ostream &os, const Matrix4x4 &m)
+    {
+        os << "[ ";
+        for (int i = 0; i < 4; ++i)
+            os << "[ " << m.m[i][0] << ", " << m.m[i][1] << ", " << m.m[i][2] << ", " << m.m[i][3]
+               << (i == 3 ? " ] " : " ], ");
+        os << "]";
+        return os;
+    }
+
+    // Transform Method Definitions
+    bool Transform::SwapsHandedness() const
+    {
+        Float det = m.m[0][0] * (m.m[1][1] * m.m[2][2] - m.m[1][2] * m.m[2][1]) -
+                    m.m[0][1] * (m.m[1][0] * m.m[2][2] - m.m[1][2] * m.m[2][0]) +
+                    m.m[0][2] * (m.m[1][0] * m.m[2][1] - m.m[1][1] * m.m[2][0]);
+        return det < 0;
+    }
+
+    Transform Transform::operator*(const Transform &t2) const
+    {
+        return Transform(Matrix4x4::Mul(m, t2.m), Matrix4x4::Mul(t2.mInv, mInv));
+    }
+
+    Point3f Transform::operator()(const Point3f &p, Vector3f *pTransError) const
+    {
+        // a sum of three products and a constant errs by at most gamma(3) of its absolute terms
+        Float x = p.x, y = p.y, z = p.z;
+        Float xAbsSum = std::abs(m.m[0][0] * x) + std::abs(m.m[0][1] * y) + std::abs(m.m[0][2] * z) + std::abs(m.m[0][3]);
+        Float yAbsSum = std::abs(m.m[1][0] * x) + std::abs(m.m[1][1] * y) + std::abs(m.m[1][2] * z) + std::abs(m.m[1][3]);
+        Float zAbsSum = std::abs(m.m[2][0] * x) + std::abs(m.m[2][1] * y) + std::abs(m.m[2][2] * z) + std::abs(m.m[2][3]);
+        *pTransError = Vector3f(xAbsSum, yAbsSum, zAbsSum) * gamma(3);
+        return (*this)(p);
+    }
+
+    Point3f Transform::operator()(const Point3f &p, const Vector3f &pError, Vector3f *pTransError) const
+    {
+        Vector3f roundingError;
+        Point3f ret = (*this)(p, &roundingError);
+        // the incoming error goes through the matrix too, and is rounded along with the rest
+        Vector3f carried(std::abs(m.m[0][0]) * pError.x + std::abs(m.m[0][1]) * pError.y + std::abs(m.m[0][2]) * pError.z,
+                         std::abs(m.m[1][0]) * pError.x + std::abs(m.m[1][1]) * pError.y + std::abs(m.m[1][2]) * pError.z,
+                         std::abs(m.m[2][0]) * pError.x + std::abs(m.m[2][1]) * pError.y + std::abs(m.m[2][2]) * pError.z);
+        *pTransError = carried * (gamma(3) + 1) + roundingError;
+        return ret;
+    }
+
+    Vector3f Transform::operator()(const Vector3f &v, Vector3f *vTransError) const
+    {
+        Float x = v.x, y = v.y, z = v.z;
+        Float xAbsSum = std::abs(m.m[0][0] * x) + std::abs(m.m[0][1] * y) + std::abs(m.m[0][2] * z);
+        Float yAbsSum = std::abs(m.m[1][0] * x) + std::abs(m.m[1][1] * y) + std::abs(m.m[1][2] * z);
+        Float zAbsSum = std::abs(m.m[2][0] * x) + std::abs(m.m[2][1] * y) + std::abs(m.m[2][2] * z);
+        *vTransError = Vector3f(xAbsSum, yAbsSum, zAbsSum) * gamma(3);
+        return (*this)(v);
+    }
+
+    Ray Transform::operator()(const Ray &r, Vector3f *oError, Vector3f *dError) const
+    {
+        Point3f o = (*this)(r.o, oError);
+        Vector3f d = (*this)(r.d, dError);
+        Float tMax = r.tMax;
+        // past the error box a hit cannot be on the surface the ray left
+        Float lengthSquared = d.LengthSquared();
+        if (lengthSquared > 0)
+        {
+            Float dt = Abs(d).Dot(*oError) / lengthSquared;
+            o += d * dt;
+            tMax -= dt;
+        }
+        return Ray(o, d, tMax, r.time, r.medium);
+    }
+
+    Bounds3f Transform::operator()(const Bounds3f &b) const
+    {
+        if (b.pMin.x > b.pMax.x || b.pMin.y > b.pMax.y || b.pMin.z > b.pMax.z)
+            return Bounds3f();
+        const Transform &M = *this;
+        if (m.m[3][0] != 0 || m.m[3][1] != 0 || m.m[3][2] != 0 || m.m[3][3] != 1)
+        {
+            Bounds3f ret(M(b.Corner(0)));
+            for (int i = 1; i < 8; ++i)
+                ret = Union(ret, M(b.Corner(i)));
+            return ret;
+        }
+        // affine: each output coordinate is a sum of one product per input axis, extremal where each
+        // product is (Arvo), so nine products and no corners
+        Point3f pMin, pMax;
+        for (int i = 0; i < 3; ++i)
+        {
+            Float lo = m.m[i][3], hi = m.m[i][3];
+            for (int j = 0; j < 3; ++j)
+            {
+                Float a = m.m[i][j] * b.pMin[j], c = m.m[i][j] * b.pMax[j];
+                lo += std::min(a, c);
+                hi += std::max(a, c);
+            }
+            pMin[i] = lo;
+            pMax[i] = hi;
+        }
+        return Bounds3f(pMin, pMax);
+    }
+
+    SurfaceInteraction Transform::operator()(const SurfaceInteraction &si) const
+    {
+        SurfaceInteraction ret(si);
+        const Transform &t = *this;
+        ret.p = t(si.p);
+        ret.wo = t(si.wo);
+        if (ret.wo.LengthSquared() > 0)
+            ret.wo = Normalize(ret.wo);
+        ret.n = Normalize(t(si.n));
+        ret.shadingN = Faceforward(Normalize(t(si.shadingN)), Vector3f(ret.n));
+        ret.dpdu = t(si.dpdu);
+        ret.dpdv = t(si.dpdv);
+        ret.dpdx = t(si.dpdx);
+        ret.dpdy = t(si.dpdy);
+        return ret;
+    }
+
+    Transform Translate(const Vector3f &delta)
+    {
+        Matrix4x4 m(1, 0, 0, delta.x, 0, 1, 0, delta.y, 0, 0, 1, delta.z, 0, 0, 0, 1);
+        Matrix4x4 minv(1, 0, 0, -delta.x, 0, 1, 0, -delta.y, 0, 0, 1, -delta.z, 0, 0, 0, 1);
+        return Transform(m, minv);
+    }
+
+    Transform Scale(Float x, Float y, Float z)
+    {
+        Matrix4x4 m(x, 0, 0, 0, 0, y, 0, 0, 0, 0, z, 0, 0, 0, 0, 1);
+        Matrix4x4 minv(1 / x, 0, 0, 0, 0, 1 / y, 0, 0, 0, 0, 1 / z, 0, 0, 0, 0, 1);
+        return Transform(m, minv);
+    }
+
+    Transform RotateX(Float theta)
+    {
+        Float sinTheta = std::sin(Radians(theta));
+        Float cosTheta = std::cos(Radians(theta));
+        Matrix4x4 m(1, 0, 0, 0, 0, cosTheta, -sinTheta, 0, 0, sinTheta, cosTheta, 0, 0, 0, 0, 1);
+        return Transform(m, Transpose(m));
+    }
+
+    Transform RotateY(Float theta)
+    {
+        Float sinTheta = std::sin(Radians(theta));
+        Float cosTheta = std::cos(Radians(theta));
+        Matrix4x4 m(cosTheta, 0, sinTheta, 0, 0, 1, 0, 0, -sinTheta, 0, cosTheta, 0, 0, 0, 0, 1);
+        return Transform(m, Transpose(m));
+    }
+
+    Transform RotateZ(Float theta)
+    {
+        Float sinTheta = std::sin(Radians(theta));
+        Float cosTheta = std::cos(Radians(theta));
+        Matrix4x4 m(cosTheta, -sinTheta, 0, 0, sinTheta, cosTheta, 0, 0, 0, 0, 1, 0, 0, 0, 0, 1);
+        return Transform(m, Transpose(m));
+    }
+
+    Transform Rotate(Float theta, const Vector3f &axis)
+    {
+        Vector3f a = Normalize(axis);
+        Float sinTheta = std::sin(Radians(theta));
+        Float cosTheta = std::cos(Radians(theta));
+        Matrix4x4 m;
+        m.m[0][0] = a.x * a.x + (1 - a.x * a.x) * cosTheta;
+        m.m[0][1] = a.x * a.y * (1 - cosTheta) - a.z * sinTheta;
+        m.m[0][2] = a.x * a.z * (1 - cosTheta) + a.y * sinTheta;
+        m.m[0][3] = 0;
+        m.m[1][0] = a.x * a.y * (1 - cosTheta) + a.z * sinTheta;
+        m.m[1][1] = a.y * a.y + (1 - a.y * a.y) * cosTheta;
+        m.m[1][2] = a.y * a.z * (1 - cosTheta) - a.x * sinTheta;
+        m.m[1][3] = 0;
+        m.m[2][0] = a.x * a.z * (1 - cosTheta) - a.y * sinTheta;
+        m.m[2][1] = a.y * a.z * (1 - cosTheta) + a.x * sinTheta;
+        m.m[2][2] = a.z * a.z + (1 - a.z * a.z) * cosTheta;
+        m.m[2][3] = 0;
+        return Transform(m, Transpose(m));
+    }
+
+    Transform LookAt(const Point3f &pos, const Point3f &look, const Vector3f &up)
+    {
+        Matrix4x4 cameraToWorld;
+        cameraToWorld.m[0][3] = pos.x;
+        cameraToWorld.m[1][3] = pos.y;
+        cameraToWorld.m[2][3] = pos.z;
+        cameraToWorld.m[3][3] = 1;
+        Vector3f dir = Normalize(look - pos);
+        Vector3f right = Normalize(Normalize(up).Cross(dir));
+        Vector3f newUp = dir.Cross(right);
+        cameraToWorld.m[0][0] = right.x;
+        cameraToWorld.m[1][0] = right.y;
+        cameraToWorld.m[2][0] = right.z;
+        cameraToWorld.m[3][0] = 0.;
+        cameraToWorld.m[0][1] = newUp.x;
+        cameraToWorld.m[1][1] = newUp.y;
+        cameraToWorld.m[2][1] = newUp.z;
+        cameraToWorld.m[3][1] = 0.;
+        cameraToWorld.m[0][2] = dir.x;
+        cameraToWorld.m[1][2] = dir.y;
+        cameraToWorld.m[2][2] = dir.z;
+        cameraToWorld.m[3][2] = 0.;
+        return Transform(Inverse(cameraToWorld), cameraToWorld);
+    }
+
+    namespace
+    {
+        // the rotation of q as a quadratic form in q, here with two arguments: R(a, a) is the rotation
+        // of a unit a, and R(q(t), q(t)) expands over the terms of q(t) because it is bilinear
+        Matrix4x4 RotationForm(const Quaternion &a, const Quaternion &b)
+        {
+            Float xx = a.v.x * b.v.x, yy = a.v.y * b.v.y, zz = a.v.z * b.v.z, ww = a.w * b.w;
+            Float xy = a.v.x * b.v.y + a.v.y * b.v.x, xz = a.v.x * b.v.z + a.v.z * b.v.x;
+            Float yz = a.v.y * b.v.z + a.v.z * b.v.y, xw = a.v.x * b.w + a.w * b.v.x;
+            Float yw = a.v.y * b.w + a.w * b.v.y, zw = a.v.z * b.w + a.w * b.v.z;
+            return Matrix4x4(ww + xx - yy - zz, xy - zw, xz + yw, 0,
+                             xy + zw, ww - xx + yy - zz, yz - xw, 0,
+                             xz - yw, yz + xw, ww - xx - yy + zz, 0,
+                             0, 0, 0, 0);
+        }
+
+        // the upper left 3x3 blocks only; the rest of the result is zero
+        Matrix4x4 Mul3(const Matrix4x4 &a, const Matrix4x4 &b)
+        {
+            Matrix4x4 r(0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0);
+            for (int i = 0; i < 3; ++i)
+                for (int j = 0; j < 3; ++j)
+                    r.m[i][j] = a.m[i][0] * b.m[0][j] + a.m[i][1] * b.m[1][j] + a.m[i][2] * b.m[2][j];
+            return r;
+        }
+
+        Matrix4x4 Scaled(const Matrix4x4 &a, Float s)
+        {
+            Matrix4x4 r;
+            for (int i = 0; i < 4; ++i)
+                for (int j = 0; j < 4; ++j)
+                    r.m[i][j] = a.m[i][j] * s;
+            return r;
+        }
+
+        // a * sa + b * sb, element-wise
+        Matrix4x4 Combine(const Matrix4x4 &a, Float sa, const Matrix4x4 &b, Float sb)
+        {
+            Matrix4x4 r;
+            for (int i = 0; i < 4; ++i)
+                for (int j = 0; j < 4; ++j)
+                    r.m[i][j] = a.m[i][j] * sa + b.m[i][j] * sb;
+            return r;
+        }
+
+        Vector3f ApplyAffine(const Matrix4x4 &m, const Point3f &p)
+        {
+            return Vector3f(m.m[0][0] * p.x + m.m[0][1] * p.y + m.m[0][2] * p.z + m.m[0][3],
+                            m.m[1][0] * p.x + m.m[1][1] * p.y + m.m[1][2] * p.z + m.m[1][3],
+                            m.m[2][0] * p.x + m.m[2][1] * p.y + m.m[2][2] * p.z + m.m[2][3]);
+        }
+
+        struct Interval
+        {
+            Interval(Float v) : low(v), high(v) {}
+            Interval(Float v0, Float v1) : low(std::min(v0, v1)), high(std::max(v0, v1)) {}
+            Interval operator+(const Interval &i) const { return Interval(low + i.low, high + i.high); }
+            Interval operator*(const Interval &i) const
+            {
+                Float a = low * i.low, b = high * i.low, c = low * i.high, d = high * i.high;
+                return Interval(std::min({a, b, c, d}), std::max({a, b, c, d}));
+            }
+            Float low, high;
+        };
+
+        // for intervals inside [0, 2 pi]
+        Interval Sin(const Interval &i)
+        {
+            Interval r(std::sin(i.low), std::sin(i.high));
+            if (i.low < Pi / 2 && i.high > Pi / 2)
+                r.high = 1;
+            if (i.low < 1.5f * Pi && i.high > 1.5f * Pi)
+                r.low = -1;
+            return r;
+        }
+
+        Interval Cos(const Interval &i)
+        {
+            Interval r(std::cos(i.low), std::cos(i.high));
+            if (i.low < Pi && i.high > Pi)
+                r.low = -1;
+            return r;
+        }
+
+        // zeros of c1 + (c2 + c3 u) cos(2 theta u) + (c4 + c5 u) sin(2 theta u) in u: bisection
+        // down to intervals that may hold one, then Newton from their middle
+        template <typename F>
+        void IntervalFindZeros(const Float c[5], Float theta, Interval u, F onZero, int depth = 8)
+        {
+            Interval angle = Interval(2 * theta) * u;
+            Interval range = Interval(c[0]) + (Interval(c[1]) + Interval(c[2]) * u) * Cos(angle) +
+                             (Interval(c[3]) + Interval(c[4]) * u) * Sin(angle);
+            if (range.low > 0 || range.high < 0 || range.low == range.high)
+                return;
+            if (depth > 0)
+            {
+                Float mid = (u.low + u.high) / 2;
+                IntervalFindZeros(c, theta, Interval(u.low, mid), onZero, depth - 1);
+                IntervalFindZeros(c, theta, Interval(mid, u.high), onZero, depth - 1);
+                return;
+            }
+            Float uNewton = (u.low + u.high) / 2;
+            for (int i = 0; i < 4; ++i)
+            {
+                Float cosU = std::cos(2 * theta * uNewton), sinU = std::sin(2 * theta * uNewton);
+                Float f = c[0] + (c[1] + c[2] * uNewton) * cosU + (c[3] + c[4] * uNewton) * sinU;
+                Float fPrime = (c[2] + 2 * theta * (c[3] + c[4] * uNewton)) * cosU +
+                               (c[4] - 2 * theta * (c[1] + c[2] * uNewton)) * sinU;
+                if (f == 0 || fPrime == 0)
+                    break;
+                uNewton -= f / fPrime;
+            }
+            if (uNewton >= u.low - 1e-3f && uNewton < u.high + 1e-3f)
+                onZero(Clamp(uNewton, 0, 1));
+        }
+    }
+
+    Transform ToTransform(const Quaternion &q)
+    {
+        Matrix4x4 m = RotationForm(q, q);
+        m.m[3][3] = 1;
+        return Transform(m, Transpose(m));
+    }
+
+    Quaternion ToQuaternion(const Transform &t)
+    {
+        const Matrix4x4 &m = t.GetMatrix();
+        Quaternion q;
+        Float trace = m.m[0][0] + m.m[1][1] + m.m[2][2];
+        if (trace > 0)
+        {
+            Float s = std::sqrt(trace + 1);
+            q.w = s / 2;
+            s = 0.5f / s;
+            q.v = Vector3f((m.m[2][1] - m.m[1][2]) * s, (m.m[0][2] - m.m[2][0]) * s, (m.m[1][0] - m.m[0][1]) * s);
+            return q;
+        }
+        // from the largest diagonal element, which keeps s away from 0
+        const int next[3] = {1, 2, 0};
+        int i = 0;
+        if (m.m[1][1] > m.m[0][0])
+            i = 1;
+        if (m.m[2][2] > m.m[i][i])
+            i = 2;
+        int j = next[i], k = next[j];
+        Float s = std::sqrt((m.m[i][i] - (m.m[j][j] + m.m[k][k])) + 1);
+        Float v[3];
+        v[i] = s / 2;
+        if (s != 0)
+            s = 0.5f / s;
+        q.w = (m.m[k][j] - m.m[j][k]) * s;
+        v[j] = (m.m[j][i] + m.m[i][j]) * s;
+        v[k] = (m.m[k][i] + m.m[i][k]) * s;
+        q.v = Vector3f(v[0], v[1], v[2]);
+        return q;
+    }
+
+    // AnimatedTransform Method Definitions
+    AnimatedTransform::AnimatedTransform(const Transform &startTransform, Float startTime,
+                                         const Transform &endTransform, Float endTime)
+        : startTransform(startTransform), endTransform(endTransform), startTime(startTime), endTime(endTime),
+          actuallyAnimated(startTransform != endTransform), hasRotation(false)
+    {
+        if (!actuallyAnimated)
+            return;
+        Decompose(startTransform.GetMatrix(), &T[0], &R[0], &S[0]);
+        Decompose(endTransform.GetMatrix(), &T[1], &R[1], &S[1]);
+        // q and -q are the same rotation: take the shorter way around
+        if (Dot(R[0], R[1]) < 0)
+            R[1] = -R[1];
+        Quaternion d = R[0] - R[1], s = R[0] + R[1];
+        theta = 2 * std::atan2(std::sqrt(Dot(d, d)), std::sqrt(Dot(s, s)));
+        hasRotation = theta > 0;
+        if (!hasRotation)
+            return;
+
+        // with qperp the unit quaternion orthogonal to R[0] in their plane, Slerp() is
+        // q(u) = R[0] cos(theta u) + qperp sin(theta u), so the rotation matrix is
+        // K0 + K1 cos(2 theta u) + K2 sin(2 theta u); the scale S0 + dS u and the translation
+        // T0 + dT u are linear, and a point's path R(u) S(u) p + T(u) is differentiated from there
+        Quaternion qperp = Normalize(R[1] - R[0] * Dot(R[0], R[1]));
+        Matrix4x4 r00 = RotationForm(R[0], R[0]), rpp = RotationForm(qperp, qperp);
+        Matrix4x4 K0 = Combine(r00, 0.5f, rpp, 0.5f), K1 = Combine(r00, 0.5f, rpp, -0.5f);
+        Matrix4x4 K2 = RotationForm(R[0], qperp);
+        Matrix4x4 dS = Combine(S[1], 1, S[0], -1);
+        Float omega = 2 * theta;
+        Matrix4x4 K1S0 = Mul3(K1, S[0]), K1dS = Mul3(K1, dS), K2S0 = Mul3(K2, S[0]), K2dS = Mul3(K2, dS);
+        c[0] = Mul3(K0, dS);
+        Vector3f dT = T[1] - T[0];
+        c[0].m[0][3] = dT.x;
+        c[0].m[1][3] = dT.y;
+        c[0].m[2][3] = dT.z;
+        c[1] = Combine(K1dS, 1, K2S0, omega);
+        c[2] = Scaled(K2dS, omega);
+        c[3] = Combine(K2dS, 1, K1S0, -omega);
+        c[4] = Scaled(K1dS, -omega);
+    }
+
+    void AnimatedTransform::Decompose(const Matrix4x4 &m, Vector3f *T, Quaternion *Rquat, Matrix4x4 *S)
+    {
+        *T = Vector3f(m.m[0][3], m.m[1][3], m.m[2][3]);
+        Matrix4x4 M = m;
+        for (int i = 0; i < 3; ++i)
+            M.m[i][3] = M.m[3][i] = 0;
+        M.m[3][3] = 1;
+        // polar decomposition M = R S: averaging R with its inverse transpose converges to the rotation
+        Matrix4x4 R = M;
+        Float norm;
+        int count = 0;
+        do
+        {
+            Matrix4x4 Rit = Inverse(Transpose(R));
+            Matrix4x4 Rnext = Combine(R, 0.5f, Rit, 0.5f);
+            norm = 0;
+            for (int i = 0; i < 3; ++i)
+                norm = std::max(norm, std::abs(R.m[i][0] - Rnext.m[i][0]) + std::abs(R.m[i][1] - Rnext.m[i][1]) +
+                                          std::abs(R.m[i][2] - Rnext.m[i][2]));
+            R = Rnext;
+        } while (++count < 100 && norm > .0001f);
+        *Rquat = Normalize(ToQuaternion(Transform(R, Transpose(R))));
+        *S = Matrix4x4::Mul(Transpose(R), M);
+    }
+
+    Matrix4x4 AnimatedTransform::interpolatedMatrix(Float u, Matrix4x4 *mInv) const
+    {
+        Quaternion q = hasRotation ? Slerp(u, R[0], R[1]) : R[0];
+        Matrix4x4 rot = RotationForm(q, q);
+        Matrix4x4 scale = Combine(S[0], 1 - u, S[1], u);
+        Vector3f t = T[0] * (1 - u) + T[1] * u;
+        Matrix4x4 m = Mul3(rot, scale);
+        m.m[0][3] = t.x;
+        m.m[1][3] = t.y;
+        m.m[2][3] = t.z;
+        m.m[3][3] = 1;
+
+        // (T R S)^-1 = S^-1 R^T T^-1, with S^-1 from the cofactors of its 3x3 block
+        const Float(*s)[4] = scale.m;
+        Matrix4x4 sInv(s[1][1] * s[2][2] - s[1][2] * s[2][1], s[0][2] * s[2][1] - s[0][1] * s[2][2],
+                       s[0][1] * s[1][2] - s[0][2] * s[1][1], 0,
+                       s[1][2] * s[2][0] - s[1][0] * s[2][2], s[0][0] * s[2][2] - s[0][2] * s[2][0],
+                       s[0][2] * s[1][0] - s[0][0] * s[1][2], 0,
+                       s[1][0] * s[2][1] - s[1][1] * s[2][0], s[0][1] * s[2][0] - s[0][0] * s[2][1],
+                       s[0][0] * s[1][1] - s[0][1] * s[1][0], 0,
+                       0, 0, 0, 0);
+        Float det = s[0][0] * sInv.m[0][0] + s[0][1] * sInv.m[1][0] + s[0][2] * sInv.m[2][0];
+        if (det == 0)
+            throw std::runtime_error("Singular matrix in AnimatedTransform");
+        *mInv = Scaled(Mul3(sInv, Transpose(rot)), 1 / det);
+        for (int i = 0; i < 3; ++i)
+            mInv->m[i][3] = -(mInv->m[i][0] * t.x + mInv->m[i][1] * t.y + mInv->m[i][2] * t.z);
+        mInv->m[3][3] = 1;
+        return m;
+    }
+
+    void AnimatedTransform::Interpolate(Float time, Transform *t) const
+    {
+        if (!actuallyAnimated || time <= startTime)
+        {
+            *t = startTransform;
+            return;
+        }
+        if (time >= endTime)
+        {
+            *t = endTransform;
+            return;
+        }
+        Matrix4x4 mInv;
+        Matrix4x4 m = interpolatedMatrix((time - startTime) / (endTime - startTime), &mInv);
+        *t = Transform(m, mInv);
+    }
+
+    Ray AnimatedTransform::operator()(const Ray &r) const
+    {
+        if (!actuallyAnimated || r.time <= startTime)
+            return startTransform(r);
+        if (r.time >= endTime)
+            return endTransform(r);
+        Transform t;
+        Interpolate(r.time, &t);
+        return t(r);
+    }
+
+    Point3f AnimatedTransform::operator()(Float time, const Point3f &p) const
+    {
+        if (!actuallyAnimated || time <= startTime)
+            return startTransform(p);
+        if (time >= endTime)
+            return endTransform(p);
+        Transform t;
+        Interpolate(time, &t);
+        return t(p);
+    }
+
+    Vector3f AnimatedTransform::operator()(Float time, const Vector3f &v) const
+    {
+        if (!actuallyAnimated || time <= startTime)
+            return startTransform(v);
+        if (time >= endTime)
+            return endTransform(v);
+        Transform t;
+        Interpolate(time, &t);
+        return t(v);
+    }
+
+    Bounds3f AnimatedTransform::MotionBounds(const Bounds3f &b) const
+    {
+        if (!actuallyAnimated)
+            return startTransform(b);
+        // without rotation every point moves on a straight line, so the ends bound the whole path
+        if (!hasRotation)
+            return Union(startTransform(b), endTransform(b));
+        if (b.pMin.x > b.pMax.x || b.pMin.y > b.pMax.y || b.pMin.z > b.pMax.z)
+            return Bounds3f();
+        // at any time the box maps to a parallelepiped whose extremes are corners
+        Bounds3f bounds;
+        for (int corner = 0; corner < 8; ++corner)
+            bounds = Union(bounds, BoundPointMotion(b.Corner(corner)));
+        return bounds;
+    }
+
+    Bounds3f AnimatedTransform::BoundPointMotion(const Point3f &p) const
+    {
+        if (!actuallyAnimated)
+            return Bounds3f(startTransform(p));
+        Bounds3f bounds(startTransform(p), endTransform(p));
+        if (!hasRotation)
+            return bounds;
+        // the extremes of each coordinate are at the ends or where its derivative vanishes
+        Vector3f ck[5];
+        for (int k = 0; k < 5; ++k)
+            ck[k] = ApplyAffine(c[k], p);
+        for (int axis = 0; axis < 3; ++axis)
+        {
+            Float coefficients[5] = {ck[0][axis], ck[1][axis], ck[2][axis], ck[3][axis], ck[4][axis]};
+            IntervalFindZeros(coefficients, theta, Interval(0, 1), [&](Float u)
+                              { bounds = Union(bounds, (*this)(Lerp(u, startTime, endTime), p)); });
+        }
+        return bounds;
+    }
+}
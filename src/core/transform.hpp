@@ -0,0 +1,227 @@
+#pragma once
+/***
+ *  Matrix4x4
+ *  Transform
+ *  AnimatedTransform
+ */
+#include <ostream>
+#include <reina.hpp>
+#include <utils/vecmath.hpp>
+#include <utils/simd.hpp>
+#include <core/ray.hpp>
+#include <core/interaction.hpp>
+namespace reina
+{
+    struct Matrix4x4
+    {
+        // Matrix4x4 Public Methods
+        Matrix4x4()
+        {
+            m[0][0] = m[1][1] = m[2][2] = m[3][3] = 1.f;
+            m[0][1] = m[0][2] = m[0][3] = m[1][0] = m[1][2] = m[1][3] = m[2][0] =
+                m[2][1] = m[2][3] = m[3][0] = m[3][1] = m[3][2] = 0.f;
+        }
+        Matrix4x4(const Float mat[4][4]);
+        Matrix4x4(Float t00, Float t01, Float t02, Float t03, Float t10, Float t11,
+                  Float t12, Float t13, Float t20, Float t21, Float t22, Float t23,
+                  Float t30, Float t31, Float t32, Float t33);
+        bool operator==(const Matrix4x4 &m2) const
+        {
+            for (int i = 0; i < 4; ++i)
+                for (int j = 0; j < 4; ++j)
+                    if (m[i][j] != m2.m[i][j])
+                        return false;
+            return true;
+        }
+        bool operator!=(const Matrix4x4 &m2) const { return !(*this == m2); }
+        static Matrix4x4 Mul(const Matrix4x4 &m1, const Matrix4x4 &m2);
+        friend Matrix4x4 Transpose(const Matrix4x4 &m);
+        friend Matrix4x4 Inverse(const Matrix4x4 &m);
+        friend std::ostream &operator<<(std::ostream &os, const Matrix4x4 &m);
+
+        Float m[4][4];
+    };
+
+    class Transform
+    {
+    public:
+        // Transform Public Methods
+        Transform() = default;
+        Transform(const Float mat[4][4]) : m(mat), mInv(Inverse(m)) {}
+        Transform(const Matrix4x4 &m) : m(m), mInv(Inverse(m)) {}
+        Transform(const Matrix4x4 &m, const Matrix4x4 &mInv) : m(m), mInv(mInv) {}
+        friend Transform Inverse(const Transform &t) { return Transform(t.mInv, t.m); }
+        friend Transform Transpose(const Transform &t) { return Transform(Transpose(t.m), Transpose(t.mInv)); }
+        bool operator==(const Transform &t) const { return t.m == m && t.mInv == mInv; }
+        bool operator!=(const Transform &t) const { return t.m != m || t.mInv != mInv; }
+        bool IsIdentity() const { return m == Matrix4x4(); }
+        const Matrix4x4 &GetMatrix() const { return m; }
+        const Matrix4x4 &GetInverseMatrix() const { return mInv; }
+        bool SwapsHandedness() const;
+        Transform operator*(const Transform &t2) const;
+
+        inline Point3f operator()(const Point3f &p) const;
+        inline Vector3f operator()(const Vector3f &v) const;
+        inline Normal3f operator()(const Normal3f &n) const;
+        inline Ray operator()(const Ray &r) const;
+        inline Point3f ApplyInverse(const Point3f &p) const;
+        inline Vector3f ApplyInverse(const Vector3f &v) const;
+        inline Ray ApplyInverse(const Ray &r) const;
+        // N points or vectors at once, one per lane
+        template <int N>
+        Point3<SimdFloat<N>> operator()(const Point3<SimdFloat<N>> &p) const;
+        template <int N>
+        Vector3<SimdFloat<N>> operator()(const Vector3<SimdFloat<N>> &v) const;
+        // with a bound on the rounding error of the result, per axis and in absolute terms; for
+        // affine transforms only. pError is the error the point already carries
+        Point3f operator()(const Point3f &p, Vector3f *pTransError) const;
+        Point3f operator()(const Point3f &p, const Vector3f &pError, Vector3f *pTransError) const;
+        Vector3f operator()(const Vector3f &v, Vector3f *vTransError) const;
+        // the origin is moved to the far side of its error box along d, and tMax shortened to match
+        Ray operator()(const Ray &r, Vector3f *oError, Vector3f *dError) const;
+        Bounds3f operator()(const Bounds3f &b) const;
+        SurfaceInteraction operator()(const SurfaceInteraction &si) const;
+
+    private:
+        // Transform Private Data
+        Matrix4x4 m, mInv;
+    };
+
+    Transform Translate(const Vector3f &delta);
+    Transform Scale(Float x, Float y, Float z);
+    Transform RotateX(Float theta);
+    Transform RotateY(Float theta);
+    Transform RotateZ(Float theta);
+    Transform Rotate(Float theta, const Vector3f &axis);
+    Transform LookAt(const Point3f &pos, const Point3f &look, const Vector3f &up);
+    // q must be a unit quaternion; t must be a rotation
+    Transform ToTransform(const Quaternion &q);
+    Quaternion ToQuaternion(const Transform &t);
+
+    // a transform moving over the shutter [startTime, endTime] and resting before and after it. The
+    // ends are split into translation, rotation and scale, which are interpolated separately, the
+    // rotation by Slerp(), so a rigid motion stays rigid instead of shearing through the lerp of
+    // two matrices
+    class AnimatedTransform
+    {
+    public:
+        // AnimatedTransform Public Methods
+        // one that does not move
+        AnimatedTransform(const Transform &t = Transform()) : AnimatedTransform(t, 0, t, 1) {}
+        AnimatedTransform(const Transform &startTransform, Float startTime, const Transform &endTransform,
+                          Float endTime);
+        bool IsAnimated() const { return actuallyAnimated; }
+        bool HasRotation() const { return hasRotation; }
+        const Transform &StartTransform() const { return startTransform; }
+        const Transform &EndTransform() const { return endTransform; }
+        // the inverse is composed from the parts, no 4x4 inversion per call
+        void Interpolate(Float time, Transform *t) const;
+        Ray operator()(const Ray &r) const;
+        Point3f operator()(Float time, const Point3f &p) const;
+        Vector3f operator()(Float time, const Vector3f &v) const;
+        // everything b sweeps over during the shutter, tight for the corners' paths
+        Bounds3f MotionBounds(const Bounds3f &b) const;
+        Bounds3f BoundPointMotion(const Point3f &p) const;
+
+    private:
+        // AnimatedTransform Private Methods
+        static void Decompose(const Matrix4x4 &m, Vector3f *T, Quaternion *R, Matrix4x4 *S);
+        Matrix4x4 interpolatedMatrix(Float u, Matrix4x4 *mInv) const;
+
+        // AnimatedTransform Private Data
+        Transform startTransform, endTransform;
+        Float startTime, endTime;
+        bool actuallyAnimated, hasRotation;
+        Vector3f T[2];
+        Quaternion R[2];
+        Matrix4x4 S[2];
+        // Slerp() angle between R[0] and R[1]
+        Float theta = 0;
+        // d/du of a point's path over the normalized time u in [0, 1], per axis:
+        // c1 + (c2 + c3 u) cos(2 theta u) + (c4 + c5 u) sin(2 theta u), ci = c[i - 1](p)
+        Matrix4x4 c[5];
+    };
+
+    // Transform Inline Functions
+    inline Point3f Transform::operator()(const Point3f &p) const
+    {
+        Float x = p.x, y = p.y, z = p.z;
+        Float xp = m.m[0][0] * x + m.m[0][1] * y + m.m[0][2] * z + m.m[0][3];
+        Float yp = m.m[1][0] * x + m.m[1][1] * y + m.m[1][2] * z + m.m[1][3];
+        Float zp = m.m[2][0] * x + m.m[2][1] * y + m.m[2][2] * z + m.m[2][3];
+        Float wp = m.m[3][0] * x + m.m[3][1] * y + m.m[3][2] * z + m.m[3][3];
+        if (wp == 1)
+            return Point3f(xp, yp, zp);
+        return Point3f(xp, yp, zp) / wp;
+    }
+
+    inline Vector3f Transform::operator()(const Vector3f &v) const
+    {
+        Float x = v.x, y = v.y, z = v.z;
+        return Vector3f(m.m[0][0] * x + m.m[0][1] * y + m.m[0][2] * z,
+                        m.m[1][0] * x + m.m[1][1] * y + m.m[1][2] * z,
+                        m.m[2][0] * x + m.m[2][1] * y + m.m[2][2] * z);
+    }
+
+    inline Normal3f Transform::operator()(const Normal3f &n) const
+    {
+        // normals go through the inverse transpose
+        Float x = n.x, y = n.y, z = n.z;
+        return Normal3f(mInv.m[0][0] * x + mInv.m[1][0] * y + mInv.m[2][0] * z,
+                        mInv.m[0][1] * x + mInv.m[1][1] * y + mInv.m[2][1] * z,
+                        mInv.m[0][2] * x + mInv.m[1][2] * y + mInv.m[2][2] * z);
+    }
+
+    inline Ray Transform::operator()(const Ray &r) const
+    {
+        // the direction is not renormalized, so t values carry over unchanged
+        return Ray((*this)(r.o), (*this)(r.d), r.tMax, r.time, r.medium);
+    }
+
+    inline Point3f Transform::ApplyInverse(const Point3f &p) const
+    {
+        Float x = p.x, y = p.y, z = p.z;
+        Float xp = mInv.m[0][0] * x + mInv.m[0][1] * y + mInv.m[0][2] * z + mInv.m[0][3];
+        Float yp = mInv.m[1][0] * x + mInv.m[1][1] * y + mInv.m[1][2] * z + mInv.m[1][3];
+        Float zp = mInv.m[2][0] * x + mInv.m[2][1] * y + mInv.m[2][2] * z + mInv.m[2][3];
+        Float wp = mInv.m[3][0] * x + mInv.m[3][1] * y + mInv.m[3][2] * z + mInv.m[3][3];
+        if (wp == 1)
+            return Point3f(xp, yp, zp);
+        return Point3f(xp, yp, zp) / wp;
+    }
+
+    inline Vector3f Transform::ApplyInverse(const Vector3f &v) const
+    {
+        Float x = v.x, y = v.y, z = v.z;
+        return Vector3f(mInv.m[0][0] * x + mInv.m[0][1] * y + mInv.m[0][2] * z,
+                        mInv.m[1][0] * x + mInv.m[1][1] * y + mInv.m[1][2] * z,
+                        mInv.m[2][0] * x + mInv.m[2][1] * y + mInv.m[2][2] * z);
+    }
+
+    inline Ray Transform::ApplyInverse(const Ray &r) const
+    {
+        return Ray(ApplyInverse(r.o), ApplyInverse(r.d), r.tMax, r.time, r.medium);
+    }
+
+    template <int N>
+    inline Point3<SimdFloat<N>> Transform::operator()(const Point3<SimdFloat<N>> &p) const
+    {
+        using F = SimdFloat<N>;
+        F xp = FMA(F(m.m[0][0]), p.x, FMA(F(m.m[0][1]), p.y, FMA(F(m.m[0][2]), p.z, F(m.m[0][3]))));
+        F yp = FMA(F(m.m[1][0]), p.x, FMA(F(m.m[1][1]), p.y, FMA(F(m.m[1][2]), p.z, F(m.m[1][3]))));
+        F zp = FMA(F(m.m[2][0]), p.x, FMA(F(m.m[2][1]), p.y, FMA(F(m.m[2][2]), p.z, F(m.m[2][3]))));
+        if (m.m[3][0] == 0 && m.m[3][1] == 0 && m.m[3][2] == 0 && m.m[3][3] == 1)
+            return Point3<F>(xp, yp, zp);
+        F wp = FMA(F(m.m[3][0]), p.x, FMA(F(m.m[3][1]), p.y, FMA(F(m.m[3][2]), p.z, F(m.m[3][3]))));
+        return Point3<F>(xp / wp, yp / wp, zp / wp);
+    }
+
+    template <int N>
+    inline Vector3<SimdFloat<N>> Transform::operator()(const Vector3<SimdFloat<N>> &v) const
+    {
+        using F = SimdFloat<N>;
+        return Vector3<F>(FMA(F(m.m[0][0]), v.x, FMA(F(m.m[0][1]), v.y, F(m.m[0][2]) * v.z)),
+                          FMA(F(m.m[1][0]), v.x, FMA(F(m.m[1][1]), v.y, F(m.m[1][2]) * v.z)),
+                          FMA(F(m.m[2][0]), v.x, FMA(F(m.m[2][1]), v.y, F(m.m[2][2]) * v.z)));
+    }
+}
@@ -0,0 +1,275 @@
+#include <algorithm>
+#include <atomic>
+#include <cmath>
+#include <utility>
+#include <vector>
+
+#include <core/wavefront.hpp>
+#include <core/materials.hpp>
+#include <utils/parallel.hpp>
+
+namespace reina
+{
+    namespace
+    {
+        // rays pushed by many threads at once; the slot comes from an atomic counter, so the order
+        // within a queue depends on the schedule but the per-path results do not
+        struct RayQueue
+        {
+            // the offset rays of a camera ray
+            struct Differentials
+            {
+                bool valid;
+                Point3f rxOrigin, ryOrigin;
+                Vector3f rxDirection, ryDirection;
+            };
+
+            // withDifferentials keeps the offset rays of what is pushed, for the camera rays
+            void Reset(int capacity, bool withDifferentials = false)
+            {
+                rays.Resize(capacity);
+                pathIndex.resize(capacity);
+                differentials.resize(withDifferentials ? capacity : 0);
+                size = 0;
+            }
+            int Push(const Ray &ray, int path)
+            {
+                int slot = size.fetch_add(1, std::memory_order_relaxed);
+                rays.Set(slot, ray);
+                pathIndex[slot] = path;
+                if (!differentials.empty())
+                    differentials[slot].valid = false;
+                return slot;
+            }
+            int Push(const RayDifferential &ray, int path)
+            {
+                int slot = Push((const Ray &)ray, path);
+                if (!differentials.empty())
+                    differentials[slot] = {ray.hasDifferentials, ray.rxOrigin, ray.ryOrigin, ray.rxDirection,
+                                           ray.ryDirection};
+                return slot;
+            }
+            RayDifferential Get(int64_t slot) const
+            {
+                RayDifferential ray(rays.Get(slot));
+                if (!differentials.empty() && differentials[slot].valid)
+                {
+                    const Differentials &d = differentials[slot];
+                    ray.hasDifferentials = true;
+                    ray.rxOrigin = d.rxOrigin;
+                    ray.ryOrigin = d.ryOrigin;
+                    ray.rxDirection = d.rxDirection;
+                    ray.ryDirection = d.ryDirection;
+                }
+                return ray;
+            }
+            // trims the stream to the pushed rays, for IntersectStream()
+            void Close() { rays.Resize(size.load()); }
+
+            RayStream rays;
+            std::vector<int32_t> pathIndex;
+            // per slot, or empty when the rays have none
+            std::vector<Differentials> differentials;
+            std::atomic<int> size{0};
+        };
+
+        struct ShadowQueue : RayQueue
+        {
+            void Reset(int capacity)
+            {
+                RayQueue::Reset(capacity);
+                contribution.resize(capacity);
+            }
+            void Push(const Ray &ray, int path, const Spectrum &Ld) { contribution[RayQueue::Push(ray, path)] = Ld; }
+
+            // beta * unoccluded direct light, added to the path if the ray gets through
+            std::vector<Spectrum> contribution;
+        };
+
+        // SoA state of the paths in flight, indexed by path within the batch
+        struct PathStates
+        {
+            void Resize(int n)
+            {
+                beta.resize(n);
+                L.resize(n);
+                rayWeight.resize(n);
+            }
+            std::vector<Spectrum> beta, L;
+            std::vector<Float> rayWeight;
+        };
+    }
+
+    // WavefrontPathIntegrator Method Definitions
+    void WavefrontPathIntegrator::Render(const Scene &scene)
+    {
+        Film &film = *camera->film;
+        const int64_t nPixels = film.GetPixelBounds().Area();
+        const int spp = sampler->SamplesPerPixel();
+        // without a time budget this is a single pass over all samples
+        PassScheduler scheduler(timeBudget, spp, spp);
+        for (int sampleBegin = 0, passSamples; (passSamples = scheduler.NextPass(nPixels)) > 0;
+             sampleBegin += passSamples)
+        {
+            const int64_t nPaths = nPixels * passSamples;
+            int64_t first = 0;
+            // batches left at the deadline are dropped; their pixels keep the samples they have
+            for (; first < nPaths && !scheduler.Expired(); first += batchSize)
+                renderBatch(scene, sampleBegin, passSamples, first,
+                            (int)std::min<int64_t>(batchSize, nPaths - first));
+            scheduler.EndPass(std::min(first, nPaths));
+        }
+        film.WriteImage();
+    }
+
+    void WavefrontPathIntegrator::renderBatch(const Scene &scene, int sampleBegin, int passSamples,
+                                              int64_t firstPath, int nPaths)
+    {
+        Film &film = *camera->film;
+        const Bounds2i pixelBounds = film.GetPixelBounds();
+        const int width = pixelBounds.pMax.x - pixelBounds.pMin.x;
+        auto pixelOf = [&](int64_t pixelIndex)
+        { return Point2i(pixelBounds.pMin.x + (int)(pixelIndex % width), pixelBounds.pMin.y + (int)(pixelIndex / width)); };
+        // every stage starts the pixel sample anew at a fixed dimension, so any clone of the sampler
+        // continues a path exactly where the previous stage left it
+        auto startPath = [&](Sampler &s, int path, int dimension)
+        {
+            int64_t globalPath = firstPath + path;
+            s.StartPixelSample(pixelOf(globalPath / passSamples), sampleBegin + (int)(globalPath % passSamples),
+                               dimension);
+        };
+        const int64_t chunkSize = 1024;
+
+        PathStates paths;
+        paths.Resize(nPaths);
+        RayQueue rayQueue, nextQueue;
+        ShadowQueue shadowQueue;
+        HitStream hits;
+
+        // generate camera rays, with differentials as SamplerIntegrator makes them
+        const Float differentialScale = 1 / std::sqrt((Float)sampler->SamplesPerPixel());
+        rayQueue.Reset(nPaths, true);
+        ParallelFor(nPaths, chunkSize, [&](int64_t begin, int64_t end)
+                    {
+            SamplerBuffer chunkSamplerBuffer;
+            Sampler &chunkSampler = chunkSamplerBuffer.Clone(*sampler, sampler->Seed());
+            for (int path = (int)begin; path < (int)end; ++path)
+            {
+                startPath(chunkSampler, path, 0);
+                Point2i pixel = pixelOf((firstPath + path) / passSamples);
+                CameraSample cameraSample;
+                cameraSample.pFilm = Point2f((Float)pixel.x, (Float)pixel.y) + Vector2f(chunkSampler.GetPixel2D());
+                cameraSample.time = chunkSampler.Get1D();
+                cameraSample.pLens = chunkSampler.Get2D();
+                RayDifferential ray;
+                paths.rayWeight[path] = camera->GenerateRayDifferential(cameraSample, &ray);
+                ray.ScaleDifferentials(differentialScale);
+                paths.beta[path] = Spectrum(1);
+                paths.L[path] = Spectrum(0);
+                if (paths.rayWeight[path] > 0)
+                    rayQueue.Push(ray, path);
+            } });
+        rayQueue.Close();
+
+        for (int depth = 0; rayQueue.size > 0; ++depth)
+        {
+            // intersect
+            scene.IntersectStream(rayQueue.rays, &hits);
+
+            // shade: emission, then queue a shadow ray and the continuation ray of each path
+            nextQueue.Reset(rayQueue.size);
+            shadowQueue.Reset(rayQueue.size);
+            ParallelFor(rayQueue.size, chunkSize, [&](int64_t begin, int64_t end)
+                        {
+                SamplerBuffer chunkSamplerBuffer;
+                Sampler &chunkSampler = chunkSamplerBuffer.Clone(*sampler, sampler->Seed());
+                thread_local MemoryArena arena;
+                for (int64_t i = begin; i < end; ++i)
+                {
+                    // a BSDF is done with once its path is shaded
+                    arena.Reset();
+                    int path = rayQueue.pathIndex[i];
+                    RayDifferential ray = rayQueue.Get(i);
+                    Spectrum &beta = paths.beta[path];
+                    if (!hits.Hit(i))
+                    {
+                        if (depth == 0)
+                            for (const auto &light : scene.infiniteLights)
+                                paths.L[path] += beta * light->Le(ray);
+                        continue;
+                    }
+                    SurfaceInteraction isect(Point3f(hits.px[i], hits.py[i], hits.pz[i]), Point2f(hits.u[i], hits.v[i]),
+                                             -ray.d, Normal3f(hits.nx[i], hits.ny[i], hits.nz[i]), ray.time);
+                    isect.shadingN = Normal3f(hits.snx[i], hits.sny[i], hits.snz[i]);
+                    isect.dpdu = Vector3f(hits.dpdux[i], hits.dpduy[i], hits.dpduz[i]);
+                    isect.dpdv = Vector3f(hits.dpdvx[i], hits.dpdvy[i], hits.dpdvz[i]);
+                    isect.primitive = hits.primitive[i];
+                    if (depth == 0)
+                        if (const AreaLight *area = isect.primitive->GetAreaLight())
+                            paths.L[path] += beta * area->L(isect, -ray.d);
+                    const Material *material = isect.primitive->GetMaterial();
+                    if (depth >= maxDepth || !material)
+                        continue;
+                    isect.ComputeDifferentials(ray, camera.get(), sampler->SamplesPerPixel());
+                    material->ComputeScatteringFunctions(&isect, arena);
+
+                    startPath(chunkSampler, path, CameraSampleDimensions + depth * PathVertexDimensions);
+                    // same layout as PathIntegrator: light and lobe choice, light position, BSDF direction
+                    Point2f u[3];
+                    chunkSampler.Get2D(u, 3);
+                    Ray shadowRay;
+                    Spectrum Ld = SampleOneLight(isect, scene, u[0].x, u[1], &shadowRay);
+                    if (!Ld.IsBlack())
+                        shadowQueue.Push(shadowRay, path, beta * Ld);
+
+                    Vector3f wi;
+                    Float pdf;
+                    Spectrum f = isect.bsdf->Sample_f(isect.wo, &wi, u[0].y, u[2], &pdf);
+                    if (f.IsBlack() || pdf == 0)
+                        continue;
+                    beta *= f * (std::abs(wi.Dot(isect.shadingN)) / pdf);
+                    Float uRoulette = chunkSampler.Get1D();
+                    if (depth >= 3)
+                    {
+                        Float q = std::max((Float)0.05, 1 - beta.MaxComponentValue());
+                        if (uRoulette < q)
+                            continue;
+                        beta /= 1 - q;
+                    }
+                    nextQueue.Push(isect.SpawnRay(wi), path);
+                } });
+            shadowQueue.Close();
+            nextQueue.Close();
+
+            // shadow rays; a path queues at most one per bounce, so the adds below never collide
+            ParallelFor(shadowQueue.size, chunkSize, [&](int64_t begin, int64_t end)
+                        {
+                for (int64_t i = begin; i < end; ++i)
+                    if (!scene.IntersectP(shadowQueue.rays.Get(i)))
+                        paths.L[shadowQueue.pathIndex[i]] += shadowQueue.contribution[i]; });
+            std::swap(rayQueue.rays, nextQueue.rays);
+            std::swap(rayQueue.pathIndex, nextQueue.pathIndex);
+            std::swap(rayQueue.differentials, nextQueue.differentials);
+            rayQueue.size = nextQueue.size.load();
+        }
+
+        // accumulate: one task per run of pixels, so no two tasks touch the same film pixel
+        const int64_t firstPixel = firstPath / passSamples, lastPixel = (firstPath + nPaths - 1) / passSamples;
+        ParallelFor(lastPixel - firstPixel + 1, chunkSize / passSamples + 1, [&](int64_t begin, int64_t end)
+                    {
+            for (int64_t pixelIndex = firstPixel + begin; pixelIndex < firstPixel + end; ++pixelIndex)
+            {
+                int64_t p0 = std::max(pixelIndex * passSamples, firstPath);
+                int64_t p1 = std::min((pixelIndex + 1) * passSamples, firstPath + nPaths);
+                for (int64_t globalPath = p0; globalPath < p1; ++globalPath)
+                {
+                    int path = (int)(globalPath - firstPath);
+                    Spectrum L = paths.L[path];
+                    // a NaN or infinite sample would poison the whole pixel
+                    if (L.HasNaNs() || std::isinf(L.y()))
+                        L = Spectrum(0);
+                    film.AddSample(pixelOf(pixelIndex), L, paths.rayWeight[path]);
+                }
+            } });
+    }
+}
@@ -0,0 +1,39 @@
+#pragma once
+/***
+ *  WavefrontPathIntegrator
+ *  path tracer that advances a batch of paths one bounce at a time through SoA ray queues
+ */
+#include <cstdint>
+#include <memory>
+
+#include <core/intergrator.hpp>
+
+namespace reina
+{
+    // same estimator as PathIntegrator, but split into stages that each run over the whole batch:
+    // generate camera rays, intersect them as one sorted stream, shade the hits (queueing shadow
+    // and continuation rays), trace the shadow rays, and finally accumulate the paths into the film
+    class WavefrontPathIntegrator : public Integrator
+    {
+    public:
+        // WavefrontPathIntegrator Public Methods
+        // batchSize bounds the number of paths in flight, and so the size of every queue
+        WavefrontPathIntegrator(std::shared_ptr<const Camera> camera, std::shared_ptr<Sampler> sampler,
+                                int maxDepth = 5, int batchSize = 1 << 18)
+            : camera(camera), sampler(sampler), maxDepth(maxDepth), batchSize(batchSize) {}
+        void Render(const Scene &scene) override;
+
+    private:
+        // WavefrontPathIntegrator Private Methods
+        // paths [firstPath, firstPath + nPaths) of the pass over samples [sampleBegin,
+        // sampleBegin + passSamples), path i being sample sampleBegin + i % passSamples of pixel
+        // i / passSamples
+        void renderBatch(const Scene &scene, int sampleBegin, int passSamples, int64_t firstPath, int nPaths);
+
+        // WavefrontPathIntegrator Private Data
+        std::shared_ptr<const Camera> camera;
+        std::shared_ptr<Sampler> sampler;
+        const int maxDepth;
+        const int batchSize;
+    };
+}
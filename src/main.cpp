@@ -1,4 +1,5 @@
 #include <iostream>
+#include <stdexcept>
 
 #include <imgui.h>
 #include <imgui_impl_sdl2.h>
@@ -17,6 +18,8 @@
 #endif
 
 #include <utils/vecmath.hpp>
+#include <utils/config.hpp>
+#include <utils/parallel.hpp>
 #include <core/ray.hpp>
 int TmpMain()
 {
@@ -200,6 +203,29 @@ int main(int argc, char **argv)
 {
     // TmpMain();
     using namespace reina;
+    util::Config config(argc, argv);
+    try
+    {
+        config.Parse();
+    }
+    catch (const std::invalid_argument &e)
+    {
+        std::cerr << e.what() << std::endl;
+        config.PrintUsage();
+        return 1;
+    }
+    if (config.HelpRequested())
+    {
+        config.PrintHelp();
+        return 0;
+    }
+    if (config.VersionRequested())
+    {
+        config.PrintVersion();
+        return 0;
+    }
+    if (config.Threads() > 0)
+        ThreadPool::SetGlobalThreadCount(config.Threads());
     Vector3i a(1, 2, 3);
     Ray ray;
     std::cout << ray << Lerp(1.1, 1.0, 1.4) << std::endl;
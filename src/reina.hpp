@@ -41,6 +41,10 @@ namespace reina
 
     class Quaternion;
 
+    // transform
+    struct Matrix4x4;
+    class Transform;
+
     using Normal3f = Normal3<Float>;
     using Normal3i = Normal3<int>;
     using Bounds2f = Bounds2<Float>;
@@ -55,4 +59,34 @@ namespace reina
     // medium
     class Medium;
 
+    // interaction
+    class Interaction;
+    class SurfaceInteraction;
+
+    // shapes
+    class Shape;
+    class TriangleMesh;
+    class Triangle;
+
+    // primitive
+    class Primitive;
+    class GeometricPrimitive;
+    class Instance;
+    class Aggregate;
+    class BVHAccel;
+
+    // rendering
+    class RGBSpectrum;
+    using Spectrum = RGBSpectrum;
+    class Film;
+    class FilmTile;
+    class Camera;
+    class Sampler;
+    class Light;
+    class AreaLight;
+    class Material;
+    class BSDF;
+    class Scene;
+    class Integrator;
+
 }
\ No newline at end of file
@@ -0,0 +1,81 @@
+#pragma once
+/***
+ *  Buffer: contiguous array that either owns its elements or views memory owned elsewhere
+ *  (typically a MappedFile); mutating the size of a view copies it into owned storage first
+ */
+#include <algorithm>
+#include <cstddef>
+#include <memory>
+#include <utility>
+#include <vector>
+namespace reina
+{
+    template <typename T>
+    class Buffer
+    {
+    public:
+        // Buffer Public Methods
+        Buffer() = default;
+        explicit Buffer(size_t n) : storage(n) { sync(); }
+        Buffer(std::vector<T> v) : storage(std::move(v)) { sync(); }
+        // views count elements at p; owner keeps that memory alive
+        Buffer(T *p, size_t count, std::shared_ptr<const void> owner)
+            : ptr(p), count(count), owner(std::move(owner)) {}
+        Buffer(const Buffer &b) : storage(b.storage), ptr(b.ptr), count(b.count), owner(b.owner)
+        {
+            if (!owner)
+                sync();
+        }
+        // a moved std::vector keeps its allocation, so ptr stays valid
+        Buffer(Buffer &&b) noexcept
+            : storage(std::move(b.storage)), ptr(b.ptr), count(b.count), owner(std::move(b.owner))
+        {
+            b.ptr = nullptr;
+            b.count = 0;
+        }
+        Buffer &operator=(Buffer b) noexcept
+        {
+            storage.swap(b.storage);
+            std::swap(ptr, b.ptr);
+            std::swap(count, b.count);
+            owner.swap(b.owner);
+            return *this;
+        }
+
+        size_t size() const { return count; }
+        bool empty() const { return count == 0; }
+        T *data() { return ptr; }
+        const T *data() const { return ptr; }
+        T &operator[](size_t i) { return ptr[i]; }
+        const T &operator[](size_t i) const { return ptr[i]; }
+        T *begin() { return ptr; }
+        T *end() { return ptr + count; }
+        const T *begin() const { return ptr; }
+        const T *end() const { return ptr + count; }
+        void resize(size_t n)
+        {
+            if (owner)
+            {
+                storage.assign(ptr, ptr + std::min(n, count));
+                owner.reset();
+            }
+            storage.resize(n);
+            sync();
+        }
+        void clear() { resize(0); }
+        bool IsView() const { return owner != nullptr; }
+
+    private:
+        void sync()
+        {
+            ptr = storage.data();
+            count = storage.size();
+        }
+
+        // Buffer Private Data
+        std::vector<T> storage;
+        T *ptr = nullptr;
+        size_t count = 0;
+        std::shared_ptr<const void> owner;
+    };
+}
@@ -0,0 +1,108 @@
+#include <utils/config.hpp>
+#include <iostream>
+#include <stdexcept>
+
+namespace reina::util
+{
+    Config::Config(int argc, char **argv) : args(argv + (argc > 0 ? 1 : 0), argv + argc) {}
+
+    Config::~Config() = default;
+
+    void Config::Parse()
+    {
+        for (size_t i = 0; i < args.size(); ++i)
+        {
+            const std::string &arg = args[i];
+            if (arg == "-h" || arg == "--help")
+                help = true;
+            else if (arg == "-v" || arg == "--version")
+                version = true;
+            else if (arg == "--bvh")
+            {
+                if (i + 1 == args.size())
+                    throw std::invalid_argument("--bvh expects sah, lbvh or hlbvh");
+                bvhBuilder = args[++i];
+                if (bvhBuilder != "sah" && bvhBuilder != "lbvh" && bvhBuilder != "hlbvh")
+                    throw std::invalid_argument("unknown BVH builder \"" + bvhBuilder + "\"");
+            }
+            else if (arg == "--light-sampler")
+            {
+                if (i + 1 == args.size())
+                    throw std::invalid_argument("--light-sampler expects bvh, power or uniform");
+                lightSampler = args[++i];
+                if (lightSampler != "bvh" && lightSampler != "power" && lightSampler != "uniform")
+                    throw std::invalid_argument("unknown light sampler \"" + lightSampler + "\"");
+            }
+            else if (arg == "--sampler")
+            {
+                if (i + 1 == args.size())
+                    throw std::invalid_argument("--sampler expects zsobol or independent");
+                pixelSampler = args[++i];
+                if (pixelSampler != "zsobol" && pixelSampler != "independent")
+                    throw std::invalid_argument("unknown sampler \"" + pixelSampler + "\"");
+            }
+            else if (arg == "--threads")
+            {
+                if (i + 1 == args.size())
+                    throw std::invalid_argument("--threads expects a count");
+                try
+                {
+                    threads = std::stoi(args[++i]);
+                }
+                catch (const std::exception &)
+                {
+                    threads = -1;
+                }
+                if (threads < 0)
+                    throw std::invalid_argument("invalid thread count \"" + args[i] + "\"");
+            }
+            else if (arg == "--time-budget")
+            {
+                if (i + 1 == args.size())
+                    throw std::invalid_argument("--time-budget expects seconds");
+                try
+                {
+                    timeBudget = std::stod(args[++i]);
+                }
+                catch (const std::exception &)
+                {
+                    timeBudget = -1;
+                }
+                if (!(timeBudget >= 0))
+                    throw std::invalid_argument("invalid time budget \"" + args[i] + "\"");
+            }
+            else
+                throw std::invalid_argument("unknown option \"" + arg + "\"");
+        }
+    }
+
+    void Config::PrintHelp()
+    {
+        PrintUsage();
+        std::cout << "Options:\n"
+                  << "  -h, --help            print this message\n"
+                  << "  -v, --version         print the version\n"
+                  << "  --bvh <builder>       sah (best traversal), lbvh (fastest build)\n"
+                  << "                        or hlbvh (Morton treelets, SAH top levels)\n"
+                  << "  --light-sampler <s>   bvh (power, distance and orientation), power\n"
+                  << "                        or uniform\n"
+                  << "  --sampler <s>         zsobol (scrambled Sobol' in Z order, samples per\n"
+                  << "                        pixel rounded up to a power of two) or independent\n"
+                  << "  --threads <n>         render threads, 0 for one per core\n"
+                  << "  --time-budget <s>     finish the render within s seconds of wall-clock\n"
+                  << "                        time, 0 for no limit\n";
+    }
+
+    void Config::PrintVersion() { std::cout << "ReinaRender 0.1" << std::endl; }
+
+    void Config::PrintUsage() { std::cout << "Usage: reina [options]" << std::endl; }
+
+    void Config::PrintConfig()
+    {
+        std::cout << "bvh builder: " << bvhBuilder << std::endl;
+        std::cout << "light sampler: " << lightSampler << std::endl;
+        std::cout << "sampler: " << pixelSampler << std::endl;
+        std::cout << "threads: " << (threads > 0 ? std::to_string(threads) : "one per core") << std::endl;
+        std::cout << "time budget: " << (timeBudget > 0 ? std::to_string(timeBudget) + "s" : "none") << std::endl;
+    }
+}
@@ -1,4 +1,6 @@
 #pragma once
+#include <string>
+#include <vector>
 
 namespace reina::util
 {
@@ -7,12 +9,33 @@ namespace reina::util
     public:
         Config(int argc, char **argv);
         ~Config();
+        // throws std::invalid_argument on an unknown option or value
         void Parse();
         void PrintHelp();
         void PrintVersion();
         void PrintUsage();
         void PrintConfig();
 
+        bool HelpRequested() const { return help; }
+        bool VersionRequested() const { return version; }
+        // BVH builder: "sah" (default), "lbvh" or "hlbvh", see ParseSplitMethod()
+        const std::string &BVHBuilder() const { return bvhBuilder; }
+        // light selection: "bvh" (default), "power" or "uniform", see ParseLightSampling()
+        const std::string &LightSampler() const { return lightSampler; }
+        // pixel sampler: "zsobol" (default) or "independent", see CreateSampler()
+        const std::string &PixelSampler() const { return pixelSampler; }
+        // render threads including the main one, 0 for one per core
+        int Threads() const { return threads; }
+        // wall-clock render budget in seconds, 0 for none, see Integrator::SetTimeBudget()
+        double TimeBudget() const { return timeBudget; }
+
     private:
+        std::vector<std::string> args;
+        bool help = false, version = false;
+        std::string bvhBuilder = "sah";
+        std::string lightSampler = "bvh";
+        std::string pixelSampler = "zsobol";
+        int threads = 0;
+        double timeBudget = 0;
     };
-}
\ No newline at end of file
+}
@@ -7,11 +7,17 @@
 #include <string>
 
 #include <reina.hpp>
+#if defined(__F16C__)
+#include <immintrin.h>
+#endif
 
 namespace reina
 {
     static constexpr Float Infinity = std::numeric_limits<Float>::infinity();
 
+    // relative offset of spawned ray origins off the surface
+    static constexpr Float ShadowEpsilon = 0.0001f;
+
     static constexpr Float MachineEpsilon = std::numeric_limits<Float>::epsilon() * 0.5;
 
     static constexpr double DoubleOneMinusEpsilon = 0x1.fffffffffffffp-1;
@@ -21,4 +27,58 @@ namespace reina
 #else
     static constexpr float OneMinusEpsilon = FloatOneMinusEpsilon;
 #endif
-}
\ No newline at end of file
+
+    // conservative bound on the relative error of n chained floating-point operations
+    inline constexpr Float gamma(int n)
+    {
+        return (n * MachineEpsilon) / (1 - n * MachineEpsilon);
+    }
+
+    // IEEE half precision: round to nearest even, past 65504 to infinity; NaNs stay NaNs
+    inline uint16_t FloatToHalf(float f)
+    {
+#if defined(__F16C__)
+        return (uint16_t)_cvtss_sh(f, _MM_FROUND_TO_NEAREST_INT);
+#else
+        uint32_t x;
+        std::memcpy(&x, &f, sizeof(x));
+        uint16_t sign = (x >> 16) & 0x8000;
+        x &= 0x7fffffff;
+        if (x > 0x7f800000)
+            return sign | 0x7e00;
+        // 65520 is halfway to the next power of two, which is infinity
+        if (x >= 0x477ff000)
+            return sign | 0x7c00;
+        // below 2^-14 the result is denormal, in steps of 2^-24
+        if (x < 0x38800000)
+            return sign | (uint16_t)std::nearbyint(std::abs(f) * 0x1p24f);
+        // rebias the exponent and drop 13 mantissa bits, rounding ties to even
+        x -= (127 - 15) << 23;
+        x += 0xfff + ((x >> 13) & 1);
+        return sign | (uint16_t)(x >> 13);
+#endif
+    }
+
+    inline float HalfToFloat(uint16_t h)
+    {
+#if defined(__F16C__)
+        return _cvtsh_ss(h);
+#else
+        uint32_t sign = (uint32_t)(h & 0x8000) << 16;
+        uint32_t exponent = (h >> 10) & 0x1f, mantissa = h & 0x3ff;
+        uint32_t x;
+        if (exponent == 0x1f)
+            x = sign | 0x7f800000 | (mantissa << 13);
+        else if (exponent == 0)
+        {
+            float f = mantissa * 0x1p-24f;
+            return sign ? -f : f;
+        }
+        else
+            x = sign | ((exponent + 127 - 15) << 23) | (mantissa << 13);
+        float f;
+        std::memcpy(&f, &x, sizeof(f));
+        return f;
+#endif
+    }
+}
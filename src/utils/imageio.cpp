@@ -0,0 +1,111 @@
+#include <utils/imageio.hpp>
+#include <utils/math.hpp>
+#include <cctype>
+#include <cmath>
+#include <cstdint>
+#include <fstream>
+#include <utility>
+#include <vector>
+namespace reina
+{
+    namespace
+    {
+        bool HasExtension(const std::string &filename, const std::string &ext)
+        {
+            if (filename.size() < ext.size())
+                return false;
+            for (size_t i = 0; i < ext.size(); ++i)
+                if (std::tolower(filename[filename.size() - ext.size() + i]) != ext[i])
+                    return false;
+            return true;
+        }
+
+        uint8_t ToSRGB8(Float v)
+        {
+            v = Clamp(v, 0, 1);
+            v = v <= 0.0031308f ? 12.92f * v : 1.055f * std::pow(v, (Float)(1 / 2.4)) - 0.055f;
+            return (uint8_t)Clamp(v * 255 + 0.5f, 0, 255);
+        }
+
+        bool WritePFM(const std::string &filename, const Float *rgb, int width, int height)
+        {
+            std::ofstream out(filename, std::ios::binary);
+            if (!out)
+                return false;
+            // negative scale: little endian
+            out << "PF\n"
+                << width << " " << height << "\n-1\n";
+            // PFM stores the bottom row first
+            std::vector<float> row(3 * width);
+            for (int y = height - 1; y >= 0; --y)
+            {
+                for (int i = 0; i < 3 * width; ++i)
+                    row[i] = (float)rgb[3 * width * y + i];
+                out.write((const char *)row.data(), row.size() * sizeof(float));
+            }
+            return (bool)out;
+        }
+
+        bool ReadPFM(const std::string &filename, std::vector<Float> *rgb, int *width, int *height)
+        {
+            std::ifstream in(filename, std::ios::binary);
+            std::string magic;
+            int w, h;
+            float scale;
+            if (!(in >> magic >> w >> h >> scale) || (magic != "PF" && magic != "Pf") || w <= 0 || h <= 0)
+                return false;
+            // exactly one whitespace character separates the header from the data
+            in.get();
+            const int nChannels = magic == "PF" ? 3 : 1;
+            std::vector<float> data((size_t)nChannels * w * h);
+            if (!in.read((char *)data.data(), data.size() * sizeof(float)))
+                return false;
+            // negative scale: little endian
+            const uint16_t one = 1;
+            const bool hostLittleEndian = *(const uint8_t *)&one == 1;
+            if ((scale < 0) != hostLittleEndian)
+                for (float &v : data)
+                {
+                    uint8_t *b = (uint8_t *)&v;
+                    std::swap(b[0], b[3]);
+                    std::swap(b[1], b[2]);
+                }
+            // PFM stores the bottom row first
+            rgb->resize((size_t)3 * w * h);
+            for (int y = 0; y < h; ++y)
+                for (int x = 0; x < w; ++x)
+                    for (int c = 0; c < 3; ++c)
+                        (*rgb)[3 * ((size_t)y * w + x) + c] =
+                            data[nChannels * ((size_t)(h - 1 - y) * w + x) + (nChannels == 3 ? c : 0)];
+            *width = w;
+            *height = h;
+            return true;
+        }
+
+        bool WritePPM(const std::string &filename, const Float *rgb, int width, int height)
+        {
+            std::ofstream out(filename, std::ios::binary);
+            if (!out)
+                return false;
+            out << "P6\n"
+                << width << " " << height << "\n255\n";
+            std::vector<uint8_t> pixels(3 * width * height);
+            for (size_t i = 0; i < pixels.size(); ++i)
+                pixels[i] = ToSRGB8(rgb[i]);
+            out.write((const char *)pixels.data(), pixels.size());
+            return (bool)out;
+        }
+    }
+
+    bool WriteImage(const std::string &filename, const Float *rgb, int width, int height)
+    {
+        if (HasExtension(filename, ".pfm"))
+            return WritePFM(filename, rgb, width, height);
+        return WritePPM(filename, rgb, width, height);
+    }
+
+    bool ReadImage(const std::string &filename, std::vector<Float> *rgb, int *width, int *height)
+    {
+        return HasExtension(filename, ".pfm") && ReadPFM(filename, rgb, width, height);
+    }
+}
@@ -0,0 +1,16 @@
+#pragma once
+/***
+ *  Image I/O: PFM (linear float) and PPM (8-bit sRGB); PFM can be read back
+ */
+#include <string>
+#include <vector>
+#include <reina.hpp>
+namespace reina
+{
+    // rgb holds width * height RGB triples, top row first; the format follows the
+    // extension: .pfm is written as float, anything else as binary PPM
+    bool WriteImage(const std::string &filename, const Float *rgb, int width, int height);
+    // reads a PFM (color or grayscale, either byte order) into width * height RGB triples, top row
+    // first; false if the file is missing or not a PFM
+    bool ReadImage(const std::string &filename, std::vector<Float> *rgb, int *width, int *height);
+}
@@ -0,0 +1,61 @@
+#include <utils/mappedfile.hpp>
+#ifdef _WIN32
+#define NOMINMAX
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+namespace reina
+{
+    std::shared_ptr<MappedFile> MappedFile::Open(const std::string &filename)
+    {
+#ifdef _WIN32
+        HANDLE file = CreateFileA(filename.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING,
+                                  FILE_ATTRIBUTE_NORMAL, nullptr);
+        if (file == INVALID_HANDLE_VALUE)
+            return nullptr;
+        LARGE_INTEGER fileSize;
+        if (!GetFileSizeEx(file, &fileSize) || fileSize.QuadPart == 0)
+        {
+            CloseHandle(file);
+            return nullptr;
+        }
+        HANDLE mapping = CreateFileMappingA(file, nullptr, PAGE_WRITECOPY, 0, 0, nullptr);
+        CloseHandle(file);
+        if (!mapping)
+            return nullptr;
+        void *p = MapViewOfFile(mapping, FILE_MAP_COPY, 0, 0, 0);
+        CloseHandle(mapping);
+        if (!p)
+            return nullptr;
+        return std::shared_ptr<MappedFile>(new MappedFile((uint8_t *)p, (size_t)fileSize.QuadPart));
+#else
+        int fd = open(filename.c_str(), O_RDONLY);
+        if (fd < 0)
+            return nullptr;
+        struct stat st;
+        if (fstat(fd, &st) != 0 || st.st_size == 0)
+        {
+            close(fd);
+            return nullptr;
+        }
+        void *p = mmap(nullptr, st.st_size, PROT_READ | PROT_WRITE, MAP_PRIVATE, fd, 0);
+        close(fd);
+        if (p == MAP_FAILED)
+            return nullptr;
+        return std::shared_ptr<MappedFile>(new MappedFile((uint8_t *)p, (size_t)st.st_size));
+#endif
+    }
+
+    MappedFile::~MappedFile()
+    {
+#ifdef _WIN32
+        UnmapViewOfFile(data);
+#else
+        munmap(data, size);
+#endif
+    }
+}
@@ -0,0 +1,30 @@
+#pragma once
+/***
+ *  MappedFile: a whole file mapped copy-on-write into memory
+ */
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <string>
+namespace reina
+{
+    class MappedFile
+    {
+    public:
+        // nullptr if the file does not exist or cannot be mapped; pages are private, so writes
+        // through the mapping never reach the file
+        static std::shared_ptr<MappedFile> Open(const std::string &filename);
+        ~MappedFile();
+        MappedFile(const MappedFile &) = delete;
+        MappedFile &operator=(const MappedFile &) = delete;
+        uint8_t *Data() const { return data; }
+        size_t Size() const { return size; }
+
+    private:
+        MappedFile(uint8_t *data, size_t size) : data(data), size(size) {}
+
+        // MappedFile Private Data
+        uint8_t *data;
+        size_t size;
+    };
+}
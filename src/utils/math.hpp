@@ -7,11 +7,171 @@
 #include <string>
 
 #include <reina.hpp>
+#include <utils/float.hpp>
+#if defined(_MSC_VER)
+#include <intrin.h>
+#endif
 
 namespace reina
 {
+    static constexpr Float Pi = 3.14159265358979323846;
+    static constexpr Float InvPi = 0.31830988618379067154;
+    static constexpr Float Inv2Pi = 0.15915494309189533577;
+    static constexpr Float Inv4Pi = 0.07957747154594766788;
+
+    inline Float Radians(Float deg)
+    {
+        return (Pi / 180) * deg;
+    }
+
+    template <typename T, typename U, typename V>
+    inline T Clamp(T val, U low, V high)
+    {
+        if (val < low)
+            return low;
+        else if (val > high)
+            return high;
+        else
+            return val;
+    }
+
     inline Float Lerp(Float t, Float v1, Float v2)
     {
         return (1 - t) * v1 + t * v2;
     }
+
+    // clamped against arguments pushed just out of range by rounding
+    inline Float SafeSqrt(Float x) { return std::sqrt(std::max((Float)0, x)); }
+    inline Float SafeASin(Float x) { return std::asin(Clamp(x, -1, 1)); }
+    inline Float SafeACos(Float x) { return std::acos(Clamp(x, -1, 1)); }
+
+    // index of the lowest set bit, v must be non-zero
+    inline int CountTrailingZeros(uint32_t v)
+    {
+#if defined(_MSC_VER)
+        unsigned long index;
+        _BitScanForward(&index, v);
+        return (int)index;
+#else
+        return __builtin_ctz(v);
+#endif
+    }
+
+    // floor(log2(v)), v > 0
+    inline int Log2Int(uint32_t v)
+    {
+#if defined(_MSC_VER)
+        unsigned long index;
+        _BitScanReverse(&index, v);
+        return (int)index;
+#else
+        return 31 - __builtin_clz(v);
+#endif
+    }
+
+    inline int32_t RoundUpPow2(int32_t v)
+    {
+        v--;
+        v |= v >> 1;
+        v |= v >> 2;
+        v |= v >> 4;
+        v |= v >> 8;
+        v |= v >> 16;
+        return v + 1;
+    }
+
+    inline uint32_t ReverseBits32(uint32_t n)
+    {
+        n = (n << 16) | (n >> 16);
+        n = ((n & 0x00ff00ff) << 8) | ((n & 0xff00ff00) >> 8);
+        n = ((n & 0x0f0f0f0f) << 4) | ((n & 0xf0f0f0f0) >> 4);
+        n = ((n & 0x33333333) << 2) | ((n & 0xcccccccc) >> 2);
+        n = ((n & 0x55555555) << 1) | ((n & 0xaaaaaaaa) >> 1);
+        return n;
+    }
+
+    // spreads the 32 bits of x so that a zero bit separates each bit
+    inline uint64_t LeftShift2(uint64_t x)
+    {
+        x &= 0xffffffff;
+        x = (x ^ (x << 16)) & 0x0000ffff0000ffffull;
+        x = (x ^ (x << 8)) & 0x00ff00ff00ff00ffull;
+        x = (x ^ (x << 4)) & 0x0f0f0f0f0f0f0f0full;
+        x = (x ^ (x << 2)) & 0x3333333333333333ull;
+        x = (x ^ (x << 1)) & 0x5555555555555555ull;
+        return x;
+    }
+
+    // 64-bit Morton code of two 32-bit coordinates, x in the low bit
+    inline uint64_t EncodeMorton2(uint32_t x, uint32_t y) { return (LeftShift2(y) << 1) | LeftShift2(x); }
+
+    // spreads the low 10 bits of x so that two zero bits separate each bit
+    inline uint32_t LeftShift3(uint32_t x)
+    {
+        if (x == (1 << 10))
+            --x;
+        x = (x | (x << 16)) & 0b00000011000000000000000011111111;
+        x = (x | (x << 8)) & 0b00000011000000001111000000001111;
+        x = (x | (x << 4)) & 0b00000011000011000011000011000011;
+        x = (x | (x << 2)) & 0b00001001001001001001001001001001;
+        return x;
+    }
+
+    // 30-bit Morton code of three 10-bit coordinates
+    inline uint32_t EncodeMorton3(uint32_t x, uint32_t y, uint32_t z)
+    {
+        return (LeftShift3(z) << 2) | (LeftShift3(y) << 1) | LeftShift3(x);
+    }
+
+    // spreads the low 21 bits of x so that two zero bits separate each bit
+    inline uint64_t LeftShift3x21(uint64_t x)
+    {
+        x &= 0x1fffff;
+        x = (x | (x << 32)) & 0x001f00000000ffffull;
+        x = (x | (x << 16)) & 0x001f0000ff0000ffull;
+        x = (x | (x << 8)) & 0x100f00f00f00f00full;
+        x = (x | (x << 4)) & 0x10c30c30c30c30c3ull;
+        x = (x | (x << 2)) & 0x1249249249249249ull;
+        return x;
+    }
+
+    // 63-bit Morton code of three 21-bit coordinates
+    inline uint64_t EncodeMorton3x21(uint32_t x, uint32_t y, uint32_t z)
+    {
+        return (LeftShift3x21(z) << 2) | (LeftShift3x21(y) << 1) | LeftShift3x21(x);
+    }
+
+    // 64-bit finalizer (splitmix64), for seeding per-pixel streams
+    inline uint64_t MixBits(uint64_t v)
+    {
+        v ^= (v >> 31);
+        v *= 0x7fb5d329728ea185ull;
+        v ^= (v >> 27);
+        v *= 0x81dadef4bc2dd44dull;
+        v ^= (v >> 33);
+        return v;
+    }
+
+    // running mean and variance (Welford), stable for long sample streams
+    class VarianceEstimator
+    {
+    public:
+        void Add(Float x)
+        {
+            ++n;
+            Float delta = x - mean;
+            mean += delta / n;
+            m2 += delta * (x - mean);
+        }
+        int Count() const { return n; }
+        Float Mean() const { return mean; }
+        // unbiased sample variance
+        Float Variance() const { return n > 1 ? m2 / (n - 1) : 0; }
+        // standard error of the mean
+        Float MeanError() const { return n > 1 ? std::sqrt(Variance() / n) : Infinity; }
+
+    private:
+        int n = 0;
+        Float mean = 0, m2 = 0;
+    };
 }
@@ -0,0 +1,109 @@
+#pragma once
+/***
+ *  MemoryArena: bump allocator for short-lived objects, all freed at once by Reset()
+ */
+#include <algorithm>
+#include <cassert>
+#include <cstddef>
+#include <cstdint>
+#include <list>
+#include <new>
+#include <utility>
+namespace reina
+{
+    constexpr size_t CacheLineSize = 64;
+
+    // objects from the arena are never destroyed, only forgotten by Reset(): they must not own
+    // anything that needs their destructor. Meant to be owned by one thread, e.g. as a
+    // thread_local, and reset after every sample so a few blocks get reused for the whole render.
+    class alignas(CacheLineSize) MemoryArena
+    {
+    public:
+        // MemoryArena Public Methods
+        explicit MemoryArena(size_t blockSize = 256 * 1024) : blockSize(roundUp(blockSize, CacheLineSize)) {}
+        ~MemoryArena()
+        {
+            freeBlock(currentBlock);
+            for (const Block &block : usedBlocks)
+                freeBlock(block.ptr);
+            for (const Block &block : availableBlocks)
+                freeBlock(block.ptr);
+        }
+        MemoryArena(const MemoryArena &) = delete;
+        MemoryArena &operator=(const MemoryArena &) = delete;
+
+        // align may be at most CacheLineSize: blocks start on a cache line
+        void *Alloc(size_t nBytes, size_t align = alignof(std::max_align_t))
+        {
+            assert(align <= CacheLineSize && (align & (align - 1)) == 0);
+            currentPos = roundUp(currentPos, align);
+            if (currentPos + nBytes > currentBlockSize)
+            {
+                if (currentBlock)
+                    usedBlocks.push_back({currentBlock, currentBlockSize});
+                currentBlock = nullptr;
+                // first fit among the blocks freed by Reset(), else a new one
+                for (auto it = availableBlocks.begin(); it != availableBlocks.end(); ++it)
+                    if (it->size >= nBytes)
+                    {
+                        currentBlock = it->ptr;
+                        currentBlockSize = it->size;
+                        availableBlocks.erase(it);
+                        break;
+                    }
+                if (!currentBlock)
+                {
+                    currentBlockSize = std::max(blockSize, roundUp(nBytes, CacheLineSize));
+                    currentBlock = static_cast<uint8_t *>(
+                        ::operator new(currentBlockSize, std::align_val_t(CacheLineSize)));
+                }
+                currentPos = 0;
+            }
+            void *p = currentBlock + currentPos;
+            currentPos += nBytes;
+            return p;
+        }
+        template <typename T, typename... Args>
+        T *New(Args &&...args)
+        {
+            return new (Alloc(sizeof(T), alignof(T))) T(std::forward<Args>(args)...);
+        }
+        // invalidates everything allocated so far; the blocks are kept for reuse
+        void Reset()
+        {
+            currentPos = 0;
+            availableBlocks.splice(availableBlocks.begin(), usedBlocks);
+        }
+        // bytes held in blocks, in use or not
+        size_t TotalAllocated() const
+        {
+            size_t total = currentBlockSize;
+            for (const Block &block : usedBlocks)
+                total += block.size;
+            for (const Block &block : availableBlocks)
+                total += block.size;
+            return total;
+        }
+
+    private:
+        struct Block
+        {
+            uint8_t *ptr;
+            size_t size;
+        };
+
+        // MemoryArena Private Methods
+        static size_t roundUp(size_t n, size_t align) { return (n + align - 1) & ~(align - 1); }
+        static void freeBlock(uint8_t *p)
+        {
+            if (p)
+                ::operator delete(p, std::align_val_t(CacheLineSize));
+        }
+
+        // MemoryArena Private Data
+        const size_t blockSize;
+        uint8_t *currentBlock = nullptr;
+        size_t currentBlockSize = 0, currentPos = 0;
+        std::list<Block> usedBlocks, availableBlocks;
+    };
+}
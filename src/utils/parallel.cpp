@@ -0,0 +1,174 @@
+#include <utils/parallel.hpp>
+#include <algorithm>
+namespace reina
+{
+    namespace
+    {
+        thread_local const ThreadPool *currentPool = nullptr;
+        thread_local int currentWorker = -1;
+        int globalThreadCount = 0;
+    }
+
+    int NumSystemCores()
+    {
+        return std::max(1u, std::thread::hardware_concurrency());
+    }
+
+    // ThreadPool Method Definitions
+    ThreadPool::ThreadPool(int nWorkers) : queues(new WorkQueue[std::max(0, nWorkers) + 1])
+    {
+        for (int i = 0; i < nWorkers; ++i)
+            workers.emplace_back(&ThreadPool::workerLoop, this, i);
+    }
+
+    ThreadPool::~ThreadPool()
+    {
+        {
+            std::lock_guard<std::mutex> lock(sleepMutex);
+            shutdown = true;
+        }
+        wakeup.notify_all();
+        for (std::thread &t : workers)
+            t.join();
+    }
+
+    ThreadPool &ThreadPool::Global()
+    {
+        static ThreadPool pool((globalThreadCount > 0 ? globalThreadCount : NumSystemCores()) - 1);
+        return pool;
+    }
+
+    void ThreadPool::SetGlobalThreadCount(int nThreads)
+    {
+        globalThreadCount = nThreads;
+    }
+
+    int ThreadPool::queueIndex() const
+    {
+        return currentPool == this ? currentWorker : NumWorkers();
+    }
+
+    void ThreadPool::push(int queue, const Task &task)
+    {
+        {
+            std::lock_guard<std::mutex> lock(queues[queue].mutex);
+            queues[queue].tasks.push_back(task);
+        }
+        ++nQueued;
+        // a sleeper registers before checking nQueued, so it either sees the task or gets the signal
+        if (nSleeping > 0)
+        {
+            std::lock_guard<std::mutex> lock(sleepMutex);
+            wakeup.notify_one();
+        }
+    }
+
+    bool ThreadPool::popOrSteal(int queue, Task *task)
+    {
+        if (nQueued == 0)
+            return false;
+        {
+            WorkQueue &own = queues[queue];
+            std::lock_guard<std::mutex> lock(own.mutex);
+            if (!own.tasks.empty())
+            {
+                *task = own.tasks.back();
+                own.tasks.pop_back();
+                --nQueued;
+                return true;
+            }
+        }
+        int nQueues = NumWorkers() + 1;
+        for (int i = 1; i < nQueues; ++i)
+        {
+            WorkQueue &victim = queues[(queue + i) % nQueues];
+            std::unique_lock<std::mutex> lock(victim.mutex, std::try_to_lock);
+            if (lock.owns_lock() && !victim.tasks.empty())
+            {
+                *task = victim.tasks.front();
+                victim.tasks.pop_front();
+                --nQueued;
+                return true;
+            }
+        }
+        return false;
+    }
+
+    void ThreadPool::execute(int queue, Task task)
+    {
+        // keep the first index, leave the rest for this thread or a thief
+        while (task.end - task.begin > 1)
+        {
+            int64_t mid = task.begin + (task.end - task.begin) / 2;
+            push(queue, Task{task.job, mid, task.end});
+            task.end = mid;
+        }
+        (*task.job->func)(task.begin);
+        // last access to the job: the thread waiting in Run() may return right after
+        --task.job->remaining;
+    }
+
+    void ThreadPool::workerLoop(int index)
+    {
+        currentPool = this;
+        currentWorker = index;
+        while (true)
+        {
+            Task task;
+            if (popOrSteal(index, &task))
+            {
+                execute(index, task);
+                continue;
+            }
+            std::unique_lock<std::mutex> lock(sleepMutex);
+            ++nSleeping;
+            wakeup.wait(lock, [&]
+                        { return shutdown || nQueued > 0; });
+            --nSleeping;
+            if (shutdown)
+                return;
+        }
+    }
+
+    void ThreadPool::Run(int64_t count, const std::function<void(int64_t)> &func)
+    {
+        if (count <= 0)
+            return;
+        if (count == 1 || workers.empty())
+        {
+            for (int64_t i = 0; i < count; ++i)
+                func(i);
+            return;
+        }
+        Job job;
+        job.func = &func;
+        job.remaining = count;
+        int queue = queueIndex();
+        execute(queue, Task{&job, 0, count});
+        while (job.remaining > 0)
+        {
+            Task task;
+            if (popOrSteal(queue, &task))
+                execute(queue, task);
+            else
+                std::this_thread::yield();
+        }
+    }
+
+    void ParallelFor(int64_t count, int64_t chunkSize,
+                     const std::function<void(int64_t, int64_t)> &func)
+    {
+        if (count <= 0)
+            return;
+        chunkSize = std::max<int64_t>(1, chunkSize);
+        int64_t nChunks = (count + chunkSize - 1) / chunkSize;
+        ThreadPool::Global().Run(nChunks, [&](int64_t c)
+                                 { func(c * chunkSize, std::min(count, (c + 1) * chunkSize)); });
+    }
+
+    void ParallelInvoke(const std::function<void()> &a, const std::function<void()> &b)
+    {
+        ThreadPool::Global().Run(2, [&](int64_t i)
+                                 { i == 0 ? a() : b(); });
+    }
+}
@@ -0,0 +1,81 @@
+#pragma once
+/***
+ *  ThreadPool: work-stealing pool behind the parallel helpers
+ *  Parallel helpers
+ */
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+namespace reina
+{
+    int NumSystemCores();
+
+    // every worker owns a deque: it pushes and pops at the back, idle workers steal from the front.
+    // Ranges are split in halves lazily, so thieves take the largest pieces left.
+    class ThreadPool
+    {
+    public:
+        // ThreadPool Public Methods
+        explicit ThreadPool(int nWorkers);
+        ~ThreadPool();
+        ThreadPool(const ThreadPool &) = delete;
+        ThreadPool &operator=(const ThreadPool &) = delete;
+        int NumWorkers() const { return (int)workers.size(); }
+        // runs func(i) for every i in [0, count); the calling thread executes tasks while it waits,
+        // so Run() may be nested
+        void Run(int64_t count, const std::function<void(int64_t)> &func);
+
+        // shared pool sized by SetGlobalThreadCount(), or NumSystemCores() threads including the caller
+        static ThreadPool &Global();
+        // only effective before the first Global() call
+        static void SetGlobalThreadCount(int nThreads);
+
+    private:
+        struct Job
+        {
+            const std::function<void(int64_t)> *func;
+            std::atomic<int64_t> remaining;
+        };
+        struct Task
+        {
+            Job *job;
+            int64_t begin, end;
+        };
+        struct alignas(64) WorkQueue
+        {
+            std::mutex mutex;
+            std::deque<Task> tasks;
+        };
+
+        // ThreadPool Private Methods
+        int queueIndex() const;
+        void push(int queue, const Task &task);
+        bool popOrSteal(int queue, Task *task);
+        void execute(int queue, Task task);
+        void workerLoop(int index);
+
+        // ThreadPool Private Data
+        std::vector<std::thread> workers;
+        // one per worker, the last one is shared by threads from outside the pool
+        std::unique_ptr<WorkQueue[]> queues;
+        std::atomic<int64_t> nQueued{0};
+        std::atomic<int> nSleeping{0};
+        std::mutex sleepMutex;
+        std::condition_variable wakeup;
+        bool shutdown = false;
+    };
+
+    // runs func(begin, end) over [0, count) in chunks of at most chunkSize;
+    // chunk c always covers [c * chunkSize, (c + 1) * chunkSize)
+    void ParallelFor(int64_t count, int64_t chunkSize,
+                     const std::function<void(int64_t, int64_t)> &func);
+
+    // runs a and b concurrently and returns once both are done
+    void ParallelInvoke(const std::function<void()> &a, const std::function<void()> &b);
+}
@@ -0,0 +1,144 @@
+#pragma once
+/***
+ *  RNG: PCG32 (O'Neill), 64-bit state with a selectable stream
+ *  WideRNG: N interleaved lanes of one RNG stream, for filling N values per call
+ */
+#include <algorithm>
+#include <cstdint>
+#include <reina.hpp>
+#include <utils/float.hpp>
+namespace reina
+{
+    class RNG
+    {
+    public:
+        // RNG Public Methods
+        RNG() : state(0x853c49e6748fea9bULL), inc(0xda3e39cb94b95bdbULL) {}
+        RNG(uint64_t sequenceIndex, uint64_t offset = 0x853c49e6748fea9bULL) { SetSequence(sequenceIndex, offset); }
+        void SetSequence(uint64_t sequenceIndex, uint64_t offset = 0x853c49e6748fea9bULL)
+        {
+            state = 0u;
+            inc = (sequenceIndex << 1u) | 1u;
+            UniformUInt32();
+            state += offset;
+            UniformUInt32();
+        }
+        uint32_t UniformUInt32()
+        {
+            uint64_t oldState = state;
+            state = oldState * 0x5851f42d4c957f2dULL + inc;
+            uint32_t xorShifted = (uint32_t)(((oldState >> 18u) ^ oldState) >> 27u);
+            uint32_t rot = (uint32_t)(oldState >> 59u);
+            return (xorShifted >> rot) | (xorShifted << ((~rot + 1u) & 31));
+        }
+        // skips delta values in O(log delta) (Brown, "Random number generation with arbitrary strides")
+        void Advance(int64_t idelta)
+        {
+            uint64_t mult, plus;
+            jump((uint64_t)idelta, &mult, &plus);
+            state = mult * state + plus;
+        }
+        // uniform in [0, 1)
+        Float UniformFloat() { return ToFloat(UniformUInt32()); }
+        // the next n values, the same as n UniformFloat() calls; long runs go through WideRNG
+        inline void UniformFloats(Float *u, int64_t n);
+
+        static Float ToFloat(uint32_t v) { return std::min<Float>(OneMinusEpsilon, Float(v) * 0x1p-32f); }
+
+    private:
+        // RNG Private Methods
+        // the affine map state -> mult * state + plus that advances the state by delta steps
+        void jump(uint64_t delta, uint64_t *mult, uint64_t *plus) const
+        {
+            uint64_t curMult = 0x5851f42d4c957f2dULL, curPlus = inc, accMult = 1u;
+            uint64_t accPlus = 0u;
+            while (delta > 0)
+            {
+                if (delta & 1)
+                {
+                    accMult *= curMult;
+                    accPlus = accPlus * curMult + curPlus;
+                }
+                curPlus = (curMult + 1) * curPlus;
+                curMult *= curMult;
+                delta /= 2;
+            }
+            *mult = accMult;
+            *plus = accPlus;
+        }
+
+        // RNG Private Data
+        uint64_t state, inc;
+        template <int N>
+        friend class WideRNG;
+    };
+
+    // lane i steps the stream N values at a time starting from value i, so one call returns the next
+    // N values of the stream in order, exactly what N scalar calls would. The lanes share no state,
+    // so the LCG steps and output permutations vectorize (N = 8 or 16 fills a 256/512-bit register
+    // of results).
+    template <int N>
+    class WideRNG
+    {
+    public:
+        // WideRNG Public Methods
+        explicit WideRNG(const RNG &rng) { Reset(rng); }
+        void Reset(const RNG &rng)
+        {
+            inc = rng.inc;
+            uint64_t s = rng.state;
+            for (int i = 0; i < N; ++i)
+            {
+                state[i] = s;
+                s = s * 0x5851f42d4c957f2dULL + inc;
+            }
+            rng.jump(N, &multN, &incN);
+        }
+        void UniformUInt32(uint32_t out[N])
+        {
+            for (int i = 0; i < N; ++i)
+            {
+                uint64_t oldState = state[i];
+                state[i] = oldState * multN + incN;
+                uint32_t xorShifted = (uint32_t)(((oldState >> 18u) ^ oldState) >> 27u);
+                uint32_t rot = (uint32_t)(oldState >> 59u);
+                out[i] = (xorShifted >> rot) | (xorShifted << ((~rot + 1u) & 31));
+            }
+        }
+        void UniformFloat(Float out[N])
+        {
+            alignas(64) uint32_t v[N];
+            UniformUInt32(v);
+            for (int i = 0; i < N; ++i)
+                out[i] = RNG::ToFloat(v[i]);
+        }
+        // the scalar generator, positioned after the values returned so far
+        RNG Scalar() const
+        {
+            RNG rng;
+            rng.state = state[0];
+            rng.inc = inc;
+            return rng;
+        }
+
+    private:
+        // WideRNG Private Data
+        alignas(64) uint64_t state[N];
+        uint64_t multN, incN, inc;
+    };
+
+    inline void RNG::UniformFloats(Float *u, int64_t n)
+    {
+        int64_t i = 0;
+        // setting up the lanes costs about eight scalar steps
+        if (n >= 16)
+        {
+            WideRNG<8> wide(*this);
+            for (; i + 8 <= n; i += 8)
+                wide.UniformFloat(u + i);
+            *this = wide.Scalar();
+        }
+        for (; i < n; ++i)
+            u[i] = UniformFloat();
+    }
+}
@@ -0,0 +1,647 @@
+#pragma once
+/***
+ *  SimdOps: per-width backend, portable loops or SSE4.1 / AVX2 / AVX-512 intrinsics
+ *  SimdMask
+ *  SimdFloat
+ *  SimdInt
+ *  Scalar counterparts of the wide functions
+ */
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <cstring>
+#include <limits>
+#include <type_traits>
+
+#include <reina.hpp>
+
+// intrinsics need float lanes and the instruction set enabled at compile time (-msse4.1, -mavx2,
+// -mavx512f or -march=native); everything else, double lanes included, uses the portable loops
+#if !defined(REINA_FLOAT_AS_DOUBLE) && !defined(REINA_SIMD_PORTABLE)
+#if defined(__SSE4_1__)
+#define REINA_SIMD_SSE4 1
+#endif
+#if defined(__AVX2__)
+#define REINA_SIMD_AVX2 1
+#endif
+#if defined(__AVX512F__)
+#define REINA_SIMD_AVX512 1
+#endif
+#endif
+#if defined(REINA_SIMD_SSE4) || defined(REINA_SIMD_AVX2) || defined(REINA_SIMD_AVX512)
+#include <immintrin.h>
+#endif
+
+namespace reina
+{
+    // N lanes in plain arrays: compilers vectorize these loops for whatever the target has.
+    // Masks are bitsets with bit i for lane i.
+    template <int N>
+    struct SimdOps
+    {
+        static_assert(N >= 1 && N <= 32 && (N & (N - 1)) == 0, "SIMD width must be a power of two up to 32");
+
+        struct alignas(N * sizeof(Float)) FloatReg
+        {
+            Float v[N];
+        };
+        struct alignas(N * sizeof(int32_t)) IntReg
+        {
+            int32_t v[N];
+        };
+        using MaskReg = uint32_t;
+
+        template <typename F>
+        static FloatReg Map(const FloatReg &a, F f)
+        {
+            FloatReg r;
+            for (int i = 0; i < N; ++i)
+                r.v[i] = f(a.v[i]);
+            return r;
+        }
+        template <typename F>
+        static FloatReg Map(const FloatReg &a, const FloatReg &b, F f)
+        {
+            FloatReg r;
+            for (int i = 0; i < N; ++i)
+                r.v[i] = f(a.v[i], b.v[i]);
+            return r;
+        }
+        template <typename F>
+        static MaskReg Compare(const FloatReg &a, const FloatReg &b, F f)
+        {
+            MaskReg m = 0;
+            for (int i = 0; i < N; ++i)
+                m |= (MaskReg)f(a.v[i], b.v[i]) << i;
+            return m;
+        }
+        // integer arithmetic wraps around, as it does in the vector units
+        template <typename F>
+        static IntReg MapInt(const IntReg &a, const IntReg &b, F f)
+        {
+            IntReg r;
+            for (int i = 0; i < N; ++i)
+                r.v[i] = (int32_t)f((uint32_t)a.v[i], (uint32_t)b.v[i]);
+            return r;
+        }
+        template <typename F>
+        static MaskReg CompareInt(const IntReg &a, const IntReg &b, F f)
+        {
+            MaskReg m = 0;
+            for (int i = 0; i < N; ++i)
+                m |= (MaskReg)f(a.v[i], b.v[i]) << i;
+            return m;
+        }
+
+        // floats
+        static FloatReg Broadcast(Float f)
+        {
+            FloatReg r;
+            std::fill(r.v, r.v + N, f);
+            return r;
+        }
+        static FloatReg Load(const Float *p)
+        {
+            FloatReg r;
+            std::memcpy(r.v, p, sizeof(r.v));
+            return r;
+        }
+        static void Store(Float *p, const FloatReg &a) { std::memcpy(p, a.v, sizeof(a.v)); }
+        static FloatReg Add(const FloatReg &a, const FloatReg &b) { return Map(a, b, [](Float x, Float y) { return x + y; }); }
+        static FloatReg Sub(const FloatReg &a, const FloatReg &b) { return Map(a, b, [](Float x, Float y) { return x - y; }); }
+        static FloatReg Mul(const FloatReg &a, const FloatReg &b) { return Map(a, b, [](Float x, Float y) { return x * y; }); }
+        static FloatReg Div(const FloatReg &a, const FloatReg &b) { return Map(a, b, [](Float x, Float y) { return x / y; }); }
+        static FloatReg FMA(const FloatReg &a, const FloatReg &b, const FloatReg &c) { return Add(Mul(a, b), c); }
+        static FloatReg Neg(const FloatReg &a) { return Map(a, [](Float x) { return -x; }); }
+        // like minps/maxps: b when either is NaN
+        static FloatReg Min(const FloatReg &a, const FloatReg &b) { return Map(a, b, [](Float x, Float y) { return x < y ? x : y; }); }
+        static FloatReg Max(const FloatReg &a, const FloatReg &b) { return Map(a, b, [](Float x, Float y) { return x > y ? x : y; }); }
+        static FloatReg Abs(const FloatReg &a) { return Map(a, [](Float x) { return std::abs(x); }); }
+        static FloatReg Sqrt(const FloatReg &a) { return Map(a, [](Float x) { return std::sqrt(x); }); }
+        static FloatReg Floor(const FloatReg &a) { return Map(a, [](Float x) { return std::floor(x); }); }
+        static FloatReg Ceil(const FloatReg &a) { return Map(a, [](Float x) { return std::ceil(x); }); }
+        static MaskReg Less(const FloatReg &a, const FloatReg &b) { return Compare(a, b, [](Float x, Float y) { return x < y; }); }
+        static MaskReg LessEqual(const FloatReg &a, const FloatReg &b) { return Compare(a, b, [](Float x, Float y) { return x <= y; }); }
+        static MaskReg Equal(const FloatReg &a, const FloatReg &b) { return Compare(a, b, [](Float x, Float y) { return x == y; }); }
+        static MaskReg NotEqual(const FloatReg &a, const FloatReg &b) { return Compare(a, b, [](Float x, Float y) { return x != y; }); }
+        static FloatReg Select(MaskReg m, const FloatReg &a, const FloatReg &b)
+        {
+            FloatReg r;
+            for (int i = 0; i < N; ++i)
+                r.v[i] = (m >> i) & 1 ? a.v[i] : b.v[i];
+            return r;
+        }
+
+        // 32-bit ints
+        static IntReg BroadcastInt(int32_t v)
+        {
+            IntReg r;
+            std::fill(r.v, r.v + N, v);
+            return r;
+        }
+        static IntReg LoadInt(const int32_t *p)
+        {
+            IntReg r;
+            std::memcpy(r.v, p, sizeof(r.v));
+            return r;
+        }
+        static void StoreInt(int32_t *p, const IntReg &a) { std::memcpy(p, a.v, sizeof(a.v)); }
+        static IntReg AddInt(const IntReg &a, const IntReg &b) { return MapInt(a, b, [](uint32_t x, uint32_t y) { return x + y; }); }
+        static IntReg SubInt(const IntReg &a, const IntReg &b) { return MapInt(a, b, [](uint32_t x, uint32_t y) { return x - y; }); }
+        static IntReg MulInt(const IntReg &a, const IntReg &b) { return MapInt(a, b, [](uint32_t x, uint32_t y) { return x * y; }); }
+        static IntReg And(const IntReg &a, const IntReg &b) { return MapInt(a, b, [](uint32_t x, uint32_t y) { return x & y; }); }
+        static IntReg Or(const IntReg &a, const IntReg &b) { return MapInt(a, b, [](uint32_t x, uint32_t y) { return x | y; }); }
+        static IntReg Xor(const IntReg &a, const IntReg &b) { return MapInt(a, b, [](uint32_t x, uint32_t y) { return x ^ y; }); }
+        static IntReg ShiftLeft(const IntReg &a, int n) { return MapInt(a, a, [n](uint32_t x, uint32_t) { return x << n; }); }
+        static IntReg ShiftRightLogical(const IntReg &a, int n) { return MapInt(a, a, [n](uint32_t x, uint32_t) { return x >> n; }); }
+        static IntReg ShiftRightArithmetic(const IntReg &a, int n)
+        {
+            IntReg r;
+            for (int i = 0; i < N; ++i)
+                r.v[i] = a.v[i] >> n;
+            return r;
+        }
+        static MaskReg EqualInt(const IntReg &a, const IntReg &b) { return CompareInt(a, b, [](int32_t x, int32_t y) { return x == y; }); }
+        static MaskReg LessInt(const IntReg &a, const IntReg &b) { return CompareInt(a, b, [](int32_t x, int32_t y) { return x < y; }); }
+        static IntReg SelectInt(MaskReg m, const IntReg &a, const IntReg &b)
+        {
+            IntReg r;
+            for (int i = 0; i < N; ++i)
+                r.v[i] = (m >> i) & 1 ? a.v[i] : b.v[i];
+            return r;
+        }
+        static FloatReg IntToFloat(const IntReg &a)
+        {
+            FloatReg r;
+            for (int i = 0; i < N; ++i)
+                r.v[i] = (Float)a.v[i];
+            return r;
+        }
+        // truncates towards zero
+        static IntReg FloatToInt(const FloatReg &a)
+        {
+            IntReg r;
+            for (int i = 0; i < N; ++i)
+                r.v[i] = (int32_t)a.v[i];
+            return r;
+        }
+        static IntReg BitsOf(const FloatReg &a)
+        {
+            static_assert(N > 0 && sizeof(Float) == sizeof(int32_t), "bit casts need 32-bit Float lanes");
+            IntReg r;
+            std::memcpy(r.v, a.v, sizeof(r.v));
+            return r;
+        }
+        static FloatReg FloatOf(const IntReg &a)
+        {
+            static_assert(N > 0 && sizeof(Float) == sizeof(int32_t), "bit casts need 32-bit Float lanes");
+            FloatReg r;
+            std::memcpy(r.v, a.v, sizeof(r.v));
+            return r;
+        }
+
+        // masks
+        static MaskReg BroadcastMask(bool b) { return b ? AllBits() : 0; }
+        static MaskReg MaskAnd(MaskReg a, MaskReg b) { return a & b; }
+        static MaskReg MaskOr(MaskReg a, MaskReg b) { return a | b; }
+        static MaskReg MaskXor(MaskReg a, MaskReg b) { return a ^ b; }
+        static MaskReg MaskNot(MaskReg a) { return ~a & AllBits(); }
+        static uint32_t Bits(MaskReg m) { return m; }
+        static constexpr uint32_t AllBits() { return N == 32 ? ~0u : (1u << N) - 1; }
+    };
+
+#if defined(REINA_SIMD_SSE4)
+    template <>
+    struct SimdOps<4>
+    {
+        using FloatReg = __m128;
+        using IntReg = __m128i;
+        // all ones or all zeros per lane
+        using MaskReg = __m128;
+
+        static FloatReg Broadcast(Float f) { return _mm_set1_ps(f); }
+        static FloatReg Load(const Float *p) { return _mm_loadu_ps(p); }
+        static void Store(Float *p, FloatReg a) { _mm_storeu_ps(p, a); }
+        static FloatReg Add(FloatReg a, FloatReg b) { return _mm_add_ps(a, b); }
+        static FloatReg Sub(FloatReg a, FloatReg b) { return _mm_sub_ps(a, b); }
+        static FloatReg Mul(FloatReg a, FloatReg b) { return _mm_mul_ps(a, b); }
+        static FloatReg Div(FloatReg a, FloatReg b) { return _mm_div_ps(a, b); }
+#if defined(__FMA__)
+        static FloatReg FMA(FloatReg a, FloatReg b, FloatReg c) { return _mm_fmadd_ps(a, b, c); }
+#else
+        static FloatReg FMA(FloatReg a, FloatReg b, FloatReg c) { return _mm_add_ps(_mm_mul_ps(a, b), c); }
+#endif
+        static FloatReg Neg(FloatReg a) { return _mm_xor_ps(a, _mm_set1_ps(-0.f)); }
+        static FloatReg Min(FloatReg a, FloatReg b) { return _mm_min_ps(a, b); }
+        static FloatReg Max(FloatReg a, FloatReg b) { return _mm_max_ps(a, b); }
+        static FloatReg Abs(FloatReg a) { return _mm_andnot_ps(_mm_set1_ps(-0.f), a); }
+        static FloatReg Sqrt(FloatReg a) { return _mm_sqrt_ps(a); }
+        static FloatReg Floor(FloatReg a) { return _mm_floor_ps(a); }
+        static FloatReg Ceil(FloatReg a) { return _mm_ceil_ps(a); }
+        static MaskReg Less(FloatReg a, FloatReg b) { return _mm_cmplt_ps(a, b); }
+        static MaskReg LessEqual(FloatReg a, FloatReg b) { return _mm_cmple_ps(a, b); }
+        static MaskReg Equal(FloatReg a, FloatReg b) { return _mm_cmpeq_ps(a, b); }
+        static MaskReg NotEqual(FloatReg a, FloatReg b) { return _mm_cmpneq_ps(a, b); }
+        static FloatReg Select(MaskReg m, FloatReg a, FloatReg b) { return _mm_blendv_ps(b, a, m); }
+
+        static IntReg BroadcastInt(int32_t v) { return _mm_set1_epi32(v); }
+        static IntReg LoadInt(const int32_t *p) { return _mm_loadu_si128((const __m128i *)p); }
+        static void StoreInt(int32_t *p, IntReg a) { _mm_storeu_si128((__m128i *)p, a); }
+        static IntReg AddInt(IntReg a, IntReg b) { return _mm_add_epi32(a, b); }
+        static IntReg SubInt(IntReg a, IntReg b) { return _mm_sub_epi32(a, b); }
+        static IntReg MulInt(IntReg a, IntReg b) { return _mm_mullo_epi32(a, b); }
+        static IntReg And(IntReg a, IntReg b) { return _mm_and_si128(a, b); }
+        static IntReg Or(IntReg a, IntReg b) { return _mm_or_si128(a, b); }
+        static IntReg Xor(IntReg a, IntReg b) { return _mm_xor_si128(a, b); }
+        static IntReg ShiftLeft(IntReg a, int n) { return _mm_sll_epi32(a, _mm_cvtsi32_si128(n)); }
+        static IntReg ShiftRightLogical(IntReg a, int n) { return _mm_srl_epi32(a, _mm_cvtsi32_si128(n)); }
+        static IntReg ShiftRightArithmetic(IntReg a, int n) { return _mm_sra_epi32(a, _mm_cvtsi32_si128(n)); }
+        static MaskReg EqualInt(IntReg a, IntReg b) { return _mm_castsi128_ps(_mm_cmpeq_epi32(a, b)); }
+        static MaskReg LessInt(IntReg a, IntReg b) { return _mm_castsi128_ps(_mm_cmplt_epi32(a, b)); }
+        static IntReg SelectInt(MaskReg m, IntReg a, IntReg b)
+        {
+            return _mm_castps_si128(_mm_blendv_ps(_mm_castsi128_ps(b), _mm_castsi128_ps(a), m));
+        }
+        static FloatReg IntToFloat(IntReg a) { return _mm_cvtepi32_ps(a); }
+        static IntReg FloatToInt(FloatReg a) { return _mm_cvttps_epi32(a); }
+        static IntReg BitsOf(FloatReg a) { return _mm_castps_si128(a); }
+        static FloatReg FloatOf(IntReg a) { return _mm_castsi128_ps(a); }
+
+        static MaskReg BroadcastMask(bool b) { return _mm_castsi128_ps(_mm_set1_epi32(b ? -1 : 0)); }
+        static MaskReg MaskAnd(MaskReg a, MaskReg b) { return _mm_and_ps(a, b); }
+        static MaskReg MaskOr(MaskReg a, MaskReg b) { return _mm_or_ps(a, b); }
+        static MaskReg MaskXor(MaskReg a, MaskReg b) { return _mm_xor_ps(a, b); }
+        static MaskReg MaskNot(MaskReg a) { return _mm_xor_ps(a, BroadcastMask(true)); }
+        static uint32_t Bits(MaskReg m) { return (uint32_t)_mm_movemask_ps(m); }
+        static constexpr uint32_t AllBits() { return 0xf; }
+    };
+#endif
+
+#if defined(REINA_SIMD_AVX2)
+    template <>
+    struct SimdOps<8>
+    {
+        using FloatReg = __m256;
+        using IntReg = __m256i;
+        // all ones or all zeros per lane
+        using MaskReg = __m256;
+
+        static FloatReg Broadcast(Float f) { return _mm256_set1_ps(f); }
+        static FloatReg Load(const Float *p) { return _mm256_loadu_ps(p); }
+        static void Store(Float *p, FloatReg a) { _mm256_storeu_ps(p, a); }
+        static FloatReg Add(FloatReg a, FloatReg b) { return _mm256_add_ps(a, b); }
+        static FloatReg Sub(FloatReg a, FloatReg b) { return _mm256_sub_ps(a, b); }
+        static FloatReg Mul(FloatReg a, FloatReg b) { return _mm256_mul_ps(a, b); }
+        static FloatReg Div(FloatReg a, FloatReg b) { return _mm256_div_ps(a, b); }
+#if defined(__FMA__)
+        static FloatReg FMA(FloatReg a, FloatReg b, FloatReg c) { return _mm256_fmadd_ps(a, b, c); }
+#else
+        static FloatReg FMA(FloatReg a, FloatReg b, FloatReg c) { return _mm256_add_ps(_mm256_mul_ps(a, b), c); }
+#endif
+        static FloatReg Neg(FloatReg a) { return _mm256_xor_ps(a, _mm256_set1_ps(-0.f)); }
+        static FloatReg Min(FloatReg a, FloatReg b) { return _mm256_min_ps(a, b); }
+        static FloatReg Max(FloatReg a, FloatReg b) { return _mm256_max_ps(a, b); }
+        static FloatReg Abs(FloatReg a) { return _mm256_andnot_ps(_mm256_set1_ps(-0.f), a); }
+        static FloatReg Sqrt(FloatReg a) { return _mm256_sqrt_ps(a); }
+        static FloatReg Floor(FloatReg a) { return _mm256_floor_ps(a); }
+        static FloatReg Ceil(FloatReg a) { return _mm256_ceil_ps(a); }
+        static MaskReg Less(FloatReg a, FloatReg b) { return _mm256_cmp_ps(a, b, _CMP_LT_OQ); }
+        static MaskReg LessEqual(FloatReg a, FloatReg b) { return _mm256_cmp_ps(a, b, _CMP_LE_OQ); }
+        static MaskReg Equal(FloatReg a, FloatReg b) { return _mm256_cmp_ps(a, b, _CMP_EQ_OQ); }
+        static MaskReg NotEqual(FloatReg a, FloatReg b) { return _mm256_cmp_ps(a, b, _CMP_NEQ_UQ); }
+        static FloatReg Select(MaskReg m, FloatReg a, FloatReg b) { return _mm256_blendv_ps(b, a, m); }
+
+        static IntReg BroadcastInt(int32_t v) { return _mm256_set1_epi32(v); }
+        static IntReg LoadInt(const int32_t *p) { return _mm256_loadu_si256((const __m256i *)p); }
+        static void StoreInt(int32_t *p, IntReg a) { _mm256_storeu_si256((__m256i *)p, a); }
+        static IntReg AddInt(IntReg a, IntReg b) { return _mm256_add_epi32(a, b); }
+        static IntReg SubInt(IntReg a, IntReg b) { return _mm256_sub_epi32(a, b); }
+        static IntReg MulInt(IntReg a, IntReg b) { return _mm256_mullo_epi32(a, b); }
+        static IntReg And(IntReg a, IntReg b) { return _mm256_and_si256(a, b); }
+        static IntReg Or(IntReg a, IntReg b) { return _mm256_or_si256(a, b); }
+        static IntReg Xor(IntReg a, IntReg b) { return _mm256_xor_si256(a, b); }
+        static IntReg ShiftLeft(IntReg a, int n) { return _mm256_sll_epi32(a, _mm_cvtsi32_si128(n)); }
+        static IntReg ShiftRightLogical(IntReg a, int n) { return _mm256_srl_epi32(a, _mm_cvtsi32_si128(n)); }
+        static IntReg ShiftRightArithmetic(IntReg a, int n) { return _mm256_sra_epi32(a, _mm_cvtsi32_si128(n)); }
+        static MaskReg EqualInt(IntReg a, IntReg b) { return _mm256_castsi256_ps(_mm256_cmpeq_epi32(a, b)); }
+        static MaskReg LessInt(IntReg a, IntReg b) { return _mm256_castsi256_ps(_mm256_cmpgt_epi32(b, a)); }
+        static IntReg SelectInt(MaskReg m, IntReg a, IntReg b)
+        {
+            return _mm256_castps_si256(_mm256_blendv_ps(_mm256_castsi256_ps(b), _mm256_castsi256_ps(a), m));
+        }
+        static FloatReg IntToFloat(IntReg a) { return _mm256_cvtepi32_ps(a); }
+        static IntReg FloatToInt(FloatReg a) { return _mm256_cvttps_epi32(a); }
+        static IntReg BitsOf(FloatReg a) { return _mm256_castps_si256(a); }
+        static FloatReg FloatOf(IntReg a) { return _mm256_castsi256_ps(a); }
+
+        static MaskReg BroadcastMask(bool b) { return _mm256_castsi256_ps(_mm256_set1_epi32(b ? -1 : 0)); }
+        static MaskReg MaskAnd(MaskReg a, MaskReg b) { return _mm256_and_ps(a, b); }
+        static MaskReg MaskOr(MaskReg a, MaskReg b) { return _mm256_or_ps(a, b); }
+        static MaskReg MaskXor(MaskReg a, MaskReg b) { return _mm256_xor_ps(a, b); }
+        static MaskReg MaskNot(MaskReg a) { return _mm256_xor_ps(a, BroadcastMask(true)); }
+        static uint32_t Bits(MaskReg m) { return (uint32_t)_mm256_movemask_ps(m); }
+        static constexpr uint32_t AllBits() { return 0xff; }
+    };
+#endif
+
+#if defined(REINA_SIMD_AVX512)
+    template <>
+    struct SimdOps<16>
+    {
+        using FloatReg = __m512;
+        using IntReg = __m512i;
+        // a bit per lane, as the compare instructions produce
+        using MaskReg = __mmask16;
+
+        static FloatReg Broadcast(Float f) { return _mm512_set1_ps(f); }
+        static FloatReg Load(const Float *p) { return _mm512_loadu_ps(p); }
+        static void Store(Float *p, FloatReg a) { _mm512_storeu_ps(p, a); }
+        static FloatReg Add(FloatReg a, FloatReg b) { return _mm512_add_ps(a, b); }
+        static FloatReg Sub(FloatReg a, FloatReg b) { return _mm512_sub_ps(a, b); }
+        static FloatReg Mul(FloatReg a, FloatReg b) { return _mm512_mul_ps(a, b); }
+        static FloatReg Div(FloatReg a, FloatReg b) { return _mm512_div_ps(a, b); }
+        static FloatReg FMA(FloatReg a, FloatReg b, FloatReg c) { return _mm512_fmadd_ps(a, b, c); }
+        // sign flips through the integer unit: the float logic ops need AVX-512DQ
+        static FloatReg Neg(FloatReg a) { return FloatOf(Xor(BitsOf(a), BroadcastInt(INT32_MIN))); }
+        static FloatReg Min(FloatReg a, FloatReg b) { return _mm512_min_ps(a, b); }
+        static FloatReg Max(FloatReg a, FloatReg b) { return _mm512_max_ps(a, b); }
+        static FloatReg Abs(FloatReg a) { return FloatOf(And(BitsOf(a), BroadcastInt(INT32_MAX))); }
+        static FloatReg Sqrt(FloatReg a) { return _mm512_sqrt_ps(a); }
+        static FloatReg Floor(FloatReg a) { return _mm512_roundscale_ps(a, _MM_FROUND_TO_NEG_INF | _MM_FROUND_NO_EXC); }
+        static FloatReg Ceil(FloatReg a) { return _mm512_roundscale_ps(a, _MM_FROUND_TO_POS_INF | _MM_FROUND_NO_EXC); }
+        static MaskReg Less(FloatReg a, FloatReg b) { return _mm512_cmp_ps_mask(a, b, _CMP_LT_OQ); }
+        static MaskReg LessEqual(FloatReg a, FloatReg b) { return _mm512_cmp_ps_mask(a, b, _CMP_LE_OQ); }
+        static MaskReg Equal(FloatReg a, FloatReg b) { return _mm512_cmp_ps_mask(a, b, _CMP_EQ_OQ); }
+        static MaskReg NotEqual(FloatReg a, FloatReg b) { return _mm512_cmp_ps_mask(a, b, _CMP_NEQ_UQ); }
+        static FloatReg Select(MaskReg m, FloatReg a, FloatReg b) { return _mm512_mask_blend_ps(m, b, a); }
+
+        static IntReg BroadcastInt(int32_t v) { return _mm512_set1_epi32(v); }
+        static IntReg LoadInt(const int32_t *p) { return _mm512_loadu_si512(p); }
+        static void StoreInt(int32_t *p, IntReg a) { _mm512_storeu_si512(p, a); }
+        static IntReg AddInt(IntReg a, IntReg b) { return _mm512_add_epi32(a, b); }
+        static IntReg SubInt(IntReg a, IntReg b) { return _mm512_sub_epi32(a, b); }
+        static IntReg MulInt(IntReg a, IntReg b) { return _mm512_mullo_epi32(a, b); }
+        static IntReg And(IntReg a, IntReg b) { return _mm512_and_si512(a, b); }
+        static IntReg Or(IntReg a, IntReg b) { return _mm512_or_si512(a, b); }
+        static IntReg Xor(IntReg a, IntReg b) { return _mm512_xor_si512(a, b); }
+        static IntReg ShiftLeft(IntReg a, int n) { return _mm512_sll_epi32(a, _mm_cvtsi32_si128(n)); }
+        static IntReg ShiftRightLogical(IntReg a, int n) { return _mm512_srl_epi32(a, _mm_cvtsi32_si128(n)); }
+        static IntReg ShiftRightArithmetic(IntReg a, int n) { return _mm512_sra_epi32(a, _mm_cvtsi32_si128(n)); }
+        static MaskReg EqualInt(IntReg a, IntReg b) { return _mm512_cmpeq_epi32_mask(a, b); }
+        static MaskReg LessInt(IntReg a, IntReg b) { return _mm512_cmplt_epi32_mask(a, b); }
+        static IntReg SelectInt(MaskReg m, IntReg a, IntReg b) { return _mm512_mask_blend_epi32(m, b, a); }
+        static FloatReg IntToFloat(IntReg a) { return _mm512_cvtepi32_ps(a); }
+        static IntReg FloatToInt(FloatReg a) { return _mm512_cvttps_epi32(a); }
+        static IntReg BitsOf(FloatReg a) { return _mm512_castps_si512(a); }
+        static FloatReg FloatOf(IntReg a) { return _mm512_castsi512_ps(a); }
+
+        static MaskReg BroadcastMask(bool b) { return b ? 0xffff : 0; }
+        static MaskReg MaskAnd(MaskReg a, MaskReg b) { return a & b; }
+        static MaskReg MaskOr(MaskReg a, MaskReg b) { return a | b; }
+        static MaskReg MaskXor(MaskReg a, MaskReg b) { return a ^ b; }
+        static MaskReg MaskNot(MaskReg a) { return (MaskReg)~a; }
+        static uint32_t Bits(MaskReg m) { return m; }
+        static constexpr uint32_t AllBits() { return 0xffff; }
+    };
+#endif
+
+    template <int N>
+    class SimdFloat;
+    template <int N>
+    class SimdInt;
+
+    // the outcome of a lane-wise comparison; combine with & | ^ !, reduce with Any/All/None
+    template <int N>
+    class SimdMask
+    {
+    public:
+        using Ops = SimdOps<N>;
+        using Reg = typename Ops::MaskReg;
+
+        // SimdMask Public Methods
+        SimdMask() : m(Ops::BroadcastMask(false)) {}
+        SimdMask(bool b) : m(Ops::BroadcastMask(b)) {}
+        explicit SimdMask(Reg m) : m(m) {}
+        bool operator[](int i) const { return (Bits() >> i) & 1; }
+        // lane i in bit i
+        uint32_t Bits() const { return Ops::Bits(m); }
+
+        friend SimdMask operator&(SimdMask a, SimdMask b) { return SimdMask(Ops::MaskAnd(a.m, b.m)); }
+        friend SimdMask operator|(SimdMask a, SimdMask b) { return SimdMask(Ops::MaskOr(a.m, b.m)); }
+        friend SimdMask operator^(SimdMask a, SimdMask b) { return SimdMask(Ops::MaskXor(a.m, b.m)); }
+        friend SimdMask operator!(SimdMask a) { return SimdMask(Ops::MaskNot(a.m)); }
+        SimdMask &operator&=(SimdMask b) { return *this = *this & b; }
+        SimdMask &operator|=(SimdMask b) { return *this = *this | b; }
+        friend bool Any(SimdMask a) { return a.Bits() != 0; }
+        friend bool All(SimdMask a) { return a.Bits() == Ops::AllBits(); }
+        friend bool None(SimdMask a) { return a.Bits() == 0; }
+
+        // SimdMask Public Data
+        Reg m;
+    };
+
+    // N Floats with value semantics: arithmetic, comparisons and the math functions work lane-wise,
+    // and a Float operand is broadcast to every lane
+    template <int N>
+    class SimdFloat
+    {
+    public:
+        using Ops = SimdOps<N>;
+        using Reg = typename Ops::FloatReg;
+        static constexpr int Size = N;
+
+        // SimdFloat Public Methods
+        SimdFloat() : v(Ops::Broadcast(0)) {}
+        SimdFloat(Float f) : v(Ops::Broadcast(f)) {}
+        explicit SimdFloat(Reg v) : v(v) {}
+        // lane-wise int to float conversion
+        explicit SimdFloat(const SimdInt<N> &i) : v(Ops::IntToFloat(i.v)) {}
+        // p needs no particular alignment
+        static SimdFloat Load(const Float *p) { return SimdFloat(Ops::Load(p)); }
+        void Store(Float *p) const { Ops::Store(p, v); }
+        Float operator[](int i) const
+        {
+            Float lanes[N];
+            Store(lanes);
+            return lanes[i];
+        }
+        void Set(int i, Float f)
+        {
+            Float lanes[N];
+            Store(lanes);
+            lanes[i] = f;
+            v = Ops::Load(lanes);
+        }
+
+        friend SimdFloat operator+(SimdFloat a, SimdFloat b) { return SimdFloat(Ops::Add(a.v, b.v)); }
+        friend SimdFloat operator-(SimdFloat a, SimdFloat b) { return SimdFloat(Ops::Sub(a.v, b.v)); }
+        friend SimdFloat operator*(SimdFloat a, SimdFloat b) { return SimdFloat(Ops::Mul(a.v, b.v)); }
+        friend SimdFloat operator/(SimdFloat a, SimdFloat b) { return SimdFloat(Ops::Div(a.v, b.v)); }
+        friend SimdFloat operator-(SimdFloat a) { return SimdFloat(Ops::Neg(a.v)); }
+        SimdFloat &operator+=(SimdFloat b) { return *this = *this + b; }
+        SimdFloat &operator-=(SimdFloat b) { return *this = *this - b; }
+        SimdFloat &operator*=(SimdFloat b) { return *this = *this * b; }
+        SimdFloat &operator/=(SimdFloat b) { return *this = *this / b; }
+
+        friend SimdMask<N> operator<(SimdFloat a, SimdFloat b) { return SimdMask<N>(Ops::Less(a.v, b.v)); }
+        friend SimdMask<N> operator<=(SimdFloat a, SimdFloat b) { return SimdMask<N>(Ops::LessEqual(a.v, b.v)); }
+        friend SimdMask<N> operator>(SimdFloat a, SimdFloat b) { return SimdMask<N>(Ops::Less(b.v, a.v)); }
+        friend SimdMask<N> operator>=(SimdFloat a, SimdFloat b) { return SimdMask<N>(Ops::LessEqual(b.v, a.v)); }
+        friend SimdMask<N> operator==(SimdFloat a, SimdFloat b) { return SimdMask<N>(Ops::Equal(a.v, b.v)); }
+        // true for NaN lanes, like the scalar operator
+        friend SimdMask<N> operator!=(SimdFloat a, SimdFloat b) { return SimdMask<N>(Ops::NotEqual(a.v, b.v)); }
+
+        // b in lanes where either is NaN
+        friend SimdFloat Min(SimdFloat a, SimdFloat b) { return SimdFloat(Ops::Min(a.v, b.v)); }
+        friend SimdFloat Max(SimdFloat a, SimdFloat b) { return SimdFloat(Ops::Max(a.v, b.v)); }
+        friend SimdFloat Abs(SimdFloat a) { return SimdFloat(Ops::Abs(a.v)); }
+        friend SimdFloat Sqrt(SimdFloat a) { return SimdFloat(Ops::Sqrt(a.v)); }
+        friend SimdFloat Floor(SimdFloat a) { return SimdFloat(Ops::Floor(a.v)); }
+        friend SimdFloat Ceil(SimdFloat a) { return SimdFloat(Ops::Ceil(a.v)); }
+        // a * b + c, fused where the target has FMA
+        friend SimdFloat FMA(SimdFloat a, SimdFloat b, SimdFloat c) { return SimdFloat(Ops::FMA(a.v, b.v, c.v)); }
+        friend SimdMask<N> IsNaN(SimdFloat a) { return a != a; }
+        // a where m is set, b elsewhere
+        friend SimdFloat Select(SimdMask<N> m, SimdFloat a, SimdFloat b) { return SimdFloat(Ops::Select(m.m, a.v, b.v)); }
+        friend Float ReduceMin(SimdFloat a)
+        {
+            Float lanes[N];
+            a.Store(lanes);
+            return *std::min_element(lanes, lanes + N);
+        }
+        friend Float ReduceMax(SimdFloat a)
+        {
+            Float lanes[N];
+            a.Store(lanes);
+            return *std::max_element(lanes, lanes + N);
+        }
+        friend Float ReduceAdd(SimdFloat a)
+        {
+            Float lanes[N], sum = 0;
+            a.Store(lanes);
+            for (int i = 0; i < N; ++i)
+                sum += lanes[i];
+            return sum;
+        }
+
+        // SimdFloat Public Data
+        Reg v;
+    };
+
+    // N int32_t lanes; arithmetic wraps around and >> is arithmetic
+    template <int N>
+    class SimdInt
+    {
+    public:
+        using Ops = SimdOps<N>;
+        using Reg = typename Ops::IntReg;
+        static constexpr int Size = N;
+
+        // SimdInt Public Methods
+        SimdInt() : v(Ops::BroadcastInt(0)) {}
+        SimdInt(int32_t i) : v(Ops::BroadcastInt(i)) {}
+        explicit SimdInt(Reg v) : v(v) {}
+        // lane-wise float to int conversion, truncating towards zero
+        explicit SimdInt(const SimdFloat<N> &f) : v(Ops::FloatToInt(f.v)) {}
+        static SimdInt Load(const int32_t *p) { return SimdInt(Ops::LoadInt(p)); }
+        void Store(int32_t *p) const { Ops::StoreInt(p, v); }
+        int32_t operator[](int i) const
+        {
+            int32_t lanes[N];
+            Store(lanes);
+            return lanes[i];
+        }
+        void Set(int i, int32_t value)
+        {
+            int32_t lanes[N];
+            Store(lanes);
+            lanes[i] = value;
+            v = Ops::LoadInt(lanes);
+        }
+
+        friend SimdInt operator+(SimdInt a, SimdInt b) { return SimdInt(Ops::AddInt(a.v, b.v)); }
+        friend SimdInt operator-(SimdInt a, SimdInt b) { return SimdInt(Ops::SubInt(a.v, b.v)); }
+        friend SimdInt operator*(SimdInt a, SimdInt b) { return SimdInt(Ops::MulInt(a.v, b.v)); }
+        friend SimdInt operator&(SimdInt a, SimdInt b) { return SimdInt(Ops::And(a.v, b.v)); }
+        friend SimdInt operator|(SimdInt a, SimdInt b) { return SimdInt(Ops::Or(a.v, b.v)); }
+        friend SimdInt operator^(SimdInt a, SimdInt b) { return SimdInt(Ops::Xor(a.v, b.v)); }
+        friend SimdInt operator~(SimdInt a) { return a ^ SimdInt(-1); }
+        friend SimdInt operator<<(SimdInt a, int n) { return SimdInt(Ops::ShiftLeft(a.v, n)); }
+        friend SimdInt operator>>(SimdInt a, int n) { return SimdInt(Ops::ShiftRightArithmetic(a.v, n)); }
+        // >> on the lanes taken as unsigned
+        friend SimdInt ShiftRightLogical(SimdInt a, int n) { return SimdInt(Ops::ShiftRightLogical(a.v, n)); }
+        SimdInt &operator+=(SimdInt b) { return *this = *this + b; }
+        SimdInt &operator-=(SimdInt b) { return *this = *this - b; }
+        SimdInt &operator*=(SimdInt b) { return *this = *this * b; }
+        SimdInt &operator&=(SimdInt b) { return *this = *this & b; }
+        SimdInt &operator|=(SimdInt b) { return *this = *this | b; }
+        SimdInt &operator^=(SimdInt b) { return *this = *this ^ b; }
+
+        friend SimdMask<N> operator==(SimdInt a, SimdInt b) { return SimdMask<N>(Ops::EqualInt(a.v, b.v)); }
+        friend SimdMask<N> operator!=(SimdInt a, SimdInt b) { return !(a == b); }
+        friend SimdMask<N> operator<(SimdInt a, SimdInt b) { return SimdMask<N>(Ops::LessInt(a.v, b.v)); }
+        friend SimdMask<N> operator>(SimdInt a, SimdInt b) { return SimdMask<N>(Ops::LessInt(b.v, a.v)); }
+        friend SimdInt Select(SimdMask<N> m, SimdInt a, SimdInt b) { return SimdInt(Ops::SelectInt(m.m, a.v, b.v)); }
+
+        // SimdInt Public Data
+        Reg v;
+    };
+
+    // bit casts, as FloatToBits()/BitsToFloat() do for one value
+    template <int N>
+    inline SimdInt<N> FloatToBits(const SimdFloat<N> &f) { return SimdInt<N>(SimdOps<N>::BitsOf(f.v)); }
+    template <int N>
+    inline SimdFloat<N> BitsToFloat(const SimdInt<N> &i) { return SimdFloat<N>(SimdOps<N>::FloatOf(i.v)); }
+
+    using Float4 = SimdFloat<4>;
+    using Float8 = SimdFloat<8>;
+    using Float16 = SimdFloat<16>;
+    using Int4 = SimdInt<4>;
+    using Int8 = SimdInt<8>;
+    using Int16 = SimdInt<16>;
+    using Mask4 = SimdMask<4>;
+    using Mask8 = SimdMask<8>;
+    using Mask16 = SimdMask<16>;
+
+    // scalar counterparts, so that code templated on the component type reads the same for one
+    // lane and for many
+    inline bool Any(bool b) { return b; }
+    inline bool All(bool b) { return b; }
+    inline bool None(bool b) { return !b; }
+    template <typename T>
+    inline T Select(bool m, T a, T b) { return m ? a : b; }
+    // b when either is NaN, as minps/maxps do (std::min and std::max return a)
+    template <typename T, typename = std::enable_if_t<std::is_arithmetic<T>::value>>
+    inline T Min(T a, T b) { return a < b ? a : b; }
+    template <typename T, typename = std::enable_if_t<std::is_arithmetic<T>::value>>
+    inline T Max(T a, T b) { return a > b ? a : b; }
+    template <typename T, typename = std::enable_if_t<std::is_arithmetic<T>::value>>
+    inline T Abs(T a) { return std::abs(a); }
+    template <typename T, typename = std::enable_if_t<std::is_arithmetic<T>::value>>
+    inline bool IsNaN(T a)
+    {
+        if constexpr (std::is_floating_point<T>::value)
+            return std::isnan(a);
+        else
+            return false;
+    }
+    inline Float Sqrt(Float a) { return std::sqrt(a); }
+    inline Float Floor(Float a) { return std::floor(a); }
+    inline Float Ceil(Float a) { return std::ceil(a); }
+    // not fused: std::fma is a library call on targets without FMA instructions
+    inline Float FMA(Float a, Float b, Float c) { return a * b + c; }
+}
+
+namespace std
+{
+    // for code such as Bounds3<T>() that starts from the extreme values
+    template <int N>
+    class numeric_limits<reina::SimdFloat<N>>
+    {
+    public:
+        static constexpr bool is_specialized = true;
+        static reina::SimdFloat<N> lowest() { return numeric_limits<reina::Float>::lowest(); }
+        static reina::SimdFloat<N> max() { return numeric_limits<reina::Float>::max(); }
+        static reina::SimdFloat<N> infinity() { return numeric_limits<reina::Float>::infinity(); }
+    };
+}
@@ -6,9 +6,15 @@
 #include <reina.hpp>
 #include <utils/math.hpp>
 #include <utils/float.hpp>
+#include <utils/simd.hpp>
 
 namespace reina
 {
+    // the type lengths and reciprocals of T components come in: Float for scalar components,
+    // SimdFloat<N> for wide ones, so the templates below serve both
+    template <typename T>
+    using FloatType = decltype(T() * Float());
+
     template <typename T>
     class Point2
     {
@@ -42,7 +48,7 @@ namespace reina
         {
             return Vector2<U>(x, y);
         }
-        bool HasNaNs() const { return std::isnan(x) || std::isnan(y); }
+        bool HasNaNs() const { return Any(IsNaN(x) | IsNaN(y)); }
         // Point2 Public Methods
         Point2<T> operator+(const Vector2<T> &v) const
         {
@@ -103,15 +109,15 @@ namespace reina
 
         Point2<T> operator/(T f) const
         {
-            assert(f != 0);
-            Float inv = (Float)1 / f;
+            assert(None(f == 0));
+            FloatType<T> inv = (Float)1 / f;
             return Point2<T>(x * inv, y * inv);
         }
 
         Point2<T> &operator/=(T f)
         {
-            assert(f != 0);
-            Float inv = (Float)1 / f;
+            assert(None(f == 0));
+            FloatType<T> inv = (Float)1 / f;
             x *= inv;
             y *= inv;
             return *this;
@@ -176,7 +182,7 @@ namespace reina
             return Vector3<U>(x, y, z);
         }
 
-        bool HasNaNs() const { return std::isnan(x) || std::isnan(y) || std::isnan(z); }
+        bool HasNaNs() const { return Any(IsNaN(x) | IsNaN(y) | IsNaN(z)); }
 
         // Point3 Public Methods
         friend std::ostream &operator<<(std::ostream &os, const Point3<T> &p)
@@ -248,15 +254,15 @@ namespace reina
 
         Point3<T> operator/(T f) const
         {
-            assert(f != 0);
-            Float inv = (Float)1 / f;
+            assert(None(f == 0));
+            FloatType<T> inv = (Float)1 / f;
             return Point3<T>(x * inv, y * inv, z * inv);
         }
 
         Point3<T> &operator/=(T f)
         {
-            assert(f != 0);
-            Float inv = (Float)1 / f;
+            assert(None(f == 0));
+            FloatType<T> inv = (Float)1 / f;
             x *= inv;
             y *= inv;
             z *= inv;
@@ -304,7 +310,7 @@ namespace reina
         Vector2() : x(0), y(0) {}
         Vector2(T x, T y) : x(x), y(y) {}
         Vector2(const Vector2 &v) : x(v.x), y(v.y) {}
-        bool HasNaNs() const { return std::isnan(x) || std::isnan(y); }
+        bool HasNaNs() const { return Any(IsNaN(x) | IsNaN(y)); }
         explicit Vector2(const Point2<T> &p) : x(p.x), y(p.y) {}
         explicit Vector2(const Point3<T> &p) : x(p.x), y(p.y) {}
 
@@ -357,7 +363,7 @@ namespace reina
 
         Vector2<T> &operator*=(T s)
         {
-            assert(!std::isnan(s));
+            assert(None(IsNaN(s)));
             x *= s;
             y *= s;
             return *this;
@@ -365,15 +371,15 @@ namespace reina
 
         Vector2<T> operator/(T s) const
         {
-            assert(s != 0);
-            Float inv = (Float)1 / s;
+            assert(None(s == 0));
+            FloatType<T> inv = (Float)1 / s;
             return Vector2<T>(x * inv, y * inv);
         }
 
         Vector2<T> &operator/=(T s)
         {
-            assert(s != 0);
-            Float inv = (Float)1 / s;
+            assert(None(s == 0));
+            FloatType<T> inv = (Float)1 / s;
             x *= inv;
             y *= inv;
             return *this;
@@ -389,9 +395,9 @@ namespace reina
             return y;
         }
 
-        Float LengthSquared() const { return x * x + y * y; }
+        FloatType<T> LengthSquared() const { return x * x + y * y; }
 
-        Float Length() const { return std::sqrt(LengthSquared()); }
+        FloatType<T> Length() const { return Sqrt(LengthSquared()); }
 
         // Vector2 Public Data
         T x, y;
@@ -405,7 +411,7 @@ namespace reina
         Vector3(T x, T y, T z) : x(x), y(y), z(z) {}
         Vector3(const Vector3 &v) : x(v.x), y(v.y), z(v.z) {}
         Vector3(const Normal3<T> &n) : x(n.x), y(n.y), z(n.z) {}
-        bool HasNaNs() const { return std::isnan(x) || std::isnan(y) || std::isnan(z); }
+        bool HasNaNs() const { return Any(IsNaN(x) | IsNaN(y) | IsNaN(z)); }
         explicit Vector3(const Point3<T> &p) : x(p.x), y(p.y), z(p.z) {}
         explicit Vector3(const Point2<T> &p) : x(p.x), y(p.y), z(0) {}
 
@@ -460,7 +466,7 @@ namespace reina
 
         Vector3<T> &operator*=(T s)
         {
-            assert(!std::isnan(s));
+            assert(None(IsNaN(s)));
             x *= s;
             y *= s;
             z *= s;
@@ -469,15 +475,15 @@ namespace reina
 
         Vector3<T> operator/(T s) const
         {
-            assert(s != 0);
-            Float inv = (Float)1 / s;
+            assert(None(s == 0));
+            FloatType<T> inv = (Float)1 / s;
             return Vector3<T>(x * inv, y * inv, z * inv);
         }
 
         Vector3<T> &operator/=(T s)
         {
-            assert(s != 0);
-            Float inv = (Float)1 / s;
+            assert(None(s == 0));
+            FloatType<T> inv = (Float)1 / s;
             x *= inv;
             y *= inv;
             z *= inv;
@@ -486,6 +492,16 @@ namespace reina
 
         Vector3<T> operator-() const { return Vector3<T>(-x, -y, -z); }
 
+        T operator[](int i) const
+        {
+            assert(i >= 0 && i <= 2);
+            if (i == 0)
+                return x;
+            if (i == 1)
+                return y;
+            return z;
+        }
+
         T &operator[](int i)
         {
             assert(i >= 0 && i <= 2);
@@ -496,9 +512,9 @@ namespace reina
             return z;
         }
 
-        Float LengthSquared() const { return x * x + y * y + z * z; }
+        FloatType<T> LengthSquared() const { return x * x + y * y + z * z; }
 
-        Float Length() const { return std::sqrt(LengthSquared()); }
+        FloatType<T> Length() const { return Sqrt(LengthSquared()); }
 
         // Dot
         T Dot(const Vector3<T> &v) const
@@ -522,35 +538,33 @@ namespace reina
     };
 
     template <typename T>
-    inline Float Distance(const Point3<T> &p1, const Point3<T> &p2)
+    inline FloatType<T> Distance(const Point3<T> &p1, const Point3<T> &p2)
     {
         return (p1 - p2).Length();
     }
 
     template <typename T>
-    inline Float DistanceSquared(const Point3<T> &p1, const Point3<T> &p2)
+    inline FloatType<T> DistanceSquared(const Point3<T> &p1, const Point3<T> &p2)
     {
         return (p1 - p2).LengthSquared();
     }
 
     template <typename T>
-    inline Point3<T> Lerp(Float t, const Point3<T> &p0, const Point3<T> &p1)
+    inline Point3<T> Lerp(FloatType<T> t, const Point3<T> &p0, const Point3<T> &p1)
     {
-        return (1 - t) * p0 + t * p1;
+        return p0 * (1 - t) + p1 * t;
     }
 
     template <typename T>
     inline Point3<T> Min(const Point3<T> &p1, const Point3<T> &p2)
     {
-        return Point3<T>(std::min(p1.x, p2.x), std::min(p1.y, p2.y),
-                         std::min(p1.z, p2.z));
+        return Point3<T>(Min(p1.x, p2.x), Min(p1.y, p2.y), Min(p1.z, p2.z));
     }
 
     template <typename T>
     inline Point3<T> Max(const Point3<T> &p1, const Point3<T> &p2)
     {
-        return Point3<T>(std::max(p1.x, p2.x), std::max(p1.y, p2.y),
-                         std::max(p1.z, p2.z));
+        return Point3<T>(Max(p1.x, p2.x), Max(p1.y, p2.y), Max(p1.z, p2.z));
     }
 
     // Floor Ceil and Abs
@@ -558,19 +572,19 @@ namespace reina
     template <typename T>
     inline Vector3<T> Abs(const Vector3<T> &v)
     {
-        return Vector3<T>(std::abs(v.x), std::abs(v.y), std::abs(v.z));
+        return Vector3<T>(Abs(v.x), Abs(v.y), Abs(v.z));
     }
 
     template <typename T>
     inline Vector3<T> Floor(const Vector3<T> &v)
     {
-        return Vector3<T>(std::floor(v.x), std::floor(v.y), std::floor(v.z));
+        return Vector3<T>(Floor(v.x), Floor(v.y), Floor(v.z));
     }
 
     template <typename T>
     inline Vector3<T> Ceil(const Vector3<T> &v)
     {
-        return Vector3<T>(std::ceil(v.x), std::ceil(v.y), std::ceil(v.z));
+        return Vector3<T>(Ceil(v.x), Ceil(v.y), Ceil(v.z));
     }
 
     template <typename T>
@@ -579,8 +593,56 @@ namespace reina
         return Point3<T>(p[x], p[y], p[z]);
     }
 
+    template <typename T>
+    Vector3<T> Permute(const Vector3<T> &v, int x, int y, int z)
+    {
+        return Vector3<T>(v[x], v[y], v[z]);
+    }
+
+    template <typename T>
+    inline T MaxComponent(const Vector3<T> &v)
+    {
+        return Max(v.x, Max(v.y, v.z));
+    }
+
+    template <typename T>
+    inline int MaxDimension(const Vector3<T> &v)
+    {
+        return (v.x > v.y) ? ((v.x > v.z) ? 0 : 2) : ((v.y > v.z) ? 1 : 2);
+    }
+
+    template <typename T>
+    inline Vector3<T> Normalize(const Vector3<T> &v)
+    {
+        return v / v.Length();
+    }
+
     // Normal
 
+    // v1 must be normalized; v2 and v3 complete an orthonormal basis
+    template <typename T>
+    inline void CoordinateSystem(const Vector3<T> &v1, Vector3<T> *v2, Vector3<T> *v3)
+    {
+        if (std::abs(v1.x) > std::abs(v1.y))
+            *v2 = Vector3<T>(-v1.z, 0, v1.x) / std::sqrt(v1.x * v1.x + v1.z * v1.z);
+        else
+            *v2 = Vector3<T>(0, v1.z, -v1.y) / std::sqrt(v1.y * v1.y + v1.z * v1.z);
+        *v3 = v1.Cross(*v2);
+    }
+
+    // spherical coordinates with +z as the pole: theta from +z, phi around it from +x
+    inline Vector3f SphericalDirection(Float sinTheta, Float cosTheta, Float phi)
+    {
+        return Vector3f(Clamp(sinTheta, -1, 1) * std::cos(phi), Clamp(sinTheta, -1, 1) * std::sin(phi),
+                        Clamp(cosTheta, -1, 1));
+    }
+    inline Float SphericalTheta(const Vector3f &v) { return std::acos(Clamp(v.z, -1, 1)); }
+    inline Float SphericalPhi(const Vector3f &v)
+    {
+        Float p = std::atan2(v.y, v.x);
+        return p < 0 ? p + 2 * Pi : p;
+    }
+
     template <typename T>
     class Normal3
     {
@@ -599,7 +661,7 @@ namespace reina
             assert(!HasNaNs());
         }
 
-        bool HasNaNs() const { return std::isnan(x) || std::isnan(y) || std::isnan(z); }
+        bool HasNaNs() const { return Any(IsNaN(x) | IsNaN(y) | IsNaN(z)); }
 
         // Normal3 Public Methods
         friend std::ostream &operator<<(std::ostream &os, const Normal3<T> &n)
@@ -660,15 +722,15 @@ namespace reina
 
         Normal3<T> operator/(T f) const
         {
-            assert(f != 0);
-            Float inv = (Float)1 / f;
+            assert(None(f == 0));
+            FloatType<T> inv = (Float)1 / f;
             return Normal3<T>(x * inv, y * inv, z * inv);
         }
 
         Normal3<T> &operator/=(T f)
         {
-            assert(f != 0);
-            Float inv = (Float)1 / f;
+            assert(None(f == 0));
+            FloatType<T> inv = (Float)1 / f;
             x *= inv;
             y *= inv;
             z *= inv;
@@ -697,9 +759,9 @@ namespace reina
             return z;
         }
 
-        Float LengthSquared() const { return x * x + y * y + z * z; }
+        FloatType<T> LengthSquared() const { return x * x + y * y + z * z; }
 
-        Float Length() const { return std::sqrt(LengthSquared()); }
+        FloatType<T> Length() const { return Sqrt(LengthSquared()); }
 
         // Dot
         T Dot(const Vector3<T> &v) const
@@ -745,7 +807,40 @@ namespace reina
     template <typename T>
     inline Normal3<T> Faceforward(const Normal3<T> &n, const Vector3<T> &v)
     {
-        return (n.Dot(v) < 0.f) ? -n : n;
+        auto flip = n.Dot(v) < 0;
+        return Normal3<T>(Select(flip, -n.x, n.x), Select(flip, -n.y, n.y), Select(flip, -n.z, n.z));
+    }
+
+    // a direction in 32 bits: projected onto the octahedron |x| + |y| + |z| = 1, whose lower half is
+    // folded out over the corners of the upper one's square, 16 bits per side. Decodes to a unit
+    // vector within 0.004 degrees; the zero vector is not representable
+    inline uint32_t EncodeOctahedral(const Vector3f &v)
+    {
+        Float l1 = std::abs(v.x) + std::abs(v.y) + std::abs(v.z);
+        Float x = v.x / l1, y = v.y / l1;
+        if (v.z < 0)
+        {
+            Float xf = (1 - std::abs(y)) * std::copysign((Float)1, x);
+            y = (1 - std::abs(x)) * std::copysign((Float)1, y);
+            x = xf;
+        }
+        auto encode = [](Float f)
+        { return (uint32_t)std::round(Clamp((f + 1) / 2, 0, 1) * 65535); };
+        return encode(x) | (encode(y) << 16);
+    }
+
+    inline Vector3f DecodeOctahedral(uint32_t bits)
+    {
+        Float x = -1 + 2 * ((bits & 0xffff) / (Float)65535);
+        Float y = -1 + 2 * ((bits >> 16) / (Float)65535);
+        Float z = 1 - (std::abs(x) + std::abs(y));
+        if (z < 0)
+        {
+            Float xf = (1 - std::abs(y)) * std::copysign((Float)1, x);
+            y = (1 - std::abs(x)) * std::copysign((Float)1, y);
+            x = xf;
+        }
+        return Normalize(Vector3f(x, y, z));
     }
 
     class Quaternion
@@ -778,14 +873,14 @@ namespace reina
         Quaternion operator*(Float f) const { return {v * f, w * f}; }
         Quaternion &operator/=(Float f)
         {
-            assert(f != 0);
+            assert(None(f == 0));
             v /= f;
             w /= f;
             return *this;
         }
         Quaternion operator/(Float f) const
         {
-            assert(f != 0);
+            assert(None(f == 0));
             return {v / f, w / f};
         }
 
@@ -799,6 +894,22 @@ namespace reina
         Float w = 1;
     };
 
+    inline Float Dot(const Quaternion &q1, const Quaternion &q2) { return q1.v.Dot(q2.v) + q1.w * q2.w; }
+
+    inline Quaternion Normalize(const Quaternion &q) { return q / std::sqrt(Dot(q, q)); }
+
+    // unit quaternions; constant angular velocity from q1 at t = 0 to q2 at t = 1
+    inline Quaternion Slerp(Float t, const Quaternion &q1, const Quaternion &q2)
+    {
+        // the angle from the chord and the sum stays accurate for nearby rotations, where acos does not
+        Quaternion d = q1 - q2, s = q1 + q2;
+        Float theta = 2 * std::atan2(std::sqrt(Dot(d, d)), std::sqrt(Dot(s, s)));
+        if (theta == 0)
+            return q1;
+        Quaternion qperp = Normalize(q2 - q1 * Dot(q1, q2));
+        return q1 * std::cos(theta * t) + qperp * std::sin(theta * t);
+    }
+
     template <typename T>
     class Bounds2
     {
@@ -895,10 +1006,7 @@ namespace reina
         }
         Bounds3(const Point3<T> &p) : pMin(p), pMax(p) {}
         Bounds3(const Point3<T> &p1, const Point3<T> &p2)
-            : pMin(std::min(p1.x, p2.x), std::min(p1.y, p2.y),
-                   std::min(p1.z, p2.z)),
-              pMax(std::max(p1.x, p2.x), std::max(p1.y, p2.y),
-                   std::max(p1.z, p2.z))
+            : pMin(Min(p1, p2)), pMax(Max(p1, p2))
         {
         }
         const Point3<T> &operator[](int i) const
@@ -973,20 +1081,133 @@ namespace reina
         {
             return Bounds3<U>((Point3<U>)pMin, (Point3<U>)pMax);
         }
-        bool IntersectP(const Ray &ray, Float *hitt0 = nullptr, Float *hitt1 = nullptr) const
+        // slab tests, defined in core/ray.hpp
+        bool IntersectP(const Ray &ray, Float *hitt0 = nullptr, Float *hitt1 = nullptr) const;
+        inline bool IntersectP(const Ray &ray, const Vector3f &invDir,
+                               const int dirIsNeg[3]) const;
+
+        // Bounds3 Public Members
+        Point3<T> pMin, pMax;
+    };
+
+    /***
+     *  WideBounds3f
+     *  N boxes stored as SoA (one array per axis) so that a single ray can be
+     *  slab-tested against all of them in SSE/AVX registers.
+     */
+    template <int N>
+    class alignas(N * sizeof(Float)) WideBounds3f
+    {
+    public:
+        // WideBounds3f Public Methods
+        WideBounds3f()
+        {
+            for (int i = 0; i < N; ++i)
+                Clear(i);
+        }
+        void Set(int lane, const Bounds3f &b)
         {
-            throw std::runtime_error("Bounds3::IntersectP not implemented");
-            return false;
+            assert(lane >= 0 && lane < N);
+            for (int axis = 0; axis < 3; ++axis)
+            {
+                pMin[axis][lane] = b.pMin[axis];
+                pMax[axis][lane] = b.pMax[axis];
+            }
         }
-        inline bool IntersectP(const Ray &ray, const Vector3f &invDir,
-                               const int dirIsNeg[3]) const
+        // empty lanes are inverted boxes and never report a hit
+        void Clear(int lane)
+        {
+            Set(lane, Bounds3f());
+        }
+        Bounds3f Get(int lane) const
         {
-            throw std::runtime_error("Bounds3::IntersectP not implemented");
-            return false;
+            assert(lane >= 0 && lane < N);
+            Bounds3f b;
+            b.pMin = Point3f(pMin[0][lane], pMin[1][lane], pMin[2][lane]);
+            b.pMax = Point3f(pMax[0][lane], pMax[1][lane], pMax[2][lane]);
+            return b;
         }
+        // returns a bitmask of the lanes hit by the ray, defined in core/ray.hpp
+        inline int IntersectP(const Ray &ray, const Vector3f &invDir, const int dirIsNeg[3],
+                              Float *tNear = nullptr) const;
 
-        // Bounds3 Public Members
-        Point3<T> pMin, pMax;
+        // WideBounds3f Public Members
+        Float pMin[3][N], pMax[3][N];
     };
 
-}
\ No newline at end of file
+    using Bounds3fx4 = WideBounds3f<4>;
+    using Bounds3fx8 = WideBounds3f<8>;
+
+
+    template <typename T>
+    inline Bounds3<T> Union(const Bounds3<T> &b, const Point3<T> &p)
+    {
+        Bounds3<T> ret;
+        ret.pMin = Min(b.pMin, p);
+        ret.pMax = Max(b.pMax, p);
+        return ret;
+    }
+
+    template <typename T>
+    inline Bounds3<T> Union(const Bounds3<T> &b1, const Bounds3<T> &b2)
+    {
+        Bounds3<T> ret;
+        ret.pMin = Min(b1.pMin, b2.pMin);
+        ret.pMax = Max(b1.pMax, b2.pMax);
+        return ret;
+    }
+
+    template <typename T>
+    inline bool Inside(const Point3<T> &p, const Bounds3<T> &b)
+    {
+        return (p.x >= b.pMin.x && p.x <= b.pMax.x && p.y >= b.pMin.y &&
+                p.y <= b.pMax.y && p.z >= b.pMin.z && p.z <= b.pMax.z);
+    }
+
+    // angle between unit vectors, accurate for nearly parallel ones too
+    inline Float AngleBetween(const Vector3f &v1, const Vector3f &v2)
+    {
+        if (v1.Dot(v2) < 0)
+            return Pi - 2 * SafeASin((v1 + v2).Length() / 2);
+        return 2 * SafeASin((v2 - v1).Length() / 2);
+    }
+
+    // the directions within acos(cosTheta) of w; cosTheta = Infinity marks an empty cone
+    struct DirectionCone
+    {
+        DirectionCone() = default;
+        DirectionCone(const Vector3f &w, Float cosTheta) : w(Normalize(w)), cosTheta(cosTheta) {}
+        explicit DirectionCone(const Vector3f &w) : DirectionCone(w, 1) {}
+        static DirectionCone EntireSphere() { return DirectionCone(Vector3f(0, 0, 1), -1); }
+        bool IsEmpty() const { return cosTheta == Infinity; }
+
+        Vector3f w;
+        Float cosTheta = Infinity;
+    };
+
+    // smallest cone around both, or a slightly larger one
+    inline DirectionCone Union(const DirectionCone &a, const DirectionCone &b)
+    {
+        if (a.IsEmpty())
+            return b;
+        if (b.IsEmpty())
+            return a;
+        Float thetaA = SafeACos(a.cosTheta), thetaB = SafeACos(b.cosTheta);
+        Float thetaD = AngleBetween(a.w, b.w);
+        if (std::min(thetaD + thetaB, Pi) <= thetaA)
+            return a;
+        if (std::min(thetaD + thetaA, Pi) <= thetaB)
+            return b;
+        Float thetaO = (thetaA + thetaD + thetaB) / 2;
+        if (thetaO >= Pi)
+            return DirectionCone::EntireSphere();
+        // rotate a.w towards b.w by thetaO - thetaA
+        Vector3f axis = a.w.Cross(b.w);
+        if (axis.LengthSquared() == 0)
+            return DirectionCone::EntireSphere();
+        axis = Normalize(axis);
+        Float thetaR = thetaO - thetaA;
+        Vector3f w = a.w * std::cos(thetaR) + axis.Cross(a.w) * std::sin(thetaR);
+        return DirectionCone(w, std::cos(thetaO));
+    }
+}
@@ -0,0 +1,195 @@
+/***
+ *  fastmath_test: checks the error bounds documented at the top of utils/fastmath.hpp
+ *
+ *  Every function is swept over every 37th float of its domain, and compared with libm in double
+ *  precision; two-argument functions sweep a grid and random pairs. Exits with 1 if any maximum
+ *  error is above the documented bound.
+ */
+#include <cmath>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <limits>
+#include <utils/fastmath.hpp>
+#include <utils/rng.hpp>
+using namespace reina;
+
+namespace
+{
+    constexpr uint32_t Stride = 37;
+    constexpr uint32_t InfinityBits = 0x7f800000;
+
+    float BitsToFloat(uint32_t bits)
+    {
+        float f;
+        std::memcpy(&f, &bits, sizeof(f));
+        return f;
+    }
+
+    // the spacing of floats at |r|, denormal ones included
+    double Ulp(double r)
+    {
+        float f = (float)std::abs(r);
+        if (f < std::numeric_limits<float>::min())
+            return std::ldexp(1.0, -149);
+        int exponent;
+        std::frexp(f, &exponent);
+        return std::ldexp(1.0, exponent - 24);
+    }
+
+    struct Error
+    {
+        // in ulps, or absolute when measured against an absolute bound
+        double max = 0;
+        float x = 0, y = 0;
+        // values where one of the two is not finite and they differ
+        int64_t nonFinite = 0;
+    };
+
+    void Accumulate(Error *e, float got, double expected, float x, float y = 0, bool absolute = false)
+    {
+        if (std::abs(expected) > std::numeric_limits<float>::max())
+            expected = std::copysign(std::numeric_limits<double>::infinity(), expected);
+        if (!std::isfinite(got) || !std::isfinite(expected))
+        {
+            if ((double)got != expected && !(std::isnan(got) && std::isnan(expected)))
+                ++e->nonFinite;
+            return;
+        }
+        double err = std::abs(got - expected) / (absolute ? 1 : Ulp(expected));
+        if (err > e->max)
+        {
+            e->max = err;
+            e->x = x;
+            e->y = y;
+        }
+    }
+
+    // calls f with every Stride-th float in [lo, hi], both signs
+    template <typename F>
+    void Sweep(float lo, float hi, F f)
+    {
+        for (int sign = 0; sign < 2; ++sign)
+            for (uint64_t bits = 0; bits < InfinityBits; bits += Stride)
+            {
+                float x = BitsToFloat((uint32_t)bits);
+                if (sign)
+                    x = -x;
+                if (x >= lo && x <= hi)
+                    f(x);
+            }
+    }
+
+    bool Check(const char *name, const char *domain, const Error &e, double bound, bool absolute = false)
+    {
+        bool ok = e.max <= bound && e.nonFinite == 0;
+        std::printf("%-10s %-22s %10.3g %-4s (bound %g) at x = %.9g, y = %.9g; %lld non-finite mismatches  %s\n",
+                    name, domain, e.max, absolute ? "abs" : "ulp", bound, e.x, e.y, (long long)e.nonFinite,
+                    ok ? "ok" : "FAILED");
+        return ok;
+    }
+}
+
+int main()
+{
+    const float Inf = std::numeric_limits<float>::infinity();
+    bool ok = true;
+
+    // FastExp
+    {
+        Error e, below;
+        Sweep(-Inf, Inf, [&](float x) {
+            if (x >= -104)
+                Accumulate(&e, FastExp(x), std::exp((double)x), x);
+            else
+                Accumulate(&below, FastExp(x), 0, x, 0, true);
+        });
+        ok &= Check("FastExp", "x >= -104", e, 1.3);
+        ok &= Check("FastExp", "x < -104", below, 0, true);
+    }
+
+    // FastLog
+    {
+        Error e;
+        Sweep(0, Inf, [&](float x) { Accumulate(&e, FastLog(x), x == 0 ? -Inf : std::log((double)x), x); });
+        Accumulate(&e, FastLog(0.f), -Inf, 0);
+        Accumulate(&e, FastLog(-1.f), std::nan(""), -1);
+        ok &= Check("FastLog", "x >= 0", e, 0.8);
+    }
+
+    // FastPow: y cycles through values that make y log2 x from -16 to 16
+    {
+        Error e;
+        int k = 0;
+        Sweep(std::numeric_limits<float>::denorm_min(), Inf, [&](float x) {
+            double log2x = std::log2((double)x);
+            k = k == 16 ? -16 : k + 1;
+            if (log2x == 0)
+                return;
+            float y = (float)(k / log2x);
+            if (std::abs(y * log2x) <= 16)
+                Accumulate(&e, FastPow(x, y), std::pow((double)x, (double)y), x, y);
+        });
+        ok &= Check("FastPow", "|y log2 x| <= 16", e, 22);
+    }
+
+    // FastSinCos
+    {
+        Error sinNear, cosNear, sinFar, cosFar;
+        Sweep(-8192, 8192, [&](float x) {
+            Float s, c;
+            FastSinCos(x, &s, &c);
+            double sd = std::sin((double)x), cd = std::cos((double)x);
+            if (std::abs(x) <= Pi)
+            {
+                Accumulate(&sinNear, s, sd, x);
+                Accumulate(&cosNear, c, cd, x);
+            }
+            Accumulate(&sinFar, s, sd, x, 0, true);
+            Accumulate(&cosFar, c, cd, x, 0, true);
+        });
+        ok &= Check("FastSin", "|x| <= pi", sinNear, 1.6);
+        ok &= Check("FastCos", "|x| <= pi", cosNear, 1.6);
+        ok &= Check("FastSin", "|x| <= 8192", sinFar, 1e-7, true);
+        ok &= Check("FastCos", "|x| <= 8192", cosFar, 1e-7, true);
+    }
+
+    // FastAtan2: a grid over all finite magnitudes, then random pairs in [-1, 1]^2; the largest
+    // errors are where y and x are of similar size
+    {
+        Error e;
+        const uint32_t GridStride = InfinityBits / 2048;
+        for (uint32_t yBits = 0; yBits < InfinityBits; yBits += GridStride)
+            for (uint32_t xBits = 0; xBits < InfinityBits; xBits += GridStride)
+                for (int signs = 0; signs < 4; ++signs)
+                {
+                    float y = BitsToFloat(yBits) * (signs & 1 ? -1 : 1);
+                    float x = BitsToFloat(xBits) * (signs & 2 ? -1 : 1);
+                    double expected = x == 0 && y == 0 ? 0 : std::atan2((double)y, (double)x);
+                    Accumulate(&e, FastAtan2(y, x), std::abs(expected) * (y < 0 ? -1 : 1), x, y);
+                }
+        RNG rng(7);
+        for (int i = 0; i < 20000000; ++i)
+        {
+            float y = 2 * (float)rng.UniformFloat() - 1, x = 2 * (float)rng.UniformFloat() - 1;
+            Accumulate(&e, FastAtan2(y, x), std::atan2((double)y, (double)x), x, y);
+        }
+        ok &= Check("FastAtan2", "finite y, x", e, 2.5);
+    }
+
+    // FastACos
+    {
+        Error e;
+        Sweep(-1, 1, [&](float x) { Accumulate(&e, FastACos(x), std::acos((double)x), x); });
+        ok &= Check("FastACos", "[-1, 1]", e, 1.3);
+    }
+
+    // FastErf
+    {
+        Error e;
+        Sweep(-Inf, Inf, [&](float x) { Accumulate(&e, FastErf(x), std::erf((double)x), x); });
+        ok &= Check("FastErf", "all x", e, 1.2);
+    }
+
+    return ok ? 0 : 1;
+}